@@ -1,38 +1,113 @@
 // Copyright (C) 2022 The Qt Company Ltd.
 // SPDX-License-Identifier: BSD-3-Clause
 
+pragma ComponentBehavior: Bound
+
 import QtQuick
 
 Item {
     id: rootItem
-    property alias blurSrc1: blurredItemSource1
-    property alias blurSrc2: blurredItemSource2
-    property alias blurSrc3: blurredItemSource3
-    property alias blurSrc4: blurredItemSource4
-    property alias blurSrc5: blurredItemSource5
+    property Item source: null
+    property int blurMax: 32
+    property real blurMultiplier: 0
+    // When true, blurred sources are sampled from the mipmaps of
+    // blurSrcMipmap instead of the five blurred layers.
+    property bool useMipmap: false
+    // When above 0, the blurred layers are rendered with the dual filter
+    // (dual Kawase) kernels, and each level is upsampled this many times.
+    // Upsampled levels are at most the size of the first blurred layer.
+    property int dualFilterPasses: 0
+    readonly property Item blurSrc1: blurredItemSource1
+    readonly property Item blurSrc2: dualFilterLevel2.result
+    readonly property Item blurSrc3: dualFilterLevel3.result
+    readonly property Item blurSrc4: dualFilterLevel4.result
+    readonly property Item blurSrc5: dualFilterLevel5.result
+    property alias blurSrcMipmap: mipmapSource
+    // Amount of pixels rendered offscreen for the blurred sources
+    readonly property int offscreenPixels: {
+        let pixels = 0;
+        const items = [blurredItemSource1, blurredItemSource2, blurredItemSource3,
+                       blurredItemSource4, blurredItemSource5];
+        for (const item of items) {
+            if (item.src)
+                pixels += item.width * item.height;
+        }
+        pixels += dualFilterLevel2.offscreenPixels + dualFilterLevel3.offscreenPixels
+                + dualFilterLevel4.offscreenPixels + dualFilterLevel5.offscreenPixels;
+        // Mipmap levels add a third to the size of the layer
+        if (mipmapSource.sourceItem)
+            pixels += Math.round(mipmapSource.sourceItem.width * mipmapSource.sourceItem.height * 4 / 3);
+        return pixels;
+    }
 
     component BlurItem : ShaderEffect {
-        property vector2d offset: Qt.vector2d((1.0 + rootItem.blurMultiplier) / width,
-                                              (1.0 + rootItem.blurMultiplier) / height)
+        readonly property bool dualFilter: rootItem.dualFilterPasses > 0
+        // Dual filter samples at half of the target pixel
+        readonly property real offsetScale: dualFilter ? 0.5 : 1.0
+        property vector2d offset: Qt.vector2d((1.0 + rootItem.blurMultiplier) * offsetScale / width,
+                                              (1.0 + rootItem.blurMultiplier) * offsetScale / height)
+        visible: false
+        layer.enabled: true
+        layer.smooth: true
+        vertexShader: dualFilter ? "dualkawase.vert.qsb" : "bluritems.vert.qsb"
+        fragmentShader: dualFilter ? "dualkawasedown.frag.qsb" : "bluritems.frag.qsb"
+    }
+
+    // Dual filter (dual Kawase) upsampling pass, renders the source at double size
+    component UpsampleItem : ShaderEffect {
+        property Item src: null
+        width: src ? src.width * 2 : 0
+        height: src ? src.height * 2 : 0
+        property vector2d offset: Qt.vector2d((1.0 + rootItem.blurMultiplier) * 0.5 / width,
+                                              (1.0 + rootItem.blurMultiplier) * 0.5 / height)
         visible: false
         layer.enabled: true
         layer.smooth: true
-        vertexShader: "bluritems.vert.qsb"
-        fragmentShader: "bluritems.frag.qsb"
+        vertexShader: "dualkawase.vert.qsb"
+        fragmentShader: "dualkawaseup.frag.qsb"
+    }
+
+    // Blurred level upsampled with the given amount of passes, 0 - 4
+    component DualFilterLevel : Item {
+        id: level
+        property Item src: null
+        property int passes: 0
+        readonly property Item result: passes >= 4 ? upsampleItem4 : passes === 3 ? upsampleItem3
+                                     : passes === 2 ? upsampleItem2 : passes === 1 ? upsampleItem1 : src
+        readonly property int offscreenPixels: upsampleItem1.width * upsampleItem1.height
+                                               + upsampleItem2.width * upsampleItem2.height
+                                               + upsampleItem3.width * upsampleItem3.height
+                                               + upsampleItem4.width * upsampleItem4.height
+        UpsampleItem {
+            id: upsampleItem1
+            src: level.passes >= 1 ? level.src : null
+        }
+        UpsampleItem {
+            id: upsampleItem2
+            src: level.passes >= 2 ? upsampleItem1 : null
+        }
+        UpsampleItem {
+            id: upsampleItem3
+            src: level.passes >= 3 ? upsampleItem2 : null
+        }
+        UpsampleItem {
+            id: upsampleItem4
+            src: level.passes >= 4 ? upsampleItem3 : null
+        }
     }
 
     QtObject {
         id: priv
-        property bool useBlurItem1: true
-        property bool useBlurItem2: rootItem.blurMax > 2
-        property bool useBlurItem3: rootItem.blurMax > 8
-        property bool useBlurItem4: rootItem.blurMax > 16
-        property bool useBlurItem5: rootItem.blurMax > 32
+        property bool useBlurItem1: !rootItem.useMipmap
+        property bool useBlurItem2: useBlurItem1 && rootItem.blurMax > 2
+        property bool useBlurItem3: useBlurItem1 && rootItem.blurMax > 8
+        property bool useBlurItem4: useBlurItem1 && rootItem.blurMax > 16
+        property bool useBlurItem5: useBlurItem1 && rootItem.blurMax > 32
     }
 
     BlurItem {
         id: blurredItemSource1
-        property Item src: priv.useBlurItem1 ? source : null
+        property Item src: priv.useBlurItem1 ? rootItem.source : null
         // Size of the first blurred item is by default half of the source.
         // Increase for quality and decrease for performance & more blur.
         readonly property int blurItemSize: 8
@@ -63,4 +138,32 @@ Item {
         width: blurredItemSource4.width * 0.5
         height: blurredItemSource4.height * 0.5
     }
+    // Level N can be upsampled N - 1 times, to the size of the first level
+    DualFilterLevel {
+        id: dualFilterLevel2
+        src: blurredItemSource2
+        passes: priv.useBlurItem2 ? Math.min(rootItem.dualFilterPasses, 1) : 0
+    }
+    DualFilterLevel {
+        id: dualFilterLevel3
+        src: blurredItemSource3
+        passes: priv.useBlurItem3 ? Math.min(rootItem.dualFilterPasses, 2) : 0
+    }
+    DualFilterLevel {
+        id: dualFilterLevel4
+        src: blurredItemSource4
+        passes: priv.useBlurItem4 ? Math.min(rootItem.dualFilterPasses, 3) : 0
+    }
+    DualFilterLevel {
+        id: dualFilterLevel5
+        src: blurredItemSource5
+        passes: priv.useBlurItem5 ? Math.min(rootItem.dualFilterPasses, 4) : 0
+    }
+    ShaderEffectSource {
+        id: mipmapSource
+        sourceItem: rootItem.useMipmap ? rootItem.source : null
+        mipmap: true
+        smooth: true
+        visible: false
+    }
 }
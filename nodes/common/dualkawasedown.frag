@@ -0,0 +1,23 @@
+#version 440
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+    vec2 offset;
+};
+
+layout(binding = 1) uniform sampler2D src;
+
+// Dual Kawase downsample, center and four diagonal samples.
+// Offset is half of the target pixel.
+void main() {
+    vec4 sum = texture(src, texCoord) * 4.0;
+    sum += texture(src, texCoord - offset);
+    sum += texture(src, texCoord + offset);
+    sum += texture(src, texCoord + vec2(offset.x, -offset.y));
+    sum += texture(src, texCoord - vec2(offset.x, -offset.y));
+    fragColor = sum * (0.125 * qt_Opacity);
+}
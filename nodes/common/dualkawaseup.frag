@@ -0,0 +1,26 @@
+#version 440
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+    vec2 offset;
+};
+
+layout(binding = 1) uniform sampler2D src;
+
+// Dual Kawase upsample, four edge and four diagonal samples.
+// Offset is half of the target pixel.
+void main() {
+    vec4 sum = texture(src, texCoord + vec2(-offset.x * 2.0, 0.0));
+    sum += texture(src, texCoord + vec2(offset.x * 2.0, 0.0));
+    sum += texture(src, texCoord + vec2(0.0, -offset.y * 2.0));
+    sum += texture(src, texCoord + vec2(0.0, offset.y * 2.0));
+    sum += texture(src, texCoord + vec2(-offset.x, offset.y)) * 2.0;
+    sum += texture(src, texCoord + vec2(offset.x, offset.y)) * 2.0;
+    sum += texture(src, texCoord + vec2(offset.x, -offset.y)) * 2.0;
+    sum += texture(src, texCoord + vec2(-offset.x, -offset.y)) * 2.0;
+    fragColor = sum * (qt_Opacity / 12.0);
+}
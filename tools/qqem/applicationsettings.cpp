@@ -26,9 +26,12 @@ const QString KEY_CODE_FONT_FILE = QStringLiteral("codeFontFile");
 const QString KEY_CODE_FONT_SIZE = QStringLiteral("codeFontSize");
 const QString KEY_DEFAULT_RESOURCE_PATH = QStringLiteral("defaultResourcePath");
 const QString KEY_CUSTOM_NODE_PATHS = QStringLiteral("customNodePaths");
+const QString KEY_AUTOSAVE_INTERVAL = QStringLiteral("autoSaveInterval");
+const QString KEY_GPU_MEMORY_BUDGET = QStringLiteral("gpuMemoryBudget");
 
 const QString DEFAULT_CODE_FONT_FILE = QStringLiteral("fonts/SourceCodePro-Regular.ttf");
 const int DEFAULT_CODE_FONT_SIZE = 14;
+const int DEFAULT_GPU_MEMORY_BUDGET = 128;
 
 ImagesModel::ImagesModel(QObject *effectManager)
     : QAbstractListModel(effectManager)
@@ -462,6 +465,37 @@ void ApplicationSettings::resetCodeFont()
     setCodeFontSize(DEFAULT_CODE_FONT_SIZE);
 }
 
+// Returns the project autosave interval in minutes, 0 when autosave is disabled.
+int ApplicationSettings::autoSaveInterval() const
+{
+    return m_settings.value(KEY_AUTOSAVE_INTERVAL, 0).toInt();
+}
+
+void ApplicationSettings::setAutoSaveInterval(int minutes)
+{
+    if (autoSaveInterval() == minutes)
+        return;
+
+    m_settings.setValue(KEY_AUTOSAVE_INTERVAL, minutes);
+    Q_EMIT autoSaveIntervalChanged();
+    m_effectManager->updateAutoSaveTimer();
+}
+
+// Returns the GPU memory budget of the effect in megabytes, 0 when there is no budget.
+int ApplicationSettings::gpuMemoryBudget() const
+{
+    return m_settings.value(KEY_GPU_MEMORY_BUDGET, DEFAULT_GPU_MEMORY_BUDGET).toInt();
+}
+
+void ApplicationSettings::setGpuMemoryBudget(int megabytes)
+{
+    if (gpuMemoryBudget() == megabytes)
+        return;
+
+    m_settings.setValue(KEY_GPU_MEMORY_BUDGET, megabytes);
+    Q_EMIT gpuMemoryBudgetChanged();
+}
+
 QString ApplicationSettings::defaultResourcePath()
 {
     return m_settings.value(KEY_DEFAULT_RESOURCE_PATH).value<QString>();
@@ -126,6 +126,8 @@ class ApplicationSettings : public QObject
     Q_PROPERTY(bool useLegacyShaders READ useLegacyShaders WRITE setUseLegacyShaders NOTIFY useLegacyShadersChanged)
     Q_PROPERTY(QString codeFontFile READ codeFontFile WRITE setCodeFontFile NOTIFY codeFontFileChanged)
     Q_PROPERTY(int codeFontSize READ codeFontSize WRITE setCodeFontSize NOTIFY codeFontSizeChanged)
+    Q_PROPERTY(int autoSaveInterval READ autoSaveInterval WRITE setAutoSaveInterval NOTIFY autoSaveIntervalChanged)
+    Q_PROPERTY(int gpuMemoryBudget READ gpuMemoryBudget WRITE setGpuMemoryBudget NOTIFY gpuMemoryBudgetChanged)
     Q_PROPERTY(QString defaultResourcePath READ defaultResourcePath)
 
 public:
@@ -138,6 +140,8 @@ public:
     bool useLegacyShaders() const;
     QString codeFontFile() const;
     int codeFontSize() const;
+    int autoSaveInterval() const;
+    int gpuMemoryBudget() const;
 
 public Q_SLOTS:
     void refreshSourceImagesModel();
@@ -152,6 +156,8 @@ public Q_SLOTS:
     void setCodeFontFile(const QString &font);
     void setCodeFontSize(int size);
     void resetCodeFont();
+    void setAutoSaveInterval(int minutes);
+    void setGpuMemoryBudget(int megabytes);
     QString defaultResourcePath();
     QStringList customNodesPaths() const;
     void refreshCustomNodesModel();
@@ -166,6 +172,8 @@ Q_SIGNALS:
     void useLegacyShadersChanged();
     void codeFontFileChanged();
     void codeFontSizeChanged();
+    void autoSaveIntervalChanged();
+    void gpuMemoryBudgetChanged();
 
 private:
     QSettings m_settings;
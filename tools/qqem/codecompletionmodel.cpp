@@ -9,6 +9,8 @@ CodeCompletionModel::CodeCompletionModel(QObject *effectManager)
 {
     m_effectManager = static_cast<EffectManager *>(effectManager);
     connect(this, &QAbstractListModel::modelReset, this, &CodeCompletionModel::rowCountChanged);
+    connect(this, &QAbstractListModel::rowsInserted, this, &CodeCompletionModel::rowCountChanged);
+    connect(this, &QAbstractListModel::rowsRemoved, this, &CodeCompletionModel::rowCountChanged);
 }
 
 int CodeCompletionModel::rowCount(const QModelIndex &) const
@@ -54,6 +56,45 @@ void CodeCompletionModel::clearItems()
     m_modelList.clear();
 }
 
+// Updates the items with row removes and inserts instead of resetting the
+// model, so the items which stay are not recreated when typing.
+void CodeCompletionModel::setItems(const QList<ModelData> &items)
+{
+    auto sameItem = [](const ModelData &a, const ModelData &b) {
+        return a.name == b.name && a.type == b.type;
+    };
+    int row = 0;
+    for (const auto &item : items) {
+        if (row < m_modelList.size() && sameItem(m_modelList.at(row), item)) {
+            row++;
+            continue;
+        }
+        // Remove the rows before the item, when it exists later in the model
+        int existingRow = -1;
+        for (int i = row + 1; i < m_modelList.size(); ++i) {
+            if (sameItem(m_modelList.at(i), item)) {
+                existingRow = i;
+                break;
+            }
+        }
+        if (existingRow > row) {
+            beginRemoveRows(QModelIndex(), row, existingRow - 1);
+            m_modelList.remove(row, existingRow - row);
+            endRemoveRows();
+        } else {
+            beginInsertRows(QModelIndex(), row, row);
+            m_modelList.insert(row, item);
+            endInsertRows();
+        }
+        row++;
+    }
+    if (row < m_modelList.size()) {
+        beginRemoveRows(QModelIndex(), row, m_modelList.size() - 1);
+        m_modelList.remove(row, m_modelList.size() - row);
+        endRemoveRows();
+    }
+}
+
 CodeCompletionModel::ModelData CodeCompletionModel::currentItem()
 {
     if (m_modelList.size() > m_currentIndex)
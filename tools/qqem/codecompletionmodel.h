@@ -30,7 +30,9 @@ public:
     enum WordTypes {
         TypeArgument,
         TypeTag,
-        TypeFunction
+        TypeFunction,
+        TypeUniform,
+        TypeSymbol
     };
 
     explicit CodeCompletionModel(QObject *effectManager);
@@ -41,6 +43,7 @@ public:
 
     void addItem(const QString &text, int type);
     void clearItems();
+    void setItems(const QList<ModelData> &items);
     CodeCompletionModel::ModelData currentItem();
     int currentIndex() const;
     void setCurrentIndex(int index);
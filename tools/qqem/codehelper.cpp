@@ -5,6 +5,19 @@
 #include "effectmanager.h"
 #include "syntaxhighlighterdata.h"
 #include <QString>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QtQuick/qquicktextdocument.h>
+
+// Maximum amount of code completion items
+static const int MaxCompletionItems = 100;
+
+// Ranking of the completion word types, project symbols first
+enum CompletionPriority {
+    PriorityProject,
+    PriorityReserved
+};
 
 CodeHelper::CodeHelper(QObject *parent)
     : QObject{parent}
@@ -15,20 +28,16 @@ CodeHelper::CodeHelper(QObject *parent)
     m_codeCompletionTimer.setSingleShot(true);
     connect(&m_codeCompletionTimer, &QTimer::timeout, this, &CodeHelper::showCodeCompletion);
 
-    // Cache syntax highlight data
-    auto args = SyntaxHighlighterData::reservedArgumentNames();
+    // Index syntax highlight data
+    const auto args = SyntaxHighlighterData::reservedArgumentNames();
     for (const auto &arg : args)
-        m_reservedArgumentNames << QString::fromUtf8(arg);
-    auto funcs = SyntaxHighlighterData::reservedFunctionNames();
+        m_completionTrie.insert(QString::fromUtf8(arg), CodeCompletionModel::TypeArgument, PriorityReserved);
+    const auto funcs = SyntaxHighlighterData::reservedFunctionNames();
     for (const auto &func : funcs)
-        m_reservedFunctionNames << QString::fromUtf8(func);
-    auto tags = SyntaxHighlighterData::reservedTagNames();
+        m_completionTrie.insert(QString::fromUtf8(func), CodeCompletionModel::TypeFunction, PriorityReserved);
+    const auto tags = SyntaxHighlighterData::reservedTagNames();
     for (const auto &tag : tags)
-        m_reservedTagNames << QString::fromUtf8(tag);
-
-    std::sort(m_reservedArgumentNames.begin(), m_reservedArgumentNames.end());
-    std::sort(m_reservedFunctionNames.begin(), m_reservedFunctionNames.end());
-    std::sort(m_reservedTagNames.begin(), m_reservedTagNames.end());
+        m_completionTrie.insert(QString::fromUtf8(tag), CodeCompletionModel::TypeTag, PriorityReserved);
 }
 
 // Process the keyCode and return true if key was handled and
@@ -102,6 +111,14 @@ bool CodeHelper::processKey(QQuickTextEdit *textEdit, int keyCode, int modifiers
 // Not a full parser so doesn't work with more complex code.
 // For that, consider ClangFormat etc.
 QString CodeHelper::autoIndentGLSLCode(const QString &code)
+{
+    const QStringList codeLines = code.split('\n');
+    return autoIndentGLSLLines(codeLines, 0, codeLines.size() - 1).join('\n');
+}
+
+// Returns the indented lines from firstLine to lastLine. Indent depends on
+// the previous lines, so those are processed but not formatted.
+QStringList CodeHelper::autoIndentGLSLLines(const QStringList &codeLines, int firstLine, int lastLine)
 {
     QStringList out;
     // Index (indent level) currently
@@ -117,20 +134,24 @@ QString CodeHelper::autoIndentGLSLCode(const QString &code)
     // Stores indent before nextLineIndents started
     int indentBeforeSingles = 0;
 
-    QStringList codeList = code.split('\n');
-    for (const auto &cOrig : codeList) {
+    lastLine = std::min(lastLine, int(codeLines.size()) - 1);
+    for (int line = 0; line <= lastLine; ++line) {
+        const QString &cOrig = codeLines.at(line);
+        const bool inRange = line >= firstLine;
         QString c = cOrig.trimmed();
 
         if (c.isEmpty()) {
             // Lines with only spaces are emptied but kept
-            out << c;
+            if (inRange)
+                out << c;
             continue;
         }
 
         bool isPreprocessor = c.startsWith('#');
         if (isPreprocessor) {
             // Preprocesser lines have zero intent
-            out << c;
+            if (inRange)
+                out << c;
             continue;
         }
 
@@ -160,7 +181,8 @@ QString CodeHelper::autoIndentGLSLCode(const QString &code)
 
         if (multilineComment || endComments > startComments) {
             // Lines inside /* .. */ are not touched
-            out << cOrig;
+            if (inRange)
+                out << cOrig;
             continue;
         }
 
@@ -200,6 +222,10 @@ QString CodeHelper::autoIndentGLSLCode(const QString &code)
             }
         }
 
+        prevIndex = index;
+        if (!inRange)
+            continue;
+
         // Apply indent
         QString singleIndentStep = QStringLiteral("    ");
         for (int i = 0; i < currentIndex; i++)
@@ -207,9 +233,64 @@ QString CodeHelper::autoIndentGLSLCode(const QString &code)
         c.prepend(indent);
 
         out << (c + commentPart);
-        prevIndex = index;
     }
-    return out.join('\n');
+    return out;
+}
+
+// Indents the selected lines, or all lines without a selection. Only the
+// changed parts of the lines are edited in the document, as a single undo
+// step, so the cursor and the highlighting of other lines are kept.
+void CodeHelper::autoIndentGLSLRange(QQuickTextEdit *textEdit)
+{
+    if (!textEdit || !textEdit->textDocument())
+        return;
+    QTextDocument *document = textEdit->textDocument()->textDocument();
+    int firstLine = 0;
+    int lastLine = document->blockCount() - 1;
+    const int selectionStart = textEdit->selectionStart();
+    const int selectionEnd = textEdit->selectionEnd();
+    if (selectionEnd > selectionStart) {
+        firstLine = document->findBlock(selectionStart).blockNumber();
+        const QTextBlock endBlock = document->findBlock(selectionEnd);
+        // Selection ending at the start of a line doesn't include it
+        lastLine = endBlock.position() == selectionEnd ? endBlock.blockNumber() - 1 : endBlock.blockNumber();
+    }
+
+    QStringList codeLines;
+    codeLines.reserve(lastLine + 1);
+    for (QTextBlock block = document->begin(); block.isValid() && block.blockNumber() <= lastLine; block = block.next())
+        codeLines << block.text();
+    const QStringList indentedLines = autoIndentGLSLLines(codeLines, firstLine, lastLine);
+
+    QTextCursor cursor(document);
+    bool editStarted = false;
+    for (int i = 0; i < indentedLines.size(); ++i) {
+        const QString &oldLine = codeLines.at(firstLine + i);
+        const QString &newLine = indentedLines.at(i);
+        if (oldLine == newLine)
+            continue;
+        // Replace only the part between the common prefix and suffix
+        int prefix = 0;
+        const int maxPrefix = std::min(oldLine.size(), newLine.size());
+        while (prefix < maxPrefix && oldLine.at(prefix) == newLine.at(prefix))
+            prefix++;
+        int suffix = 0;
+        const int maxSuffix = maxPrefix - prefix;
+        while (suffix < maxSuffix
+               && oldLine.at(oldLine.size() - 1 - suffix) == newLine.at(newLine.size() - 1 - suffix)) {
+            suffix++;
+        }
+        if (!editStarted) {
+            cursor.beginEditBlock();
+            editStarted = true;
+        }
+        const int blockPosition = document->findBlockByNumber(firstLine + i).position();
+        cursor.setPosition(blockPosition + prefix);
+        cursor.setPosition(blockPosition + oldLine.size() - suffix, QTextCursor::KeepAnchor);
+        cursor.insertText(newLine.mid(prefix, newLine.size() - prefix - suffix));
+    }
+    if (editStarted)
+        cursor.endEditBlock();
 }
 
 // Takes in the previous line (before pressing return key)
@@ -376,27 +457,13 @@ void CodeHelper::showCodeCompletion()
         currentWordCleaned = currentWordCleaned.right(currentWordCleaned.size() - 2);
     }
 
-    m_codeCompletionModel->beginResetModel();
-    m_codeCompletionModel->clearItems();
-
+    QList<CodeCompletionModel::ModelData> items;
     if (!isComment) {
-        for (const auto &a : m_reservedArgumentNames) {
-            if (a.startsWith(currentWordCleaned, Qt::CaseInsensitive) && a.size() > currentWordCleaned.size())
-                m_codeCompletionModel->addItem(a, CodeCompletionModel::TypeArgument);
-        }
-
-        for (const auto &a : m_reservedFunctionNames) {
-            if (a.startsWith(currentWordCleaned, Qt::CaseInsensitive) && a.size() > currentWordCleaned.size())
-                m_codeCompletionModel->addItem(a, CodeCompletionModel::TypeFunction);
-        }
-
-        for (const auto &a : m_reservedTagNames) {
-            if (a.startsWith(currentWord, Qt::CaseInsensitive) && a.size() > currentWord.size())
-                m_codeCompletionModel->addItem(a, CodeCompletionModel::TypeTag);
-        }
+        const auto matches = m_completionTrie.find(currentWordCleaned, MaxCompletionItems);
+        for (const auto &match : matches)
+            items << CodeCompletionModel::ModelData { match.name, match.type };
     }
-
-    m_codeCompletionModel->endResetModel();
+    m_codeCompletionModel->setItems(items);
 
     if (!m_codeCompletionModel->m_modelList.isEmpty()) {
         m_codeCompletionModel->setCurrentIndex(0);
@@ -406,6 +473,56 @@ void CodeHelper::showCodeCompletion()
     }
 }
 
+// Updates the symbols of the indexed node into the completion index
+void CodeHelper::updateNodeSymbols(int nodeId, const QList<GlslSymbolIndex::Symbol> &symbols)
+{
+    QList<QPair<QString, int>> words;
+    for (const auto &symbol : symbols) {
+        QPair<QString, int> word;
+        if (symbol.kind == GlslSymbolIndex::Kind::Function)
+            word = qMakePair(symbol.name + QStringLiteral("()"), int(CodeCompletionModel::TypeFunction));
+        else
+            word = qMakePair(symbol.name, int(CodeCompletionModel::TypeSymbol));
+        if (!words.contains(word))
+            words << word;
+    }
+    const auto previousWords = m_nodeSymbols.value(nodeId);
+    for (const auto &word : previousWords) {
+        if (!words.contains(word))
+            m_completionTrie.remove(word.first, word.second);
+    }
+    for (const auto &word : std::as_const(words)) {
+        if (!previousWords.contains(word))
+            m_completionTrie.insert(word.first, word.second, PriorityProject);
+    }
+    m_nodeSymbols[nodeId] = words;
+}
+
+void CodeHelper::removeNodeSymbols(int nodeId)
+{
+    const auto words = m_nodeSymbols.take(nodeId);
+    for (const auto &word : words)
+        m_completionTrie.remove(word.first, word.second);
+}
+
+void CodeHelper::updateUniformSymbols(const UniformModel::UniformTable &uniforms)
+{
+    QStringList names;
+    for (const auto &uniform : uniforms) {
+        if (!names.contains(uniform.name))
+            names << uniform.name;
+    }
+    for (const auto &name : std::as_const(m_uniformSymbols)) {
+        if (!names.contains(name))
+            m_completionTrie.remove(name, CodeCompletionModel::TypeUniform);
+    }
+    for (const auto &name : std::as_const(names)) {
+        if (!m_uniformSymbols.contains(name))
+            m_completionTrie.insert(name, CodeCompletionModel::TypeUniform, PriorityProject);
+    }
+    m_uniformSymbols = names;
+}
+
 CodeCompletionModel *CodeHelper::codeCompletionModel() const
 {
     return m_codeCompletionModel;
@@ -4,10 +4,15 @@
 #ifndef CODEHELPER_H
 #define CODEHELPER_H
 
+#include <QHash>
 #include <QObject>
+#include <QStringList>
 #include <QTimer>
 #include <QtQuick/private/qquicktextedit_p_p.h>
 #include "codecompletionmodel.h"
+#include "completiontrie.h"
+#include "glslsymbolindex.h"
+#include "uniformmodel.h"
 
 class EffectManager;
 
@@ -26,6 +31,7 @@ public:
 public Q_SLOTS:
     bool processKey(QQuickTextEdit *textEdit, int keyCode, int modifiers);
     QString autoIndentGLSLCode(const QString &code);
+    void autoIndentGLSLRange(QQuickTextEdit *textEdit);
     QString autoIndentGLSLNextLine(const QString &codeLine, bool multilineComment);
     QString getCurrentWord(QQuickTextEdit *textEdit);
     void removeCurrentWord(QQuickTextEdit *textEdit);
@@ -41,6 +47,11 @@ private:
     friend class EffectManager;
 
     void showCodeCompletion();
+    QStringList autoIndentGLSLLines(const QStringList &codeLines, int firstLine, int lastLine);
+    // Keep the project symbols of the completion index up to date
+    void updateNodeSymbols(int nodeId, const QList<GlslSymbolIndex::Symbol> &symbols);
+    void removeNodeSymbols(int nodeId);
+    void updateUniformSymbols(const UniformModel::UniformTable &uniforms);
 
     EffectManager *m_effectManager = nullptr;
     CodeCompletionModel *m_codeCompletionModel = nullptr;
@@ -48,9 +59,11 @@ private:
     bool m_codeCompletionVisible = false;
     QTimer m_codeCompletionTimer;
 
-    QList<QString> m_reservedArgumentNames;
-    QList<QString> m_reservedTagNames;
-    QList<QString> m_reservedFunctionNames;
+    // Reserved names and the project symbols
+    CompletionTrie m_completionTrie;
+    // Words and types of the symbols declared in the nodes, with node id as a key
+    QHash<int, QList<QPair<QString, int>>> m_nodeSymbols;
+    QStringList m_uniformSymbols;
 
 };
 
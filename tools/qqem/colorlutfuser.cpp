@@ -0,0 +1,153 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "colorlutfuser.h"
+#include "glsltokenizer.h"
+#include "syntaxhighlighterdata.h"
+#include <QRegularExpression>
+#include <cmath>
+
+// GLSL functions which depend on the fragment position
+static bool isPositionDependentFunction(QStringView name)
+{
+    return name.startsWith(u"texture") || name.startsWith(u"texel") || name.startsWith(u"interpolateAt")
+            || name == u"dFdx" || name == u"dFdy" || name == u"fwidth";
+}
+
+// Constructors and keywords which can be followed by parenthesis
+static bool isConstructorOrKeyword(QStringView name)
+{
+    static const QRegularExpression typeExp("^([biu]?vec[234]|mat[234](x[234])?|float|int|uint|bool"
+                                            "|if|for|while|switch|return)$");
+    return typeExp.match(name).hasMatch();
+}
+
+static const QSet<QString> &glslFunctionNames()
+{
+    static QSet<QString> names = []() {
+        QSet<QString> set;
+        for (const auto &function : SyntaxHighlighterData::reservedFunctionNames()) {
+            // Names are in "name()" format
+            QString name = QString::fromUtf8(function);
+            set << name.left(name.indexOf('('));
+        }
+        return set;
+    }();
+    return names;
+}
+
+bool ColorLutFuser::isColorOnly(const QString &code, const QSet<QString> &positionDependent,
+                                const QSet<QString> &pureFunctions)
+{
+    bool colorOnly = true;
+    GlslTokenizer::forEachIdentifier(code, [&](const GlslTokenizer::Identifier &identifier) {
+        if (!colorOnly || identifier.isTag)
+            return;
+        const QString name = identifier.name.toString();
+        if (positionDependent.contains(name)) {
+            colorOnly = false;
+            return;
+        }
+        const bool isCall = identifier.lineRest.trimmed().startsWith(QLatin1Char('('));
+        if (!isCall || isConstructorOrKeyword(name) || pureFunctions.contains(name))
+            return;
+        if (isPositionDependentFunction(name) || !glslFunctionNames().contains(name))
+            colorOnly = false;
+    });
+    return colorOnly;
+}
+
+QSet<QString> ColorLutFuser::definedFunctions(const QString &code)
+{
+    static const QRegularExpression functionExp("^\\s*\\w+\\s+(\\w+)\\s*\\([^;]*$",
+                                                QRegularExpression::MultilineOption);
+    QSet<QString> functions;
+    auto it = functionExp.globalMatch(code);
+    while (it.hasNext()) {
+        const QString name = it.next().captured(1);
+        if (!isConstructorOrKeyword(name))
+            functions << name;
+    }
+    return functions;
+}
+
+QSet<QString> ColorLutFuser::declaredVariables(const QString &code)
+{
+    static const QRegularExpression declarationExp("\\b(?:[biu]?vec[234]|mat[234](?:x[234])?|float|int|uint|bool)"
+                                                   "\\s+(\\w+)\\s*(?:=|;|,|\\[)");
+    QSet<QString> variables;
+    auto it = declarationExp.globalMatch(code);
+    while (it.hasNext())
+        variables << it.next().captured(1);
+    return variables;
+}
+
+QSet<QString> ColorLutFuser::usedIdentifiers(const QString &code)
+{
+    QSet<QString> identifiers;
+    GlslTokenizer::forEachIdentifier(code, [&identifiers](const GlslTokenizer::Identifier &identifier) {
+        if (!identifier.isTag)
+            identifiers << identifier.name.toString();
+    });
+    return identifiers;
+}
+
+QString ColorLutFuser::shaderMain(const Run &run, float alpha)
+{
+    const QString alphaString = QString::number(alpha, 'f', 3);
+    QString s;
+    s += "void main() {\n";
+    s += "    // Color of the LUT texel, blue selects the 64x64 cell\n";
+    s += QString("    vec2 lutTexel = floor(texCoord * %1.0);\n").arg(LutSize);
+    s += "    vec2 lutCell = floor(lutTexel / 64.0);\n";
+    s += "    vec3 lutColor = vec3(mod(lutTexel, 64.0), lutCell.y * 8.0 + lutCell.x) / 63.0;\n";
+    s += QString("    fragColor = vec4(lutColor * %1, %1);\n").arg(alphaString);
+    s += run.code;
+    s += "}\n";
+    return s;
+}
+
+bool ColorLutFuser::isAlphaIndependent(const QImage &opaqueLut, const QImage &translucentLut)
+{
+    if (opaqueLut.size() != translucentLut.size())
+        return false;
+    const QImage opaque = opaqueLut.convertToFormat(QImage::Format_RGBA8888);
+    const QImage translucent = translucentLut.convertToFormat(QImage::Format_RGBA8888);
+    // Allow rounding errors of the 8-bit render targets
+    const int tolerance = 3;
+    for (int y = 0; y < opaque.height(); y++) {
+        const uchar *o = opaque.constScanLine(y);
+        const uchar *t = translucent.constScanLine(y);
+        for (int x = 0; x < opaque.width() * 4; x += 4) {
+            if (o[x + 3] < 255 - tolerance || std::abs(t[x + 3] - 128) > tolerance)
+                return false;
+            for (int c = 0; c < 3; c++) {
+                if (std::abs(o[x + c] - 2 * t[x + c]) > 2 * tolerance)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+QString ColorLutFuser::lookupCode(const Run &run)
+{
+    QString s;
+    s += "    {\n";
+    s += QString("        // Fused from: %1\n").arg(run.nodeNames.join(", "));
+    s += "        const vec3 lutInput = clamp(fragColor.rgb / max(1.0 / 256.0, fragColor.a), 0.0, 1.0);\n";
+    s += "        const float lutBlue = lutInput.b * 63.0;\n";
+    s += "        const float h1 = 0.5 / 512.0;\n";
+    s += "        const float h2 = 0.125 - (1.0 / 512.0);\n";
+    s += "        vec2 quad1;\n";
+    s += "        quad1.y = floor(floor(lutBlue) * 0.125) * 0.125;\n";
+    s += "        quad1.x = (floor(lutBlue) - (quad1.y * 64.0)) * 0.125;\n";
+    s += "        vec2 quad2;\n";
+    s += "        quad2.y = floor(ceil(lutBlue) * 0.125) * 0.125;\n";
+    s += "        quad2.x = (ceil(lutBlue) - (quad2.y * 64.0)) * 0.125;\n";
+    s += QString("        const vec3 lutColor1 = texture(%1, quad1 + h1 + h2 * lutInput.rg).rgb;\n").arg(run.samplerName);
+    s += QString("        const vec3 lutColor2 = texture(%1, quad2 + h1 + h2 * lutInput.rg).rgb;\n").arg(run.samplerName);
+    s += "        fragColor.rgb = mix(lutColor1, lutColor2, fract(lutBlue)) * fragColor.a;\n";
+    s += "    }\n";
+    return s;
+}
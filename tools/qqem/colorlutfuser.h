@@ -0,0 +1,55 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef COLORLUTFUSER_H
+#define COLORLUTFUSER_H
+
+#include <QImage>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// Fuses consecutive nodes, which only adjust fragColor based on its
+// current value, into a single 3D LUT texture lookup. The LUT uses the
+// 512x512 format of the ColorLUT node: 8x8 cells of 64x64 texels, blue
+// selecting the cell and red & green the texel inside it.
+class ColorLutFuser
+{
+public:
+    static const int LutSize = 512;
+    // Runs shorter than this are cheaper to calculate than to look up
+    static const int MinRunLength = 2;
+
+    struct Run {
+        // Fused nodes, in the shader order
+        QList<int> nodeIds;
+        QStringList nodeNames;
+        // Combined main code of the nodes, without tags
+        QString code;
+        // Name of the LUT sampler replacing the nodes
+        QString samplerName;
+    };
+
+    // Returns true when the code doesn't depend on the fragment position or
+    // time, so it is a function of fragColor and constants. Calls are
+    // allowed to GLSL functions and to the given pure functions.
+    static bool isColorOnly(const QString &code, const QSet<QString> &positionDependent,
+                            const QSet<QString> &pureFunctions);
+    // Returns names of the functions defined in the code
+    static QSet<QString> definedFunctions(const QString &code);
+    // Returns names of the variables declared in the code
+    static QSet<QString> declaredVariables(const QString &code);
+    // Returns all the identifiers used in the code
+    static QSet<QString> usedIdentifiers(const QString &code);
+    // Returns main() of the shader which evaluates the run for every LUT
+    // texel. Input colors are premultiplied with the alpha.
+    static QString shaderMain(const Run &run, float alpha);
+    // Returns true when the run keeps alpha and works on premultiplied
+    // colors, so that it can be evaluated only for opaque colors.
+    static bool isAlphaIndependent(const QImage &opaqueLut, const QImage &translucentLut);
+    // Returns the main code which replaces the nodes of the run
+    static QString lookupCode(const Run &run);
+};
+
+#endif // COLORLUTFUSER_H
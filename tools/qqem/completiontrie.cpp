@@ -0,0 +1,122 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "completiontrie.h"
+#include <algorithm>
+
+void CompletionTrie::insert(const QString &word, int type, int priority)
+{
+    if (word.isEmpty())
+        return;
+    Node &node = m_nodes[findOrCreateNode(word)];
+    for (auto &w : node.words) {
+        if (w.name == word && w.type == type) {
+            w.count++;
+            w.priority = std::min(w.priority, priority);
+            return;
+        }
+    }
+    Word w;
+    w.name = word;
+    w.type = type;
+    w.priority = priority;
+    w.count = 1;
+    node.words << w;
+}
+
+// Note: Nodes are not removed, they are reused when the word is added again
+void CompletionTrie::remove(const QString &word, int type)
+{
+    const int nodeIndex = findNode(word);
+    if (nodeIndex < 0)
+        return;
+    auto &words = m_nodes[nodeIndex].words;
+    for (int i = 0; i < words.size(); ++i) {
+        if (words.at(i).name == word && words.at(i).type == type) {
+            if (--words[i].count <= 0)
+                words.removeAt(i);
+            return;
+        }
+    }
+}
+
+QList<CompletionTrie::Match> CompletionTrie::find(const QString &prefix, int maxResults) const
+{
+    QList<Match> matches;
+    const int nodeIndex = findNode(prefix);
+    if (nodeIndex < 0)
+        return matches;
+
+    QList<const Word *> words;
+    collectWords(nodeIndex, words);
+    words.removeIf([&prefix](const Word *w) {
+        return w->name.size() <= prefix.size();
+    });
+    auto rank = [&prefix](const Word *a, const Word *b) {
+        const bool aExact = a->name.startsWith(prefix);
+        const bool bExact = b->name.startsWith(prefix);
+        if (aExact != bExact)
+            return aExact;
+        if (a->priority != b->priority)
+            return a->priority < b->priority;
+        if (a->name.size() != b->name.size())
+            return a->name.size() < b->name.size();
+        return a->name < b->name;
+    };
+    const int count = std::min(int(words.size()), maxResults);
+    std::partial_sort(words.begin(), words.begin() + count, words.end(), rank);
+    for (int i = 0; i < count; ++i) {
+        // Same name can be e.g. both a built-in and a project function
+        const QString &name = words.at(i)->name;
+        if (std::any_of(matches.cbegin(), matches.cend(), [&name](const Match &m) { return m.name == name; }))
+            continue;
+        matches << Match { name, words.at(i)->type };
+    }
+    return matches;
+}
+
+int CompletionTrie::findNode(const QString &word) const
+{
+    int nodeIndex = 0;
+    for (const QChar c : word) {
+        const QChar key = c.toLower();
+        const auto &children = m_nodes.at(nodeIndex).children;
+        auto it = std::find_if(children.cbegin(), children.cend(), [key](const QPair<QChar, int> &child) {
+            return child.first == key;
+        });
+        if (it == children.cend())
+            return -1;
+        nodeIndex = it->second;
+    }
+    return nodeIndex;
+}
+
+int CompletionTrie::findOrCreateNode(const QString &word)
+{
+    int nodeIndex = 0;
+    for (const QChar c : word) {
+        const QChar key = c.toLower();
+        const auto &children = m_nodes.at(nodeIndex).children;
+        auto it = std::find_if(children.cbegin(), children.cend(), [key](const QPair<QChar, int> &child) {
+            return child.first == key;
+        });
+        if (it != children.cend()) {
+            nodeIndex = it->second;
+        } else {
+            const int childIndex = m_nodes.size();
+            m_nodes << Node();
+            m_nodes[nodeIndex].children << qMakePair(key, childIndex);
+            nodeIndex = childIndex;
+        }
+    }
+    return nodeIndex;
+}
+
+void CompletionTrie::collectWords(int nodeIndex, QList<const Word *> &words) const
+{
+    const Node &node = m_nodes.at(nodeIndex);
+    for (const auto &w : node.words)
+        words << &w;
+    for (const auto &child : node.children)
+        collectWords(child.second, words);
+}
@@ -0,0 +1,51 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef COMPLETIONTRIE_H
+#define COMPLETIONTRIE_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+
+// Case-insensitive prefix tree of the code completion words. Words can be
+// added and removed one at a time, so project symbols can be kept up to
+// date without rebuilding the whole index.
+class CompletionTrie
+{
+public:
+    struct Match {
+        QString name;
+        int type = 0;
+    };
+
+    // Adds the word, words added several times are reference counted.
+    // Lower priority values are ranked first.
+    void insert(const QString &word, int type, int priority);
+    void remove(const QString &word, int type);
+    // Returns the words starting with the prefix and longer than it, ranked
+    // by case-sensitive match, priority, length and name.
+    QList<Match> find(const QString &prefix, int maxResults) const;
+
+private:
+    struct Word {
+        QString name;
+        int type = 0;
+        int priority = 0;
+        int count = 0;
+    };
+    struct Node {
+        // Lowercase character and index of the child node
+        QList<QPair<QChar, int>> children;
+        QList<Word> words;
+    };
+
+    int findNode(const QString &word) const;
+    int findOrCreateNode(const QString &word);
+    void collectWords(int nodeIndex, QList<const Word *> &words) const;
+
+    // Root is the first node
+    QList<Node> m_nodes = { Node() };
+};
+
+#endif // COMPLETIONTRIE_H
@@ -4,15 +4,27 @@
 #include "effectmanager.h"
 #include "propertyhandler.h"
 #include "syntaxhighlighterdata.h"
+#include "texturecompressor.h"
+#include "resourcegenerator.h"
+#include "spirvusage.h"
+#include <QBuffer>
 #include <QDir>
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QImageReader>
 #include <QQmlContext>
 #include <QtQml/qqmlfile.h>
 #include <QXmlStreamWriter>
+#include <algorithm>
+#include <functional>
 
 QQmlPropertyMap g_argData;
 
@@ -37,6 +49,65 @@ static bool writeToFile(const QByteArray &buf, const QString &filename, FileType
     return true;
 }
 
+// Writes buf into filename atomically. The old file is replaced only
+// when all the data has been written successfully.
+// Note: Can be called from worker threads.
+static bool writeToSaveFile(const QByteArray &buf, const QString &filename)
+{
+    QSaveFile f(filename);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open file for writing:" << filename;
+        return false;
+    }
+    f.write(buf);
+    return f.commit();
+}
+
+// Writes buf into filename only when the content differs from the existing
+// file. This keeps the timestamps of unchanged files, so e.g. rcc and
+// qmlcachegen don't rebuild them needlessly. Parameter written tells if
+// the file was actually written.
+// Note: Can be called from worker threads.
+static bool writeIfChanged(QByteArray buf, const QString &filename, FileType fileType, bool *written = nullptr)
+{
+#ifdef Q_OS_WIN
+    // Use the same line endings as QIODevice::Text would, so content can be compared
+    if (fileType == FileType::Text)
+        buf.replace("\n", "\r\n");
+#else
+    Q_UNUSED(fileType);
+#endif
+    if (written)
+        *written = false;
+
+    QFile existingFile(filename);
+    if (existingFile.exists() && existingFile.size() == buf.size()
+            && existingFile.open(QIODevice::ReadOnly)) {
+        QCryptographicHash existingHash(QCryptographicHash::Sha256);
+        existingHash.addData(&existingFile);
+        if (existingHash.result() == QCryptographicHash::hash(buf, QCryptographicHash::Sha256))
+            return true;
+        existingFile.close();
+    }
+
+    QDir().mkpath(QFileInfo(filename).path());
+    if (!writeToSaveFile(buf, filename))
+        return false;
+    if (written)
+        *written = true;
+    return true;
+}
+
+// Reads the whole file into data. Returns false if file can't be read.
+static bool readFileData(const QString &filename, QByteArray &data)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    data = file.readAll();
+    return true;
+}
+
 static void removeIfExists(const QString &filePath)
 {
     QFile file(filePath);
@@ -44,10 +115,95 @@ static void removeIfExists(const QString &filePath)
         file.remove();
 }
 
+// Returns the path of the binary (CBOR) cache file stored next to the project file.
+// E.g. "C:/effects/MyEffect.qep" -> "C:/effects/MyEffect.qepc"
+static QString projectCacheFilePath(const QString &projectFilePath)
+{
+    return projectFilePath + QLatin1Char('c');
+}
+
+// Project data is read either from JSON or from the binary (CBOR) project
+// cache, so the readers take both QJsonObject and QCborMap. These return
+// the object value of the matching type.
+static QJsonObject objectValue(const QJsonValue &value)
+{
+    return value.toObject();
+}
+
+static QCborMap objectValue(const QCborValue &value)
+{
+    return value.toMap();
+}
+
+static QJsonObject toJsonObject(const QJsonObject &object)
+{
+    return object;
+}
+
+static QJsonObject toJsonObject(const QCborMap &map)
+{
+    return map.toJsonObject();
+}
+
+// Code is stored into JSON as an array of lines, to keep it readable and
+// diffable. Returns the code joined from such an array, or the string as-is
+// when the code is stored as a single string (binary project cache).
+template <typename Value>
+static QString codeFromJsonValue(const Value &codeValue)
+{
+    if (codeValue.isString())
+        return codeValue.toString();
+
+    QString codeString;
+    const auto codeArray = codeValue.toArray();
+    for (const auto& element : codeArray) {
+        codeString += element.toString();
+        codeString += '\n';
+    }
+    codeString.chop(1); // Remove last '\n'
+    return codeString;
+}
+
+template <typename Value>
+static bool isCodeValue(const Value &codeValue)
+{
+    return codeValue.isArray() || codeValue.isString();
+}
+
+// Returns project JSON where code arrays of the nodes and headings
+// are replaced with single strings. Used for the binary project cache.
+static QJsonObject projectJsonWithCodeStrings(const QJsonObject &rootJson)
+{
+    static const QStringList codeKeys = { "fragmentCode", "vertexCode", "qmlCode" };
+    QJsonObject json = rootJson["QEP"].toObject();
+    if (json.contains("nodes")) {
+        QJsonArray nodesArray = json["nodes"].toArray();
+        for (qsizetype i = 0; i < nodesArray.size(); ++i) {
+            QJsonObject nodeObject = nodesArray.at(i).toObject();
+            for (const auto &key : codeKeys) {
+                if (nodeObject.contains(key))
+                    nodeObject.insert(key, codeFromJsonValue(std::as_const(nodeObject)[key]));
+            }
+            nodesArray.replace(i, nodeObject);
+        }
+        json.insert("nodes", nodesArray);
+    }
+    if (json.contains("settings")) {
+        QJsonObject settingsObject = json["settings"].toObject();
+        if (settingsObject.contains("headings"))
+            settingsObject.insert("headings", codeFromJsonValue(std::as_const(settingsObject)["headings"]));
+        json.insert("settings", settingsObject);
+    }
+    QJsonObject compactJson;
+    compactJson.insert("QEP", json);
+    return compactJson;
+}
+
 // Returns the boolean value of QJsonValue. It can be either boolean
 // (true, false) or string ("true", "false"). Returns the defaultValue
 // if QJsonValue is undefined, empty, or some other type.
-static bool getBoolValue(const QJsonValue &jsonValue, bool defaultValue)
+template <typename Value>
+static bool getBoolValue(const Value &jsonValue, bool defaultValue)
 {
     bool returnValue = defaultValue;
     if (jsonValue.isBool()) {
@@ -68,6 +224,11 @@ EffectManager::EffectManager(QObject *parent) : QObject(parent)
     setUniformModel(new UniformModel(this));
     m_addNodeModel = new AddNodeModel(this);
     m_codeHelper = new CodeHelper(this);
+    m_symbolIndex = new GlslSymbolIndex(this);
+    connect(m_symbolIndex, &GlslSymbolIndex::nodeIndexed, this, [this](int nodeId) {
+        m_codeHelper->updateNodeSymbols(nodeId, m_symbolIndex->nodeSymbols(nodeId));
+    });
+    connect(m_symbolIndex, &GlslSymbolIndex::nodeRemoved, m_codeHelper, &CodeHelper::removeNodeSymbols);
 
     m_vertexShaderFile.setFileTemplate(QDir::tempPath() + "/qqem_XXXXXX.vert.qsb");
     m_fragmentShaderFile.setFileTemplate(QDir::tempPath() + "/qqem_XXXXXX.frag.qsb");
@@ -82,6 +243,8 @@ EffectManager::EffectManager(QObject *parent) : QObject(parent)
 
     // Prepare baker
     m_baker.setGeneratedShaderVariants({ QShader::StandardShader });
+    m_probeBaker.setGeneratedShaderVariants({ QShader::StandardShader });
+    m_probeBaker.setGeneratedShaders({ { QShader::SpirvShader, QShaderVersion(100) } });
     updateBakedShaderVersions();
 
     m_shaderBakerTimer.setInterval(1000);
@@ -90,6 +253,31 @@ EffectManager::EffectManager(QObject *parent) : QObject(parent)
 
     m_settings->updateRecentProjectsModel();
 
+    connect(&m_projectSaveWatcher, &QFutureWatcher<ProjectSaveResult>::finished,
+            this, &EffectManager::handleProjectSaved);
+    connect(&m_autoSaveTimer, &QTimer::timeout, this, &EffectManager::autoSaveProject);
+    updateAutoSaveTimer();
+    // Make sure that the last save is written before quitting
+    connect(qApp, &QCoreApplication::aboutToQuit, this, [this]() {
+        m_projectSaveWatcher.waitForFinished();
+        if (m_pendingProjectSave) {
+            m_pendingProjectSave = false;
+            const ProjectSaveJob &job = m_pendingProjectSaveJob;
+            writeProjectFiles(job.projectFilePath, job.rootJson, job.previousHash);
+        }
+        m_projectLoadWatcher.waitForFinished();
+    });
+
+    connect(&m_projectLoadWatcher, &QFutureWatcher<ProjectLoadData>::finished,
+            this, &EffectManager::handleProjectLoaded);
+    connect(&m_projectLoadWatcher, &QFutureWatcher<ProjectLoadData>::progressValueChanged,
+            this, [this](int value) {
+        const int minimum = m_projectLoadWatcher.progressMinimum();
+        const int maximum = m_projectLoadWatcher.progressMaximum();
+        m_projectLoadProgress = (maximum > minimum) ? qreal(value - minimum) / (maximum - minimum) : 0.0;
+        Q_EMIT projectLoadProgressChanged();
+    });
+
     connect(m_uniformModel, &UniformModel::qmlComponentChanged, this, [this]() {
         updateCustomUniforms();
         updateQmlComponent();
@@ -98,6 +286,7 @@ EffectManager::EffectManager(QObject *parent) : QObject(parent)
     });
     connect(m_uniformModel, &UniformModel::uniformsChanged, this, [this]() {
         updateImageWatchers();
+        m_codeHelper->updateUniformSymbols(m_uniformTable);
         bakeShaders();
     });
     connect(m_uniformModel, &UniformModel::addFSCode, this, [this](const QString &code) {
@@ -179,6 +368,8 @@ bool EffectManager::unsavedChanges() const
 
 void EffectManager::setUnsavedChanges(bool newUnsavedChanges)
 {
+    if (newUnsavedChanges)
+        m_projectRevision++;
     if (m_unsavedChanges == newUnsavedChanges || m_firstBake)
         return;
     m_unsavedChanges = newUnsavedChanges;
@@ -264,7 +455,21 @@ QString EffectManager::processVertexRootLine(const QString &line)
         lineList.removeFirst();
         QString outLine = lineList.join(' ');
         m_shaderVaryingVariables << outLine;
+        // Varyings inside preprocessor conditions are declared with the same conditions
+        QStringList conditions;
+        for (const auto &levelConditions : std::as_const(m_vertexRootConditions))
+            conditions << levelConditions;
+        if (!conditions.isEmpty())
+            m_shaderVaryingConditions.insert(outLine, conditions);
     } else {
+        const QString trimmed = line.trimmed();
+        if (trimmed.startsWith(QLatin1String("#if")))
+            m_vertexRootConditions << QStringList(trimmed);
+        else if ((trimmed.startsWith(QLatin1String("#elif")) || trimmed.startsWith(QLatin1String("#else")))
+                 && !m_vertexRootConditions.isEmpty())
+            m_vertexRootConditions.last() << trimmed;
+        else if (trimmed.startsWith(QLatin1String("#endif")) && !m_vertexRootConditions.isEmpty())
+            m_vertexRootConditions.removeLast();
         output = line + '\n';
     }
     return output;
@@ -290,12 +495,417 @@ QString EffectManager::getCustomShaderVaryings(bool outState)
     QString direction = outState ?  QStringLiteral("out") :  QStringLiteral("in");
     int varLocation = m_shaderFeatures.enabled(ShaderFeatures::FragCoord) ? 2 : 1;
     for (const auto &var : m_shaderVaryingVariables) {
+        const QStringList conditions = m_shaderVaryingConditions.value(var);
+        for (const auto &condition : conditions)
+            output += condition + '\n';
         output += QString("layout(location = %1) %2 %3\n").arg(QString::number(varLocation), direction, var);
+        for (const auto &condition : conditions) {
+            if (condition.startsWith(QLatin1String("#if")))
+                output += QStringLiteral("#endif\n");
+        }
         varLocation++;
     }
     return output;
 }
 
+// Returns the main part of the node code, after the "@main" tag
+QString EffectManager::getNodeMainCode(const QStringList &code, int mainIndex)
+{
+    QString s;
+    int line = 0;
+    for (const auto &ss : code) {
+        if (mainIndex == -1 || line > mainIndex)
+            s += QStringLiteral("    ") + ss + '\n';
+        line++;
+    }
+    return s;
+}
+
+// Finds the fragment shader expressions which depend only on uniforms,
+// constants or linearly on texCoord. These are calculated in the vertex
+// shader and passed as varyings, within the available varying locations.
+void EffectManager::updateHoistedExpressions()
+{
+    m_hoistedExpressions.clear();
+    if (!m_hoistExpressions || !m_nodeView->nodeGraphComplete())
+        return;
+
+    QSet<QString> uniforms = { QStringLiteral("qt_Opacity") };
+    if (m_shaderFeatures.enabled(ShaderFeatures::Time))
+        uniforms << QStringLiteral("iTime");
+    if (m_shaderFeatures.enabled(ShaderFeatures::Frame))
+        uniforms << QStringLiteral("iFrame");
+    if (m_shaderFeatures.enabled(ShaderFeatures::Resolution))
+        uniforms << QStringLiteral("iResolution");
+    if (m_shaderFeatures.enabled(ShaderFeatures::Mouse))
+        uniforms << QStringLiteral("iMouse");
+    QSet<QString> constants;
+    for (const auto &uniform : m_uniformTable) {
+        if (!m_nodeView->m_activeNodesIds.contains(uniform.nodeId))
+            continue;
+        if (uniform.type == UniformModel::Uniform::Type::Define || !uniform.exportProperty)
+            constants << uniform.name;
+        else if (uniform.type != UniformModel::Uniform::Type::Sampler && isUniformUsed(uniform))
+            uniforms << uniform.name;
+    }
+
+    // texCoord uses the first location and fragCoord the second one
+    int usedVaryings = m_shaderFeatures.enabled(ShaderFeatures::FragCoord) ? 2 : 1;
+    usedVaryings += m_shaderVaryingVariables.size();
+    const int maxVaryings = m_settings->useLegacyShaders() ? MAX_VARYINGS_LEGACY : MAX_VARYINGS;
+    for (auto n : m_nodeView->m_activeNodesList) {
+        if (n->type != 2 || n->disabled || n->fragmentCode.isEmpty())
+            continue;
+        const QStringList fragmentCode = n->fragmentCode.split('\n');
+        const int mainIndex = getTagIndex(fragmentCode, QStringLiteral("main"));
+        const QString mainCode = removeTagsFromCode(getNodeMainCode(fragmentCode, mainIndex));
+        const int hoistedCount = int(m_hoistedExpressions.size());
+        const int freeVaryings = maxVaryings - usedVaryings - hoistedCount;
+        m_hoistedExpressions << ExpressionHoister::findHoistable(mainCode, n->nodeId, uniforms, constants,
+                                                                 freeVaryings, hoistedCount);
+    }
+}
+
+// Returns filename of the baked function texture
+// e.g. "MyEffect", "cloudNoise" -> "myeffect_cloudnoise.png".
+QString EffectManager::bakedFunctionFilename(const QString &filename, const FunctionBaker::Function &function)
+{
+    return QString("%1_%2.png").arg(filename, function.name).toLower();
+}
+
+// Returns the root parts of the fragment shader code of the nodes,
+// before the "@main" tag
+QString EffectManager::getFragmentRootCode()
+{
+    QString s;
+    for (auto n : m_nodeView->m_activeNodesList) {
+        if (n->type != 2 || n->disabled || n->fragmentCode.isEmpty())
+            continue;
+        QStringList fragmentCode = n->fragmentCode.split('\n');
+        int mainIndex = getTagIndex(fragmentCode, QStringLiteral("main"));
+        for (int line = 0; line < mainIndex; line++)
+            s += processFragmentRootLine(fragmentCode.at(line));
+    }
+    return s;
+}
+
+// Returns the declarations of fragment shader evaluated offscreen with
+// the given root code. Properties are used as constants with their current values.
+QString EffectManager::getBakeShaderHeader(const QString &rootCode)
+{
+    QString s;
+    s += "#version 440\n";
+    s += '\n';
+    s += "layout(location = 0) in vec2 texCoord;\n";
+    s += "layout(location = 0) out vec4 fragColor;\n";
+    s += '\n';
+    s += getDefineProperties();
+    s += getConstVariables();
+    for (auto &uniform : m_uniformTable) {
+        if (!m_nodeView->m_activeNodesIds.contains(uniform.nodeId))
+            continue;
+        if (uniform.exportProperty &&
+                uniform.type != UniformModel::Uniform::Type::Sampler &&
+                uniform.type != UniformModel::Uniform::Type::Define) {
+            QString constValue = m_uniformModel->valueAsVariable(uniform);
+            QString type = m_uniformModel->typeToUniform(uniform.type);
+            s += QString("const %1 %2 = %3;\n").arg(type, uniform.name, constValue);
+        }
+    }
+    s += '\n';
+    s += removeTagsFromCode(rootCode) + '\n';
+    return s;
+}
+
+// Returns fragment shader which evaluates the function marked with "@bake".
+// Only the root functions which the function depends on are included, the
+// others may use samplers or varyings which are not available when baking.
+QString EffectManager::getBakeShader(const FunctionBaker::Function &function)
+{
+    const QString rootCode = FunctionBaker::dependencyCode(getFragmentRootCode(), function.name);
+    return getBakeShaderHeader(rootCode) + FunctionBaker::shaderMain(function);
+}
+
+// Renders the functions marked with "@bake" into images
+QList<QPair<FunctionBaker::Function, QImage>> EffectManager::bakeFunctions()
+{
+    QList<QPair<FunctionBaker::Function, QImage>> bakedFunctions;
+    if (!m_nodeView->nodeGraphComplete())
+        return bakedFunctions;
+    const auto functions = FunctionBaker::findFunctions(getFragmentRootCode().split('\n'));
+    for (const auto &function : functions) {
+        QString error;
+        const QImage image = FunctionBaker::render(getBakeShader(function), function.size, m_generatedShaders, &error);
+        if (image.isNull()) {
+            qWarning("Unable to bake function '%s': %s", qPrintable(function.name), qPrintable(error));
+            continue;
+        }
+        bakedFunctions << qMakePair(function, image.convertToFormat(QImage::Format_RGB888));
+    }
+    return bakedFunctions;
+}
+
+// Returns filename of the fused color LUT texture
+// e.g. "MyEffect", 1 -> "myeffect_colorlut1.png".
+QString EffectManager::fusedColorLutFilename(const QString &filename, int index)
+{
+    return QString("%1_colorlut%2.png").arg(filename).arg(index).toLower();
+}
+
+// Finds the runs of consecutive nodes which only adjust the color, and
+// renders each run into a 3D LUT image. Properties of the fused nodes
+// keep their current values.
+QList<QPair<ColorLutFuser::Run, QImage>> EffectManager::fuseColorNodes()
+{
+    QList<QPair<ColorLutFuser::Run, QImage>> fusedRuns;
+    if (!m_nodeView->nodeGraphComplete())
+        return fusedRuns;
+
+    // Identifiers which vary per fragment or per frame
+    QSet<QString> positionDependent = {
+        QStringLiteral("texCoord"), QStringLiteral("fragCoord"), QStringLiteral("gl_FragCoord"),
+        QStringLiteral("qt_Opacity"), QStringLiteral("iTime"), QStringLiteral("iFrame"),
+        QStringLiteral("iMouse"), QStringLiteral("iResolution"), QStringLiteral("iSource")
+    };
+    for (int i = 1; i <= 5; i++)
+        positionDependent << QString("iSourceBlur%1").arg(i);
+    for (const auto &uniform : m_uniformTable) {
+        if (uniform.type == UniformModel::Uniform::Type::Sampler)
+            positionDependent << uniform.name;
+    }
+    for (const auto &varying : m_shaderVaryingVariables) {
+        QString name = varying.simplified().split(' ').last();
+        name.chop(1);
+        positionDependent << name;
+    }
+
+    // Root code functions which don't depend on the position are
+    // usable from the fused nodes
+    struct NodeCode {
+        NodesModel::Node *node;
+        QString rootCode;
+        QString mainCode;
+    };
+    QList<NodeCode> nodes;
+    QSet<QString> pureFunctions;
+    QString pureRootCode;
+    for (auto n : m_nodeView->m_activeNodesList) {
+        if (n->type != 2 || n->disabled || n->fragmentCode.isEmpty())
+            continue;
+        const QStringList fragmentCode = n->fragmentCode.split('\n');
+        const int mainIndex = getTagIndex(fragmentCode, QStringLiteral("main"));
+        NodeCode code;
+        code.node = n;
+        code.rootCode = fragmentCode.mid(0, std::max(mainIndex, 0)).join('\n');
+        code.mainCode = removeTagsFromCode(getNodeMainCode(fragmentCode, mainIndex));
+        const QSet<QString> rootFunctions = ColorLutFuser::definedFunctions(code.rootCode);
+        if (ColorLutFuser::isColorOnly(code.rootCode, positionDependent, pureFunctions + rootFunctions)) {
+            pureFunctions.unite(rootFunctions);
+            for (const auto &line : code.rootCode.split('\n'))
+                pureRootCode += processFragmentRootLine(line);
+        }
+        nodes << code;
+    }
+
+    QList<ColorLutFuser::Run> runs;
+    ColorLutFuser::Run run;
+    auto endRun = [&runs, &run]() {
+        if (run.nodeIds.size() >= ColorLutFuser::MinRunLength)
+            runs << run;
+        run = ColorLutFuser::Run();
+    };
+    // Identifiers used by the main code of the nodes after each node
+    QList<QSet<QString>> usedAfter(nodes.size());
+    for (qsizetype i = nodes.size() - 2; i >= 0; i--)
+        usedAfter[i] = usedAfter.at(i + 1) + ColorLutFuser::usedIdentifiers(nodes.at(i + 1).mainCode);
+    for (qsizetype i = 0; i < nodes.size(); i++) {
+        const NodeCode &code = nodes.at(i);
+        // Nodes with only root code (helpers) don't change the color
+        if (code.mainCode.trimmed().isEmpty())
+            continue;
+        if (!ColorLutFuser::isColorOnly(code.mainCode, positionDependent, pureFunctions)) {
+            endRun();
+            continue;
+        }
+        // Variables declared by the fused code are not available for the later nodes
+        if (ColorLutFuser::declaredVariables(code.mainCode).intersects(usedAfter.at(i))) {
+            endRun();
+            continue;
+        }
+        run.nodeIds << code.node->nodeId;
+        run.nodeNames << code.node->name;
+        run.code += code.mainCode;
+    }
+    endRun();
+
+    const QString header = getBakeShaderHeader(pureRootCode);
+    const QSize lutSize(ColorLutFuser::LutSize, ColorLutFuser::LutSize);
+    for (auto &fusedRun : runs) {
+        fusedRun.samplerName = QString("iFusedColorLUT%1").arg(fusedRuns.size() + 1);
+        // Rendering also translucent colors catches the nodes which change
+        // alpha or don't handle premultiplied colors
+        QString error;
+        const QImage lut = FunctionBaker::render(header + ColorLutFuser::shaderMain(fusedRun, 1.0f),
+                                                 lutSize, m_generatedShaders, &error);
+        const QImage translucentLut = lut.isNull() ? QImage()
+                : FunctionBaker::render(header + ColorLutFuser::shaderMain(fusedRun, 0.5f),
+                                        lutSize, m_generatedShaders, &error);
+        if (lut.isNull() || translucentLut.isNull()) {
+            qWarning("Unable to fuse nodes '%s': %s", qPrintable(fusedRun.nodeNames.join(", ")), qPrintable(error));
+            continue;
+        }
+        if (!ColorLutFuser::isAlphaIndependent(lut, translucentLut)) {
+            qWarning("Nodes '%s' not fused, they depend on the alpha", qPrintable(fusedRun.nodeNames.join(", ")));
+            continue;
+        }
+        fusedRuns << qMakePair(fusedRun, lut.convertToFormat(QImage::Format_RGB888));
+    }
+    return fusedRuns;
+}
+
+// Adds the textures generated during the export into ShaderEffect,
+// as pairs of sampler name and image filename.
+void EffectManager::addGeneratedImagesToQml(QStringList &qmlLines, const QList<QPair<QString, QString>> &images)
+{
+    const int effectIndex = qmlLines.indexOf(QStringLiteral("    ShaderEffect {"));
+    if (effectIndex < 0)
+        return;
+    for (const auto &image : images) {
+        // e.g. "iBakedNoise" -> "bakedNoiseImage"
+        QString elementName = image.first.mid(1) + "Image";
+        elementName[0] = elementName[0].toLower();
+        const QStringList imageLines = {
+            QString("        readonly property Item %1: %2").arg(image.first, elementName),
+            "        Image {",
+            QString("            id: %1").arg(elementName),
+            "            anchors.fill: parent",
+            QString("            source: \"%1\"").arg(image.second),
+            "            visible: false",
+            "        }"
+        };
+        for (int j = 0; j < imageLines.size(); j++)
+            qmlLines.insert(effectIndex + 1 + j, imageLines.at(j));
+    }
+}
+
+// Updates the changed nodes into the symbol index, and removes the deleted ones
+void EffectManager::updateNodesSymbolIndex()
+{
+    QList<int> nodeIds;
+    for (const auto &node : std::as_const(m_nodeView->m_nodesModel->m_nodesList)) {
+        m_symbolIndex->updateNode(node.nodeId, node.vertexCode, node.fragmentCode);
+        nodeIds << node.nodeId;
+    }
+    m_symbolIndex->removeOtherNodes(nodeIds);
+}
+
+// Finds the definition of the symbol, or with nextUsage the usage after the
+// given editor stage and line. Selects the node of the symbol and returns
+// its stage and line, or an empty map when the symbol isn't in the nodes.
+QVariantMap EffectManager::goToSymbol(const QString &name, int stage, int line, bool nextUsage)
+{
+    if (!m_nodeView || name.isEmpty())
+        return QVariantMap();
+
+    const int selectedNodeId = m_nodeView->m_selectedNodeId;
+    QList<GlslSymbolIndex::Location> locations;
+    if (nextUsage) {
+        const auto usages = m_symbolIndex->findUsages(name);
+        // Continue from the start after the last usage
+        auto isAfterCurrent = [&](const GlslSymbolIndex::Location &l) {
+            if (l.nodeId != selectedNodeId)
+                return l.nodeId > selectedNodeId;
+            if (l.stage != stage)
+                return l.stage > stage;
+            return l.line > line;
+        };
+        for (const auto &usage : usages) {
+            if (usage.nodeId != GlslSymbolIndex::BuiltInNodeId && isAfterCurrent(usage))
+                locations << usage;
+        }
+        for (const auto &usage : usages) {
+            if (usage.nodeId != GlslSymbolIndex::BuiltInNodeId)
+                locations << usage;
+        }
+    } else {
+        const auto definitions = m_symbolIndex->findDefinitions(name);
+        for (const auto &definition : definitions) {
+            if (definition.location.nodeId == selectedNodeId)
+                locations.prepend(definition.location);
+            else if (definition.location.nodeId != GlslSymbolIndex::BuiltInNodeId)
+                locations << definition.location;
+        }
+    }
+    if (locations.isEmpty())
+        return QVariantMap();
+
+    const auto location = locations.first();
+    if (location.nodeId != selectedNodeId)
+        m_nodeView->selectSingleNode(location.nodeId);
+    QVariantMap result;
+    result["stage"] = location.stage;
+    result["line"] = location.line;
+    return result;
+}
+
+// Adds the sampler images of the effect into GPU memory estimate. When
+// exportFlags contains compressed images, these are estimated as KTX textures.
+void EffectManager::addImagesToGpuMemory(GpuMemoryEstimator &estimator, int exportFlags, const ImageAtlas &imageAtlas)
+{
+    const bool compressImages = (exportFlags & Images) && (exportFlags & (CompressedImagesETC2 | CompressedImagesBC));
+    auto compressedFormat = [exportFlags](bool hasAlpha) {
+        if (exportFlags & CompressedImagesBC)
+            return hasAlpha ? GpuMemoryEstimator::Format::BC3 : GpuMemoryEstimator::Format::BC1;
+        return hasAlpha ? GpuMemoryEstimator::Format::ETC2Alpha : GpuMemoryEstimator::Format::ETC2;
+    };
+    QStringList packedImages;
+    for (const auto &entry : imageAtlas.entries())
+        packedImages << entry.name;
+    if (!imageAtlas.isEmpty()) {
+        const QImage atlasImage = imageAtlas.atlasImage();
+        estimator.addTexture(QStringLiteral("Image atlas"), atlasImage.size(),
+                             compressImages ? compressedFormat(atlasImage.hasAlphaChannel())
+                                            : GpuMemoryEstimator::Format::RGBA8, false);
+    }
+    for (const auto &uniform : std::as_const(m_uniformTable)) {
+        if (uniform.type != UniformModel::Uniform::Type::Sampler || uniform.value.toString().isEmpty()
+                || !m_nodeView->m_activeNodesIds.contains(uniform.nodeId) || !isUniformUsed(uniform)
+                || packedImages.contains(uniform.name)) {
+            continue;
+        }
+        // Size and format are read from the header, without decoding the image
+        QImageReader reader(stripFileFromURL(uniform.value.toString()));
+        const QSize size = reader.size();
+        const bool hasAlpha = QImage::toPixelFormat(reader.imageFormat()).alphaUsage() == QPixelFormat::UsesAlpha;
+        estimator.addTexture(uniform.name, size,
+                             compressImages ? compressedFormat(hasAlpha) : GpuMemoryEstimator::Format::RGBA8,
+                             uniform.enableMipmap);
+    }
+}
+
+// Returns the estimated GPU memory of the preview effect. Source and
+// BlurHelper sizes are also used for the export estimate.
+QVariantMap EffectManager::gpuMemoryUsage(const QSize &sourceSize, int blurPixels)
+{
+    m_previewSourceSize = sourceSize;
+    m_previewBlurPixels = blurPixels;
+
+    GpuMemoryEstimator estimator;
+    // Preview source is a layer with mipmaps
+    estimator.addTexture(QStringLiteral("Source layer"), sourceSize, GpuMemoryEstimator::Format::RGBA8, true);
+    estimator.addPixels(QStringLiteral("BlurHelper layers"), blurPixels);
+    if (m_nodeView->nodeGraphComplete())
+        addImagesToGpuMemory(estimator, 0, ImageAtlas());
+
+    const qint64 budgetBytes = qint64(m_settings->gpuMemoryBudget()) * 1024 * 1024;
+    QVariantMap usage;
+    usage["totalBytes"] = estimator.totalBytes();
+    usage["total"] = GpuMemoryEstimator::formatBytes(estimator.totalBytes());
+    usage["overBudget"] = budgetBytes > 0 && estimator.totalBytes() > budgetBytes;
+    usage["report"] = estimator.report(budgetBytes).trimmed();
+    return usage;
+}
+
 // Remove all post-processing tags ("@tag") from the code.
 // Except "@nodes" tag as that is handled later.
 QStringList EffectManager::removeTagsFromCode(const QStringList &codeLines) {
@@ -347,6 +957,8 @@ QString EffectManager::generateVertexShader(bool includeUniforms) {
     QString s_main;
     QStringList s_sourceCode;
     m_shaderVaryingVariables.clear();
+    m_shaderVaryingConditions.clear();
+    m_vertexRootConditions.clear();
     if (m_nodeView->nodeGraphComplete()) {
         for (auto n : m_nodeView->m_activeNodesList) {
             if (!n->vertexCode.isEmpty() && !n->disabled) {
@@ -379,10 +991,23 @@ QString EffectManager::generateVertexShader(bool includeUniforms) {
         s_main = removeTagsFromCode(s_main);
     }
 
+    int nodesIndex = getTagIndex(s_sourceCode, QStringLiteral("nodes"));
+
+    // Hoisting is left out from the features check, and needs a place for the code
+    m_hoistedExpressions.clear();
+    if (removeTags && nodesIndex != -1)
+        updateHoistedExpressions();
+    if (!m_hoistedExpressions.isEmpty()) {
+        s_main += QStringLiteral("    // Hoisted from the fragment shader\n");
+        for (const auto &hoisted : std::as_const(m_hoistedExpressions)) {
+            m_shaderVaryingVariables << QString("%1 %2;").arg(hoisted.type, hoisted.varyingName);
+            s_main += QString("    %1 = %2;\n").arg(hoisted.varyingName, hoisted.expression);
+        }
+    }
+
     s += getCustomShaderVaryings(true);
     s += s_root + '\n';
 
-    int nodesIndex = getTagIndex(s_sourceCode, QStringLiteral("nodes"));
     int line = 0;
     for (const auto &ss : s_sourceCode) {
         if (line == nodesIndex)
@@ -420,17 +1045,19 @@ QString EffectManager::generateFragmentShader(bool includeUniforms) {
                 } else if (n->type == 2) {
                     QStringList fragmentCode = n->fragmentCode.split('\n');
                     int mainIndex = getTagIndex(fragmentCode, QStringLiteral("main"));
-                    int line = 0;
-                    for (const auto &ss : fragmentCode) {
-                        if (mainIndex == -1 || line > mainIndex)
-                            s_main += QStringLiteral("    ") + ss + '\n';
-                        else if (line < mainIndex)
-                            s_root += processFragmentRootLine(ss);
-                        line++;
+                    if (m_nodeMainCodeOverrides.contains(n->nodeId)) {
+                        s_main += m_nodeMainCodeOverrides.value(n->nodeId);
+                    } else if (m_hoistedExpressions.isEmpty()) {
+                        s_main += getNodeMainCode(fragmentCode, mainIndex);
+                    } else {
+                        // Hoisting ranges are based on the code without tags
+                        QString mainCode = removeTagsFromCode(getNodeMainCode(fragmentCode, mainIndex));
+                        s_main += ExpressionHoister::applyToCode(mainCode, n->nodeId, m_hoistedExpressions);
                     }
                 }
             }
         }
+        s_root = getFragmentRootCode();
     }
 
     if (s_sourceCode.isEmpty()) {
@@ -444,6 +1071,13 @@ QString EffectManager::generateFragmentShader(bool includeUniforms) {
         s_main = removeTagsFromCode(s_main);
     }
 
+    if (removeTags && useMipmapBlur()) {
+        // Blurred sources are sampled from the mipmaps with BlurHelper function
+        static const QRegularExpression blurSourceExp("\\btexture\\s*\\(\\s*iSourceBlur([1-5])\\s*,");
+        s_main.replace(blurSourceExp, QStringLiteral("blurHelperTexture(\\1.0,"));
+        s_root.replace(blurSourceExp, QStringLiteral("blurHelperTexture(\\1.0,"));
+    }
+
     s += getCustomShaderVaryings(false);
     s += s_root + '\n';
 
@@ -496,6 +1130,7 @@ void EffectManager::updateBakedShaderVersions()
         targets.append({ QShader::GlslShader, QShaderVersion(100, QShaderVersion::GlslEs) }); // GLES 2.0
         targets.append({ QShader::GlslShader, QShaderVersion(120) }); // OpenGL 2.1
     }
+    m_generatedShaders = targets;
     m_baker.setGeneratedShaders(targets);
 }
 
@@ -522,32 +1157,92 @@ void EffectManager::doBakeShaders()
 {
     // First update the features based on shader content
     // This will make sure that next calls to generate* will produce correct uniforms.
-    m_shaderFeatures.update(generateVertexShader(false), generateFragmentShader(false), m_previewEffectPropertiesString);
+    const QString featuresFragmentShader = generateFragmentShader(false);
+    m_shaderFeatures.update(generateVertexShader(false), featuresFragmentShader, m_previewEffectPropertiesString);
+    m_mipmapBlurSupported = isMipmapBlurSupported(featuresFragmentShader);
 
     updateCustomUniforms();
+    // Generated uniforms and varyings depend on the features
+    m_symbolIndex->updateNode(GlslSymbolIndex::BuiltInNodeId, getVSUniforms(), getFSUniforms());
 
-    setVertexShader(generateVertexShader());
-    QString vs = m_vertexShader;
+    // Blurred source properties of the component depend on the blur mode
+    if (m_mipmapBlur != useMipmapBlur()) {
+        m_mipmapBlur = useMipmapBlur();
+        updateQmlComponent();
+    }
+    if (!m_mipmapBlurSupported && blurHelperMipmapValue() == 1)
+        qWarning("BLUR_HELPER_MIPMAP ignored, blurred sources are used other than with texture(iSourceBlurN, uv)");
+
+    // Probe first with all the uniforms which ones the shaders use. Probe baker
+    // generates only SPIR-V, so this is much cheaper than the full bake.
+    m_keepUnusedUniforms = true;
+    m_hoistExpressions = true;
+    QString vs = generateVertexShader();
+    QString fs = generateFragmentShader();
+    m_probeBaker.setSourceString(vs.toUtf8(), QShader::VertexStage);
+    QShader vertProbe = m_probeBaker.bake();
+    const QString vertProbeError = m_probeBaker.errorMessage();
+    m_probeBaker.setSourceString(fs.toUtf8(), QShader::FragmentStage);
+    QShader fragProbe = m_probeBaker.bake();
+    const QString fragProbeError = m_probeBaker.errorMessage();
+    if ((!vertProbe.isValid() && isHoistingError(vs, vertProbeError)) ||
+            (!fragProbe.isValid() && isHoistingError(fs, fragProbeError))) {
+        // Hoisted expression can still fail to compile in the vertex shader, e.g.
+        // when it uses a macro which is defined only in the fragment shader.
+        // Errors in the other lines are not caused by hoisting, so those don't
+        // need another probe.
+        m_hoistExpressions = false;
+        vs = generateVertexShader();
+        fs = generateFragmentShader();
+        m_probeBaker.setSourceString(vs.toUtf8(), QShader::VertexStage);
+        vertProbe = m_probeBaker.bake();
+        m_probeBaker.setSourceString(fs.toUtf8(), QShader::FragmentStage);
+        fragProbe = m_probeBaker.bake();
+    }
+    m_keepUnusedUniforms = false;
+
+    // Then bake all the targets once, leaving out the unused uniforms
+    m_unusedUniforms.clear();
+    if (vertProbe.isValid() && fragProbe.isValid())
+        m_unusedUniforms = findUnusedUniforms(vertProbe, fragProbe);
+    if (!m_unusedUniforms.isEmpty()) {
+        vs = generateVertexShader();
+        fs = generateFragmentShader();
+    }
     m_baker.setSourceString(vs.toUtf8(), QShader::VertexStage);
-
     QShader vertShader = m_baker.bake();
+    QString vertError = m_baker.errorMessage();
+    m_baker.setSourceString(fs.toUtf8(), QShader::FragmentStage);
+    QShader fragShader = m_baker.bake();
+    QString fragError = m_baker.errorMessage();
+    if ((!vertShader.isValid() || !fragShader.isValid()) && !m_unusedUniforms.isEmpty()) {
+        // Pruned shaders fail e.g. when the uniform is referenced in a function
+        // which is never called, so keep all the uniforms then
+        m_unusedUniforms.clear();
+        vs = generateVertexShader();
+        fs = generateFragmentShader();
+        m_baker.setSourceString(vs.toUtf8(), QShader::VertexStage);
+        vertShader = m_baker.bake();
+        vertError = m_baker.errorMessage();
+        m_baker.setSourceString(fs.toUtf8(), QShader::FragmentStage);
+        fragShader = m_baker.bake();
+        fragError = m_baker.errorMessage();
+    }
+
+    setVertexShader(vs);
     if (!vertShader.isValid()) {
-        qWarning() << "Shader baking failed:" << qPrintable(m_baker.errorMessage());
-        setEffectError(m_baker.errorMessage().split('\n').first(), ErrorVert);
+        qWarning() << "Shader baking failed:" << qPrintable(vertError);
+        setEffectError(vertError.split('\n').first(), ErrorVert);
     } else {
         QString filename = m_vertexShaderFile.fileName();
         writeToFile(vertShader.serialized(), filename, FileType::Binary);
         resetEffectError(ErrorVert);
     }
 
-    setFragmentShader(generateFragmentShader());
-    QString fs = m_fragmentShader;
-    m_baker.setSourceString(fs.toUtf8(), QShader::FragmentStage);
-
-    QShader fragShader = m_baker.bake();
+    setFragmentShader(fs);
     if (!fragShader.isValid()) {
-        qWarning() << "Shader baking failed:" << qPrintable(m_baker.errorMessage());
-        setEffectError(m_baker.errorMessage().split('\n').first(), ErrorFrag);
+        qWarning() << "Shader baking failed:" << qPrintable(fragError);
+        setEffectError(fragError.split('\n').first(), ErrorFrag);
     } else {
         QString filename = m_fragmentShaderFile.fileName();
         writeToFile(fragShader.serialized(), filename, FileType::Binary);
@@ -561,6 +1256,55 @@ void EffectManager::doBakeShaders()
     m_firstBake = false;
 }
 
+// Returns true when the baker errorMessage of shader points to
+// a line which uses the hoisted expressions.
+bool EffectManager::isHoistingError(const QString &shader, const QString &errorMessage) const
+{
+    if (m_hoistedExpressions.isEmpty())
+        return false;
+    // Errors are something like "ERROR: :15: message"
+    static const QRegularExpression errorLineExp("ERROR: [^:]*:(\\d+):");
+    const QStringList lines = shader.split('\n');
+    auto it = errorLineExp.globalMatch(errorMessage);
+    while (it.hasNext()) {
+        const int lineIndex = it.next().captured(1).toInt() - 1;
+        if (lineIndex < 0 || lineIndex >= lines.size())
+            continue;
+        for (const auto &hoisted : std::as_const(m_hoistedExpressions)) {
+            if (lines.at(lineIndex).contains(hoisted.varyingName))
+                return true;
+        }
+    }
+    return false;
+}
+
+// Returns the exported uniforms which the baked shaders don't use. These
+// are left out from the shaders, properties of the QML component are kept.
+QSet<QString> EffectManager::findUnusedUniforms(const QShader &vertShader, const QShader &fragShader) const
+{
+    const QShaderKey spirvKey(QShader::SpirvShader, QShaderVersion(100));
+    QSet<QString> usedUniforms;
+    if (!SpirvUsage::usedUniforms(vertShader.shader(spirvKey).shader(), "buf", &usedUniforms) ||
+            !SpirvUsage::usedUniforms(fragShader.shader(spirvKey).shader(), "buf", &usedUniforms))
+        return QSet<QString>();
+
+    QSet<QString> unusedUniforms;
+    for (const auto &uniform : m_uniformTable) {
+        if (!m_nodeView->m_activeNodesIds.contains(uniform.nodeId))
+            continue;
+        if (!uniform.exportProperty || uniform.type == UniformModel::Uniform::Type::Define)
+            continue;
+        if (!usedUniforms.contains(uniform.name))
+            unusedUniforms.insert(uniform.name);
+    }
+    return unusedUniforms;
+}
+
+bool EffectManager::isUniformUsed(const UniformModel::Uniform &uniform) const
+{
+    return m_keepUnusedUniforms || !m_unusedUniforms.contains(uniform.name);
+}
+
 const QString EffectManager::getBufUniform()
 {
     QString s;
@@ -578,7 +1322,7 @@ const QString EffectManager::getBufUniform()
     for (auto &uniform : m_uniformTable) {
         if (!m_nodeView->m_activeNodesIds.contains(uniform.nodeId))
             continue;
-        if (uniform.exportProperty &&
+        if (uniform.exportProperty && isUniformUsed(uniform) &&
                 uniform.type != UniformModel::Uniform::Type::Sampler &&
                 uniform.type != UniformModel::Uniform::Type::Define) {
             QString type = m_uniformModel->typeToUniform(uniform.type);
@@ -608,6 +1352,37 @@ const QString EffectManager::getVSUniforms()
     return s;
 }
 
+// Returns the value of BLUR_HELPER_MIPMAP define, 0 when BlurHelper isn't used
+int EffectManager::blurHelperMipmapValue() const
+{
+    if (!m_shaderFeatures.enabled(ShaderFeatures::BlurSources))
+        return 0;
+    for (const auto &uniform : m_uniformTable) {
+        if (uniform.name == QLatin1String("BLUR_HELPER_MIPMAP")
+                && m_nodeView->m_activeNodesIds.contains(uniform.nodeId)) {
+            return uniform.value.toInt();
+        }
+    }
+    return 0;
+}
+
+// Returns true when BlurHelper samples the blurred sources from
+// mipmaps of a single layer, instead of separate blurred layers.
+bool EffectManager::useMipmapBlur() const
+{
+    return m_mipmapBlurSupported && blurHelperMipmapValue() == 1;
+}
+
+// Returns true when the blurred sources are only used with texture(iSourceBlurN, uv),
+// which can be replaced with the mipmap sampling. Other uses, like textureLod() or
+// passing the sampler to a function, need the separate blurred layers.
+bool EffectManager::isMipmapBlurSupported(const QString &fragmentShader) const
+{
+    static const QRegularExpression blurSourceExp("\\biSourceBlur[1-5]\\b");
+    static const QRegularExpression blurTextureExp("\\btexture\\s*\\(\\s*iSourceBlur[1-5]\\s*,");
+    return fragmentShader.count(blurSourceExp) == fragmentShader.count(blurTextureExp);
+}
+
 const QString EffectManager::getFSUniforms()
 {
     QString s;
@@ -630,7 +1405,7 @@ const QString EffectManager::getFSUniforms()
     for (auto &uniform : m_uniformTable) {
         if (!m_nodeView->m_activeNodesIds.contains(uniform.nodeId))
             continue;
-        if (uniform.type == UniformModel::Uniform::Type::Sampler) {
+        if (uniform.type == UniformModel::Uniform::Type::Sampler && isUniformUsed(uniform)) {
             // Start index from 2, 1 is source item
             QString props = QString("layout(binding = %1) uniform sampler2D %2").arg(bindingIndex).arg(uniform.name);
             s += props + ";\n";
@@ -638,7 +1413,11 @@ const QString EffectManager::getFSUniforms()
         }
     }
     s += '\n';
-    if (m_shaderFeatures.enabled(ShaderFeatures::BlurSources)) {
+    if (useMipmapBlur()) {
+        s += QString("layout(binding = %1) uniform sampler2D iSourceBlurMipmap;\n").arg(bindingIndex);
+        bindingIndex++;
+        s += '\n';
+    } else if (m_shaderFeatures.enabled(ShaderFeatures::BlurSources)) {
         const int blurItems = 5;
         for (int i = 1; i <= blurItems; i++) {
             QString props = QString("layout(binding = %1) uniform sampler2D iSourceBlur%2")
@@ -788,8 +1567,11 @@ void EffectManager::updateCustomUniforms()
                     // When exporting image is disabled, remove value from root property
                     valueString.clear();
                 }
-                exportedRootPropertiesString += "    property " + type + " " + propertyName + valueString + '\n';
-                exportedEffectPropertiesString += QStringLiteral("        ") + readOnly + "property alias " + propertyName + ": rootItem." + uniform.name + '\n';
+                // Exported properties are typed (images as Item instead of var) and bound
+                // to the root properties, so these compile with the Qt Quick Compiler.
+                const QString exportedType = isImage ? QStringLiteral("Item") : type;
+                exportedRootPropertiesString += "    property " + exportedType + " " + propertyName + valueString + '\n';
+                exportedEffectPropertiesString += QStringLiteral("        ") + readOnly + "property " + exportedType + " " + propertyName + ": rootItem." + uniform.name + '\n';
             }
         }
     }
@@ -814,6 +1596,9 @@ QString EffectManager::getQmlEffectString()
     }
     s += QString("// Created with Qt Quick Effect Maker (version %1), %2\n\n")
             .arg(qApp->applicationVersion(), QDateTime::currentDateTime().toString());
+    // Bound component behavior, so that the component compiles fully with qmlsc
+    s += "pragma ComponentBehavior: Bound\n";
+    s += '\n';
     s += "import QtQuick\n";
     s += '\n';
     s += "Item {\n";
@@ -836,6 +1621,11 @@ QString EffectManager::getQmlEffectString()
         s += "    // When timeRunning is false, this can be used to control iFrame manually\n";
         s += "    property int animatedFrame: frameAnimation.currentFrame\n";
     }
+    if (m_shaderFeatures.enabled(ShaderFeatures::GridMesh)) {
+        s += QString("    // Size of the mesh cells in pixels. Mesh resolution is limited to %1x%2.\n")
+                .arg(m_shaderFeatures.m_gridMeshWidth).arg(m_shaderFeatures.m_gridMeshHeight);
+        s += QString("    property real meshCellSize: %1\n").arg(DEFAULT_MESH_CELL_SIZE);
+    }
     s += '\n';
     // Custom properties
     if (!m_exportedRootPropertiesString.isEmpty()) {
@@ -858,39 +1648,66 @@ QString EffectManager::getQmlEffectString()
         s += "    property real _effectMouseW: 0\n";
         s += "    MouseArea {\n";
         s += "        anchors.fill: parent\n";
-        s += "        onPressed: (mouse)=> {\n";
-        s += "            _effectMouseX = mouse.x\n";
-        s += "            _effectMouseY = mouse.y\n";
-        s += "            _effectMouseZ = mouse.x\n";
-        s += "            _effectMouseW = mouse.y\n";
+        s += "        onPressed: (mouse) => {\n";
+        s += "            rootItem._effectMouseX = mouse.x\n";
+        s += "            rootItem._effectMouseY = mouse.y\n";
+        s += "            rootItem._effectMouseZ = mouse.x\n";
+        s += "            rootItem._effectMouseW = mouse.y\n";
         s += "            clickTimer.restart();\n";
         s += "        }\n";
-        s += "        onPositionChanged: (mouse)=> {\n";
-        s += "            _effectMouseX = mouse.x\n";
-        s += "            _effectMouseY = mouse.y\n";
+        s += "        onPositionChanged: (mouse) => {\n";
+        s += "            rootItem._effectMouseX = mouse.x\n";
+        s += "            rootItem._effectMouseY = mouse.y\n";
         s += "        }\n";
-        s += "        onReleased: (mouse)=> {\n";
-        s += "            _effectMouseZ = -(_effectMouseZ)\n";
+        s += "        onReleased: () => {\n";
+        s += "            rootItem._effectMouseZ = -(rootItem._effectMouseZ)\n";
         s += "        }\n";
         s += "        Timer {\n";
         s += "            id: clickTimer\n";
         s += "            interval: 20\n";
         s += "            onTriggered: {\n";
-        s += "                _effectMouseW = -(_effectMouseW)\n";
+        s += "                rootItem._effectMouseW = -(rootItem._effectMouseW)\n";
         s += "            }\n";
         s += "         }\n";
         s += "    }\n";
         s += '\n';
     }
     if (m_shaderFeatures.enabled(ShaderFeatures::BlurSources)) {
-        s += "    BlurHelper {\n";
-        s += "        id: blurHelper\n";
-        s += "        anchors.fill: parent\n";
         int blurMax = 32;
         if (g_propertyData.contains("BLUR_HELPER_MAX_LEVEL"))
             blurMax = g_propertyData["BLUR_HELPER_MAX_LEVEL"].toInt();
-        s += QString("        property int blurMax: %1\n").arg(blurMax);
-        s += "        property real blurMultiplier: rootItem.blurMultiplier\n";
+        int dualFilterPasses = 0;
+        if (g_propertyData.contains("BLUR_HELPER_DUAL_FILTER"))
+            dualFilterPasses = g_propertyData["BLUR_HELPER_DUAL_FILTER"].toInt();
+        const QString useMipmap = useMipmapBlur() ? QStringLiteral("true") : QStringLiteral("false");
+        // Effects with the same source can share the blurred sources, instead
+        // of each rendering their own. The shared helper is used when its
+        // settings match, otherwise the effect falls back to its own helper.
+        s += "    // BlurHelper with the same source, which can be shared between effects.\n";
+        s += QString("    // Used when its blurMax is at least %1, useMipmap is %2, dualFilterPasses is %3\n")
+                .arg(QString::number(blurMax), useMipmap, QString::number(dualFilterPasses));
+        s += "    // and blurMultiplier is the same.\n";
+        s += "    property BlurHelper sharedBlurHelper: null\n";
+        s += "    readonly property BlurHelper blurHelper: sharedBlurHelper\n";
+        s += "                                             && sharedBlurHelper.source === rootItem.source\n";
+        s += QString("                                             && sharedBlurHelper.blurMax >= %1\n").arg(blurMax);
+        s += QString("                                             && sharedBlurHelper.useMipmap === %1\n").arg(useMipmap);
+        s += QString("                                             && sharedBlurHelper.dualFilterPasses === %1\n")
+                .arg(dualFilterPasses);
+        s += "                                             && sharedBlurHelper.blurMultiplier === rootItem.blurMultiplier\n";
+        s += "                                             ? sharedBlurHelper : ownBlurHelper\n";
+        s += '\n';
+        s += "    BlurHelper {\n";
+        s += "        id: ownBlurHelper\n";
+        s += "        anchors.fill: parent\n";
+        s += "        // Own blurred sources are not rendered when sharing them\n";
+        s += "        source: rootItem.blurHelper === ownBlurHelper ? rootItem.source : null\n";
+        s += QString("        blurMax: %1\n").arg(blurMax);
+        if (dualFilterPasses > 0)
+            s += QString("        dualFilterPasses: %1\n").arg(dualFilterPasses);
+        s += "        blurMultiplier: rootItem.blurMultiplier\n";
+        if (useMipmapBlur())
+            s += "        useMipmap: true\n";
         s += "    }\n";
     }
     s += getQmlComponentString(true);
@@ -902,13 +1719,13 @@ QString EffectManager::getQmlComponentString(bool localFiles)
 {
     auto addProperty = [localFiles](const QString &name, const QString &var, const QString &type, bool blurHelper = false)
     {
-        if (localFiles) {
-            const QString parent = blurHelper ? "blurHelper." : "rootItem.";
-            return QString("readonly property alias %1: %2%3\n").arg(name, parent, var);
-        } else {
-            const QString parent = blurHelper ? "blurHelper." : QString();
-            return QString("readonly property %1 %2: %3%4\n").arg(type, name, parent, var);
-        }
+        // Exported component binds to the root item, preview to its own properties
+        QString parent;
+        if (blurHelper)
+            parent = localFiles ? QStringLiteral("rootItem.blurHelper.") : QStringLiteral("blurHelper.");
+        else if (localFiles)
+            parent = QStringLiteral("rootItem.");
+        return QString("readonly property %1 %2: %3%4\n").arg(type, name, parent, var);
     };
 
     QString customImagesString = getQmlImagesString(localFiles);
@@ -922,6 +1739,8 @@ QString EffectManager::getQmlComponentString(bool localFiles)
     if (!localFiles)
         s += "import QtQuick\n";
     s += l1 + "ShaderEffect {\n";
+    if (m_shaderFeatures.enabled(ShaderFeatures::GridMesh))
+        s += l2 + "id: shaderEffect\n";
     if (m_shaderFeatures.enabled(ShaderFeatures::Source))
         s += l2 + addProperty("iSource", "source", "Item");
     if (m_shaderFeatures.enabled(ShaderFeatures::Time))
@@ -936,7 +1755,9 @@ QString EffectManager::getQmlComponentString(bool localFiles)
         s += l2 + "readonly property vector4d iMouse: Qt.vector4d(rootItem._effectMouseX, rootItem._effectMouseY,\n";
         s += l2 + "                                               rootItem._effectMouseZ, rootItem._effectMouseW)\n";
     }
-    if (m_shaderFeatures.enabled(ShaderFeatures::BlurSources)) {
+    if (useMipmapBlur()) {
+        s += l2 + addProperty("iSourceBlurMipmap", "blurSrcMipmap", "Item", true);
+    } else if (m_shaderFeatures.enabled(ShaderFeatures::BlurSources)) {
         s += l2 + addProperty("iSourceBlur1", "blurSrc1", "Item", true);
         s += l2 + addProperty("iSourceBlur2", "blurSrc2", "Item", true);
         s += l2 + addProperty("iSourceBlur3", "blurSrc3", "Item", true);
@@ -978,9 +1799,15 @@ QString EffectManager::getQmlComponentString(bool localFiles)
     s += l2 + "fragmentShader: '" + fragmentShaderFilename + "'\n";
     s += l2 + "anchors.fill: parent\n";
     if (m_shaderFeatures.enabled(ShaderFeatures::GridMesh)) {
-        QString gridSize = QString("%1, %2").arg(m_shaderFeatures.m_gridMeshWidth).arg(m_shaderFeatures.m_gridMeshHeight);
+        // Mesh resolution follows the item size, one cell per meshCellSize pixels,
+        // but at most the resolution set with @mesh.
+        QString cellSizeParent = localFiles ? QStringLiteral("rootItem.") : QString();
+        s += l2 + QString("readonly property size meshResolution: Qt.size(Math.max(1, Math.min(%1, Math.ceil(width / %2meshCellSize))),\n")
+                .arg(m_shaderFeatures.m_gridMeshWidth).arg(cellSizeParent);
+        s += l2 + QString("                                               Math.max(1, Math.min(%1, Math.ceil(height / %2meshCellSize))))\n")
+                .arg(m_shaderFeatures.m_gridMeshHeight).arg(cellSizeParent);
         s += l2 + "mesh: GridMesh {\n";
-        s += l3 + QString("resolution: Qt.size(%1)\n").arg(gridSize);
+        s += l3 + "resolution: shaderEffect.meshResolution\n";
         s += l2 + "}\n";
     }
     s += l1 + "}\n";
@@ -1012,6 +1839,17 @@ void EffectManager::setNodeView(NodeView *newNodeView)
             updateQmlComponent();
             bakeShaders(true);
         });
+        // Keep the symbol index up to date with the node code
+        auto updateSelectedNodeSymbols = [this]() {
+            if (auto selectedNode = m_nodeView->m_nodesModel->m_selectedNode) {
+                m_symbolIndex->updateNode(selectedNode->nodeId, selectedNode->vertexCode,
+                                          selectedNode->fragmentCode);
+            }
+        };
+        connect(m_nodeView, &NodeView::selectedNodeFragmentCodeChanged, this, updateSelectedNodeSymbols);
+        connect(m_nodeView, &NodeView::selectedNodeVertexCodeChanged, this, updateSelectedNodeSymbols);
+        connect(m_nodeView->m_nodesModel, &QAbstractItemModel::modelReset,
+                this, &EffectManager::updateNodesSymbolIndex);
         connect(m_nodeView, &NodeView::selectedNodeIdChanged, this, [this]() {
             // Update visibility of properties based on the selected node
             m_uniformModel->beginResetModel();
@@ -1051,7 +1889,7 @@ void EffectManager::initialize()
             QFileInfo fi(fullFilePath);
             projectOpened = newProject(fi.path(), fi.baseName(), true, false);
         } else {
-            projectOpened = loadProject(fullFilePath);
+            projectOpened = loadProject(fullFilePath, false);
         }
     }
 
@@ -1315,113 +2153,112 @@ bool EffectManager::addNodeConnection(int startNodeId, int endNodeId)
     return true;
 }
 
-QString EffectManager::codeFromJsonArray(const QJsonArray &codeArray)
-{
-    QString codeString;
-    for (const auto& element : codeArray) {
-        codeString += element.toString();
-        codeString += '\n';
-    }
-    codeString.chop(1); // Remove last '\n'
-    return codeString;
-}
-
 // Parameter fullNode means nodes from files with QEN etc.
 // Parameter nodePath is the directory where node is loaded from.
 bool EffectManager::createNodeFromJson(const QJsonObject &rootJson, NodesModel::Node &node, bool fullNode, const QString &nodePath)
 {
-    QJsonObject json;
-    if (fullNode) {
-        if (!rootJson.contains("QEN")) {
-            qWarning("Invalid Node file");
-            return false;
-        }
-
-        json = rootJson["QEN"].toObject();
-
-        int version = -1;
-        if (json.contains("version"))
-            version = json["version"].toInt(-1);
-        if (version != 1) {
-            QString error = QString("Error: Unknown effect node version (%1)").arg(version);
-            qWarning() << qPrintable(error);
-            setEffectError(error);
-            return false;
-        }
-    } else {
-        json = rootJson;
-    }
-
-    if (json.contains("name")) {
-        node.name = json["name"].toString();
-    } else {
-        QString error = QString("Error: Node missing a name");
+    QString error;
+    if (!parseNodeFromJson(rootJson, node, fullNode, nodePath, &error)) {
         qWarning() << qPrintable(error);
         setEffectError(error);
         return false;
     }
+    finalizeNode(node);
+    return true;
+}
 
-    // When loading nodes they contain extra data
-    if (json.contains("nodeId"))
-        node.nodeId = json["nodeId"].toInt();
-    if (json.contains("x"))
-        node.x = json["x"].toDouble();
-    if (json.contains("y"))
-        node.y = json["y"].toDouble();
-    if (json.contains("disabled"))
-        node.disabled = getBoolValue(json["disabled"], false);
+// Fills the node data from JSON. This doesn't touch the models or
+// property bindings, so it can be used also from a worker thread.
+// See finalizeNode() for the remaining GUI thread part.
+bool EffectManager::parseNodeFromJson(const QJsonObject &rootJson, NodesModel::Node &node, bool fullNode, const QString &nodePath, QString *error)
+{
+    if (!fullNode)
+        return parseNodeObject(rootJson, node, nodePath, error);
 
-    if (m_nodeView) {
-        // Update the node size based on its type
-        m_nodeView->initializeNodeSize(node);
-        node.name = m_nodeView->getUniqueNodeName(node.name);
+    if (!rootJson.contains("QEN")) {
+        if (error)
+            *error = QStringLiteral("Error: Invalid Node file");
+        return false;
     }
 
-    node.description = json["description"].toString();
+    const QJsonObject json = rootJson["QEN"].toObject();
 
-    if (json.contains("fragmentCode") && json["fragmentCode"].isArray())
-        node.fragmentCode = codeFromJsonArray(json["fragmentCode"].toArray());
-    if (json.contains("vertexCode") && json["vertexCode"].isArray())
-        node.vertexCode = codeFromJsonArray(json["vertexCode"].toArray());
-    if (json.contains("qmlCode") && json["qmlCode"].isArray())
-        node.qmlCode = codeFromJsonArray(json["qmlCode"].toArray());
+    int version = -1;
+    if (json.contains("version"))
+        version = json["version"].toInt(-1);
+    if (version != 1) {
+        if (error)
+            *error = QString("Error: Unknown effect node version (%1)").arg(version);
+        return false;
+    }
+    return parseNodeObject(json, node, nodePath, error);
+}
+
+// Fills the node data from the node object, which is QJsonObject or
+// QCborMap (binary project cache).
+template <typename Map>
+bool EffectManager::parseNodeObject(const Map &json, NodesModel::Node &node, const QString &nodePath, QString *error)
+{
+    if (json.contains(QLatin1String("name"))) {
+        node.name = json[QLatin1String("name")].toString();
+    } else {
+        if (error)
+            *error = QStringLiteral("Error: Node missing a name");
+        return false;
+    }
 
-    if (json.contains("properties") && json["properties"].isArray()) {
-        QJsonArray propertiesArray = json["properties"].toArray();
+    // When loading nodes they contain extra data
+    if (json.contains(QLatin1String("nodeId")))
+        node.nodeId = int(json[QLatin1String("nodeId")].toInteger());
+    if (json.contains(QLatin1String("x")))
+        node.x = json[QLatin1String("x")].toDouble();
+    if (json.contains(QLatin1String("y")))
+        node.y = json[QLatin1String("y")].toDouble();
+    if (json.contains(QLatin1String("disabled")))
+        node.disabled = getBoolValue(json[QLatin1String("disabled")], false);
+
+    node.description = json[QLatin1String("description")].toString();
+
+    if (json.contains(QLatin1String("fragmentCode")) && isCodeValue(json[QLatin1String("fragmentCode")]))
+        node.fragmentCode = codeFromJsonValue(json[QLatin1String("fragmentCode")]);
+    if (json.contains(QLatin1String("vertexCode")) && isCodeValue(json[QLatin1String("vertexCode")]))
+        node.vertexCode = codeFromJsonValue(json[QLatin1String("vertexCode")]);
+    if (json.contains(QLatin1String("qmlCode")) && isCodeValue(json[QLatin1String("qmlCode")]))
+        node.qmlCode = codeFromJsonValue(json[QLatin1String("qmlCode")]);
+
+    if (json.contains(QLatin1String("properties")) && json[QLatin1String("properties")].isArray()) {
+        const auto propertiesArray = json[QLatin1String("properties")].toArray();
         for (const auto& element : propertiesArray) {
-            auto propertyObject = element.toObject();
+            const Map propertyObject = objectValue(element);
             UniformModel::Uniform u = {};
             u.nodeId = node.nodeId;
-            u.name = propertyObject["name"].toString().toUtf8();
-            u.description = propertyObject["description"].toString();
-            u.type = m_uniformModel->typeFromString(propertyObject["type"].toString());
-            u.exportProperty = getBoolValue(propertyObject["exported"], true);
+            u.name = propertyObject[QLatin1String("name")].toString().toUtf8();
+            u.description = propertyObject[QLatin1String("description")].toString();
+            u.type = UniformModel::typeFromString(propertyObject[QLatin1String("type")].toString());
+            u.exportProperty = getBoolValue(propertyObject[QLatin1String("exported")], true);
             QString value, defaultValue, minValue, maxValue;
-            defaultValue = propertyObject["defaultValue"].toString();
+            defaultValue = propertyObject[QLatin1String("defaultValue")].toString();
             if (u.type == UniformModel::Uniform::Type::Sampler) {
                 if (!defaultValue.isEmpty())
                     defaultValue = relativeToAbsolutePath(defaultValue, nodePath);
-                if (propertyObject.contains("enableMipmap"))
-                    u.enableMipmap = getBoolValue(propertyObject["enableMipmap"], false);
-                if (propertyObject.contains("exportImage"))
-                    u.exportImage = getBoolValue(propertyObject["exportImage"], true);
-                // Update the mipmap property
-                QString mipmapProperty = mipmapPropertyName(u.name);
-                g_propertyData[mipmapProperty] = u.enableMipmap;
+                if (propertyObject.contains(QLatin1String("enableMipmap")))
+                    u.enableMipmap = getBoolValue(propertyObject[QLatin1String("enableMipmap")], false);
+                if (propertyObject.contains(QLatin1String("exportImage")))
+                    u.exportImage = getBoolValue(propertyObject[QLatin1String("exportImage")], true);
             }
-            if (propertyObject.contains("value")) {
-                value = propertyObject["value"].toString();
+            if (propertyObject.contains(QLatin1String("value"))) {
+                value = propertyObject[QLatin1String("value")].toString();
                 if (u.type == UniformModel::Uniform::Type::Sampler && !value.isEmpty())
                     value = relativeToAbsolutePath(value, nodePath);
             } else {
                 // QEN files don't store the current value, so with those use default value
                 value = defaultValue;
             }
-            u.customValue = propertyObject["customValue"].toString();
-            u.useCustomValue = getBoolValue(propertyObject["useCustomValue"], false);
-            minValue = propertyObject["minValue"].toString();
-            maxValue = propertyObject["maxValue"].toString();
-            m_uniformModel->setUniformValueData(&u, value, defaultValue, minValue, maxValue);
+            u.customValue = propertyObject[QLatin1String("customValue")].toString();
+            u.useCustomValue = getBoolValue(propertyObject[QLatin1String("useCustomValue")], false);
+            minValue = propertyObject[QLatin1String("minValue")].toString();
+            maxValue = propertyObject[QLatin1String("maxValue")].toString();
+            UniformModel::initUniformValueData(&u, value, defaultValue, minValue, maxValue);
             node.jsonUniforms << u;
         }
     }
@@ -1429,6 +2266,26 @@ bool EffectManager::createNodeFromJson(const QJsonObject &rootJson, NodesModel::
     return true;
 }
 
+// Finalizes parsed node on the GUI thread. Updates the node size & name
+// based on the current node view and property values into bindings.
+void EffectManager::finalizeNode(NodesModel::Node &node)
+{
+    if (m_nodeView) {
+        // Update the node size based on its type
+        m_nodeView->initializeNodeSize(node);
+        node.name = m_nodeView->getUniqueNodeName(node.name);
+    }
+
+    for (const auto &u : std::as_const(node.jsonUniforms)) {
+        g_propertyData.insert(u.name, u.value);
+        if (u.type == UniformModel::Uniform::Type::Sampler) {
+            // Update the mipmap property
+            QString mipmapProperty = mipmapPropertyName(u.name);
+            g_propertyData[mipmapProperty] = u.enableMipmap;
+        }
+    }
+}
+
 bool EffectManager::deleteEffectNodes(QList<int> nodeIds)
 {
     if (nodeIds.isEmpty())
@@ -1514,6 +2371,10 @@ void EffectManager::cleanupProject()
     setEffectPadding(QRect(0, 0, 0, 0));
     setEffectHeadings(QString());
     clearImageWatchers();
+    // Results of the possible ongoing saves are outdated after this
+    m_projectRevision++;
+    m_savedProjectRevision = m_projectRevision;
+    m_savedProjectHash.clear();
 }
 
 QString EffectManager::replaceOldTagsWithNew(const QString &code) {
@@ -1525,70 +2386,178 @@ QString EffectManager::replaceOldTagsWithNew(const QString &code) {
     return s;
 }
 
-bool EffectManager::loadProject(const QUrl &filename)
+// Loads the project. With background true, the project file is read and
+// parsed in a worker thread and applied into the models when ready.
+bool EffectManager::loadProject(const QUrl &filename, bool background)
 {
     auto loadFile = resolveFileFromUrl(filename);
     resetEffectError();
 
-    if (!loadFile.open(QIODevice::ReadOnly)) {
-        QString error = QString("Couldn't open project file: '%1'").arg(filename.toString());
-        qWarning() << qPrintable(error);
-        setEffectError(error);
-        m_settings->removeRecentProjectsModel(filename.toString());
+    if (m_projectLoadWatcher.isRunning()) {
+        qWarning("Project loading already in progress");
         return false;
     }
 
-    QByteArray data = loadFile.readAll();
+    // Make sure that the possible save of the project has been finished
+    m_projectSaveWatcher.waitForFinished();
+
+    const QString projectFilePath = loadFile.fileName();
+    if (!background)
+        return applyProjectData(readProjectData(projectFilePath), filename);
+
+    m_loadingProjectFilename = filename;
+    setProjectLoading(true);
+    auto loadFuture = QtConcurrent::run([projectFilePath](QPromise<ProjectLoadData> &promise) {
+        promise.addResult(readProjectData(projectFilePath, &promise));
+    });
+    m_projectLoadWatcher.setFuture(loadFuture);
+    return true;
+}
+
+// Reads and parses the project file into the project model.
+// This is thread-safe, so doesn't touch the models or bindings.
+// Progress is reported through the promise, when given.
+ProjectLoadData EffectManager::readProjectData(const QString &projectFilePath, QPromise<ProjectLoadData> *promise)
+{
+    ProjectLoadData data;
+    // Prefer the binary cache when it matches the project file, then
+    // the project file itself doesn't need to be read
+    QCborMap rootCbor;
+    if (readProjectCache(projectFilePath, rootCbor)) {
+        readProjectObject(rootCbor, projectFilePath, data, promise);
+        return data;
+    }
+    QFile loadFile(projectFilePath);
+    if (!loadFile.open(QIODevice::ReadOnly)) {
+        data.error = QString("Couldn't open project file: '%1'").arg(projectFilePath);
+        return data;
+    }
     QJsonParseError parseError;
-    QJsonDocument jsonDoc(QJsonDocument::fromJson(data, &parseError));
+    QJsonDocument jsonDoc(QJsonDocument::fromJson(loadFile.readAll(), &parseError));
     if (parseError.error != QJsonParseError::NoError) {
-        QString error = QString("Error parsing the project file: %1: %2").arg(parseError.offset).arg(parseError.errorString());
-        qWarning() << qPrintable(error);
-        setEffectError(error);
-        m_settings->removeRecentProjectsModel(filename.toString());
-        return false;
+        data.error = QString("Error parsing the project file: %1: %2").arg(parseError.offset).arg(parseError.errorString());
+        return data;
     }
-    QJsonObject rootJson = jsonDoc.object();
-    if (!rootJson.contains("QEP")) {
-        QString error = QStringLiteral("Error: Invalid project file");
-        qWarning() << qPrintable(error);
-        setEffectError(error);
-        m_settings->removeRecentProjectsModel(filename.toString());
-        return false;
+    readProjectObject(jsonDoc.object(), projectFilePath, data, promise);
+    return data;
+}
+
+// Reads the project from the root object, which is QJsonObject or
+// QCborMap (binary project cache).
+template <typename Map>
+void EffectManager::readProjectObject(const Map &rootJson, const QString &projectFilePath,
+                                      ProjectLoadData &data, QPromise<ProjectLoadData> *promise)
+{
+    if (!rootJson.contains(QLatin1String("QEP"))) {
+        data.error = QStringLiteral("Error: Invalid project file");
+        return;
     }
 
-    QJsonObject json = rootJson["QEP"].toObject();
+    const Map json = objectValue(rootJson[QLatin1String("QEP")]);
 
     int version = -1;
-    if (json.contains("version"))
-        version = json["version"].toInt(-1);
+    if (json.contains(QLatin1String("version")))
+        version = int(json[QLatin1String("version")].toInteger(-1));
 
     if (version != 1) {
-        QString error = QString("Error: Unknown project version (%1)").arg(version);
-        qWarning() << qPrintable(error);
-        setEffectError(error);
-        m_settings->removeRecentProjectsModel(filename.toString());
-        return false;
+        data.error = QString("Error: Unknown project version (%1)").arg(version);
+        return;
     }
 
     // Get the QQEM version this project was saved with.
     // As a number, so we can use it for comparisons.
     // Start with 0.4 as QQM 0.41 was the first version which started
     // saving these version numbers.
-    double qqemVersion = 0.4;
-    if (json.contains("QQEM")) {
-        QString versionString = json["QQEM"].toString();
+    if (json.contains(QLatin1String("QQEM"))) {
+        QString versionString = json[QLatin1String("QQEM")].toString();
         bool ok;
         double versionNumber = versionString.toDouble(&ok);
-        if (ok) {
-            qqemVersion = versionNumber;
+        if (ok)
+            data.qqemVersion = versionNumber;
+        else
+            data.warning = QString("Warning: Invalid QQEM version (%1)").arg(versionString);
+    }
+    // Project settings are small, so these are kept as JSON
+    // without the nodes and connections
+    Map settingsJson = json;
+    settingsJson.remove(QLatin1String("nodes"));
+    settingsJson.remove(QLatin1String("connections"));
+    data.json = toJsonObject(settingsJson);
+
+    const auto nodesArray = json[QLatin1String("nodes")].toArray();
+
+    // One step for the parsing and one for each node
+    if (promise) {
+        promise->setProgressRange(0, int(nodesArray.size()) + 1);
+        promise->setProgressValue(1);
+    }
+
+    const QString projectDirectory = QFileInfo(projectFilePath).path();
+    for (qsizetype i = 0; i < nodesArray.size(); ++i) {
+        const Map nodeObject = objectValue(nodesArray.at(i));
+        NodesModel::Node node;
+        if (nodeObject.contains(QLatin1String("type")))
+            node.type = int(nodeObject[QLatin1String("type")].toInteger());
+        if (node.type == NodesModel::CustomNode) {
+            node.x = 20;
+            node.y = 60;
+            QString error;
+            if (!parseNodeObject(nodeObject, node, projectDirectory, &error))
+                data.warning = error;
         } else {
-            QString error = QString("Warning: Invalid QQEM version (%1)").arg(versionString);
-            qWarning() << qPrintable(error);
-            setEffectError(error);
+            // Source / Output node, empty code means the default code
+            node.nodeId = int(nodeObject[QLatin1String("nodeId")].toInteger());
+            node.x = nodeObject[QLatin1String("x")].toDouble();
+            node.y = nodeObject[QLatin1String("y")].toDouble();
+            const auto vertexCode = nodeObject[QLatin1String("vertexCode")];
+            if (isCodeValue(vertexCode))
+                node.vertexCode = codeFromJsonValue(vertexCode);
+            const auto fragmentCode = nodeObject[QLatin1String("fragmentCode")];
+            if (isCodeValue(fragmentCode))
+                node.fragmentCode = codeFromJsonValue(fragmentCode);
+            const auto qmlCode = nodeObject[QLatin1String("qmlCode")];
+            if (isCodeValue(qmlCode))
+                node.qmlCode = codeFromJsonValue(qmlCode);
+        }
+
+        // Replace old tags ("//nodes") with new format ("@nodes")
+        // Projects saved with version <= 0.40 use the old tags format
+        if (data.qqemVersion <= 0.4) {
+            node.vertexCode = replaceOldTagsWithNew(node.vertexCode);
+            node.fragmentCode = replaceOldTagsWithNew(node.fragmentCode);
         }
+
+        data.nodes << node;
+        if (promise)
+            promise->setProgressValue(int(i) + 2);
+    }
+
+    const auto connectionsArray = json[QLatin1String("connections")].toArray();
+    for (const auto& connectionElement : connectionsArray) {
+        const Map connectionObject = objectValue(connectionElement);
+        int fromId = int(connectionObject[QLatin1String("fromId")].toInteger());
+        int toId = int(connectionObject[QLatin1String("toId")].toInteger());
+        data.connections << qMakePair(fromId, toId);
+    }
+}
+
+// Applies the project model into the nodes, arrows and uniform models.
+// All the nodes are added in one batch, so models are reset only once.
+bool EffectManager::applyProjectData(const ProjectLoadData &data, const QUrl &filename)
+{
+    if (!data.error.isEmpty()) {
+        qWarning() << qPrintable(data.error);
+        setEffectError(data.error);
+        m_settings->removeRecentProjectsModel(filename.toString());
+        return false;
+    }
+    if (!data.warning.isEmpty()) {
+        qWarning() << qPrintable(data.warning);
+        setEffectError(data.warning);
     }
 
+    const QJsonObject &json = data.json;
+
     // At this point we consider project to be OK, so start cleanup & load
     cleanupProject();
     cleanupNodeView(false);
@@ -1600,7 +2569,7 @@ bool EffectManager::loadProject(const QUrl &filename)
     Q_EMIT projectFilenameChanged();
     Q_EMIT hasProjectFilenameChanged();
 
-    QFileInfo fi(loadFile);
+    QFileInfo fi(resolveFileFromUrl(filename).fileName());
     m_projectDirectory = fi.path();
     Q_EMIT projectDirectoryChanged();
 
@@ -1633,78 +2602,70 @@ bool EffectManager::loadProject(const QUrl &filename)
         padding.setHeight(settingsObject["paddingBottom"].toInt());
         setEffectPadding(padding);
         // Effect headings
-        if (settingsObject.contains("headings") && settingsObject["headings"].isArray())
-            setEffectHeadings(codeFromJsonArray(settingsObject["headings"].toArray()));
+        if (settingsObject.contains("headings") && isCodeValue(settingsObject["headings"]))
+            setEffectHeadings(codeFromJsonValue(settingsObject["headings"]));
     }
 
-    if (json.contains("nodes") && json["nodes"].isArray()) {
-        QJsonArray nodesArray = json["nodes"].toArray();
-        for (const auto& nodeElement : nodesArray) {
-            QJsonObject nodeObject = nodeElement.toObject();
-
-            int type = NodesModel::CustomNode;
-            if (nodeObject.contains("type"))
-                type = nodeObject["type"].toInt();
-            if (type == NodesModel::CustomNode) {
-                NodesModel::Node node;
-                m_nodeView->initializeNode(node);
-                createNodeFromJson(nodeObject, node, false, m_projectDirectory);
-                addNodeIntoView(node);
-            } else {
-                // Source / Output node
-                int nodeId = nodeObject["nodeId"].toInt();
-                auto node = m_nodeView->m_nodesModel->getNodeWithId(nodeId);
-                if (node) {
-                    node->x = nodeObject["x"].toDouble();
-                    node->y = nodeObject["y"].toDouble();
-                    if (node->type == NodesModel::SourceNode) {
-                        // Source can contain also shaders
-                        if (nodeObject.contains("vertexCode") && nodeObject["vertexCode"].isArray())
-                            node->vertexCode = codeFromJsonArray(nodeObject["vertexCode"].toArray());
-                        else
-                            node->vertexCode = getDefaultRootVertexShader().join('\n');
-                        if (nodeObject.contains("fragmentCode") && nodeObject["fragmentCode"].isArray())
-                            node->fragmentCode = codeFromJsonArray(nodeObject["fragmentCode"].toArray());
-                        else
-                            node->fragmentCode = getDefaultRootFragmentShader().join('\n');
-                        // And QML
-                        if (nodeObject.contains("qmlCode") && nodeObject["qmlCode"].isArray())
-                            node->qmlCode = codeFromJsonArray(nodeObject["qmlCode"].toArray());
-                        Q_EMIT m_nodeView->selectedNodeFragmentCodeChanged();
-                        Q_EMIT m_nodeView->selectedNodeVertexCodeChanged();
-                        Q_EMIT m_nodeView->selectedNodeQmlCodeChanged();
-                    }
-                }
+    auto nodesModel = m_nodeView->m_nodesModel;
+    auto arrowsModel = m_nodeView->m_arrowsModel;
+    nodesModel->beginResetModel();
+    arrowsModel->beginResetModel();
+    m_uniformModel->beginResetModel();
+
+    int lastNodeId = -1;
+    for (auto node : data.nodes) {
+        if (node.type == NodesModel::CustomNode) {
+            if (node.nodeId < 0) {
+                node.nodeId = m_nodeView->getUniqueNodeId();
+                for (auto &u : node.jsonUniforms)
+                    u.nodeId = node.nodeId;
+            }
+            finalizeNode(node);
+            // Add Node uniforms into uniform model
+            for (const auto &u : std::as_const(node.jsonUniforms)) {
+                if (m_uniformModel->validateUniformName(u.name))
+                    m_uniformModel->m_uniformTable->append(u);
+                else
+                    qWarning() << "Invalid uniform name, can't add it";
+            }
+            nodesModel->m_nodesList << node;
+            lastNodeId = node.nodeId;
+        } else if (auto n = nodesModel->getNodeWithId(node.nodeId)) {
+            n->x = node.x;
+            n->y = node.y;
+            if (n->type == NodesModel::SourceNode) {
+                // Source can contain also shaders and QML
+                n->vertexCode = node.vertexCode.isEmpty() ? getDefaultRootVertexShader().join('\n')
+                                                          : node.vertexCode;
+                n->fragmentCode = node.fragmentCode.isEmpty() ? getDefaultRootFragmentShader().join('\n')
+                                                              : node.fragmentCode;
+                if (!node.qmlCode.isEmpty())
+                    n->qmlCode = node.qmlCode;
             }
         }
     }
 
-    if (json.contains("connections") && json["connections"].isArray()) {
-        QJsonArray connectionsArray = json["connections"].toArray();
-        for (const auto& connectionElement : connectionsArray) {
-            QJsonObject connectionObject = connectionElement.toObject();
-            int fromId = connectionObject["fromId"].toInt();
-            int toId = connectionObject["toId"].toInt();
-            addNodeConnection(fromId, toId);
-        }
-    }
+    for (const auto &connection : data.connections)
+        addNodeConnection(connection.first, connection.second);
 
-    // Replace old tags ("//nodes") with new format ("@nodes")
-    // Projects saved with version <= 0.40 use the old tags format
-    if (qqemVersion <= 0.4) {
-        m_nodeView->m_nodesModel->beginResetModel();
-        for (auto &node : m_nodeView->m_nodesModel->m_nodesList) {
-            node.vertexCode = replaceOldTagsWithNew(node.vertexCode);
-            node.fragmentCode = replaceOldTagsWithNew(node.fragmentCode);
-            if (node.selected) {
-                Q_EMIT m_nodeView->selectedNodeVertexCodeChanged();
-                Q_EMIT m_nodeView->selectedNodeFragmentCodeChanged();
-            }
-        }
-        m_nodeView->m_nodesModel->endResetModel();
-    }
+    m_uniformModel->updateCanMoveStatus();
+    nodesModel->endResetModel();
+    arrowsModel->endResetModel();
+    m_uniformModel->endResetModel();
+    Q_EMIT m_uniformModel->uniformsChanged();
 
+    m_nodeView->updateArrowsPositions();
+    // Model has landed, so this starts the first bake
     m_nodeView->updateActiveNodesList();
+    // Select the last added node, or update the code of the main node
+    if (lastNodeId >= 0) {
+        m_nodeView->selectSingleNode(lastNodeId);
+    } else {
+        Q_EMIT m_nodeView->selectedNodeFragmentCodeChanged();
+        Q_EMIT m_nodeView->selectedNodeVertexCodeChanged();
+        Q_EMIT m_nodeView->selectedNodeQmlCodeChanged();
+    }
+
     // Layout nodes automatically to suit current view size
     // But wait that we are definitely in the design mode
     QTimer::singleShot(1, m_nodeView, [this]() {
@@ -1716,29 +2677,195 @@ bool EffectManager::loadProject(const QUrl &filename)
     return true;
 }
 
+void EffectManager::handleProjectLoaded()
+{
+    const QUrl filename = m_loadingProjectFilename;
+    m_loadingProjectFilename.clear();
+    if (m_projectLoadWatcher.future().resultCount() > 0)
+        applyProjectData(m_projectLoadWatcher.result(), filename);
+    setProjectLoading(false);
+}
+
+bool EffectManager::projectLoading() const
+{
+    return m_projectLoading;
+}
+
+void EffectManager::setProjectLoading(bool loading)
+{
+    if (m_projectLoading == loading)
+        return;
+    m_projectLoading = loading;
+    m_projectLoadProgress = 0.0;
+    Q_EMIT projectLoadingChanged();
+    Q_EMIT projectLoadProgressChanged();
+}
+
+qreal EffectManager::projectLoadProgress() const
+{
+    return m_projectLoadProgress;
+}
+
+// Saves the project in a worker thread. Returns false when the save couldn't
+// be started, otherwise the result is reported with projectSaved().
 bool EffectManager::saveProject(const QUrl &filename)
 {
     QUrl fileUrl = filename;
     // When this is called without a filename, use previous one
     if (filename.isEmpty())
         fileUrl = m_projectFilename;
+    if (fileUrl.isEmpty())
+        return false;
 
     auto saveFile = resolveFileFromUrl(fileUrl);
+    QFileInfo fi(saveFile);
 
-    if (!saveFile.open(QIODevice::WriteOnly)) {
-        QString error = QString("Error: Couldn't save project file: '%1'").arg(fileUrl.toString());
-        qWarning() << qPrintable(error);
-        setEffectError(error);
-        return false;
+    // Snapshot the project on the GUI thread, writing happens in the background
+    ProjectSaveJob job;
+    job.projectFilePath = saveFile.fileName();
+    job.rootJson = projectToJson(fi.absolutePath());
+    job.revision = m_projectRevision;
+    job.explicitSave = true;
+    job.fileUrl = fileUrl;
+    // When called with filename (so initial save or save as),
+    // add into recent projects list.
+    job.addToRecentProjects = !filename.isEmpty();
+
+    if (m_projectSaving) {
+        // Files are written in order, so start after the current save.
+        // A newer explicit save replaces the earlier pending one.
+        m_pendingProjectSave = true;
+        m_pendingProjectSaveJob = job;
+        return true;
     }
+    startProjectSave(job);
+    return true;
+}
 
-    m_projectFilename = fileUrl;
-    Q_EMIT projectFilenameChanged();
-    Q_EMIT hasProjectFilenameChanged();
+// Autosaves the project into its current file in a worker thread,
+// when there are unsaved changes.
+void EffectManager::autoSaveProject()
+{
+    // Skip when the previous save is still in progress, next timeout retries
+    if (!m_unsavedChanges || m_projectFilename.isEmpty() || m_projectSaving)
+        return;
 
+    auto saveFile = resolveFileFromUrl(m_projectFilename);
     QFileInfo fi(saveFile);
-    setProjectName(fi.baseName());
+    ProjectSaveJob job;
+    job.projectFilePath = saveFile.fileName();
+    job.rootJson = projectToJson(fi.absolutePath());
+    job.previousHash = m_savedProjectHash;
+    job.revision = m_projectRevision;
+    startProjectSave(job);
+}
+
+void EffectManager::startProjectSave(const ProjectSaveJob &job)
+{
+    auto saveFuture = QtConcurrent::run([job]() {
+        ProjectSaveResult result = writeProjectFiles(job.projectFilePath, job.rootJson, job.previousHash);
+        result.revision = job.revision;
+        result.explicitSave = job.explicitSave;
+        result.fileUrl = job.fileUrl;
+        result.addToRecentProjects = job.addToRecentProjects;
+        return result;
+    });
+    m_projectSaving = true;
+    m_projectSaveWatcher.setFuture(saveFuture);
+}
+
+void EffectManager::updateAutoSaveTimer()
+{
+    const int interval = m_settings->autoSaveInterval();
+    if (interval > 0) {
+        m_autoSaveTimer.setInterval(interval * 60 * 1000);
+        m_autoSaveTimer.start();
+    } else {
+        m_autoSaveTimer.stop();
+    }
+}
+
+// Serializes rootJson and writes it into projectFilePath (and the binary cache).
+// Files are written with QSaveFile, so a crash during the save doesn't corrupt
+// the earlier project file. When previousHash is given, writing is skipped
+// if the content hash matches to it.
+// Note: Can be called from worker threads.
+ProjectSaveResult EffectManager::writeProjectFiles(const QString &projectFilePath, const QJsonObject &rootJson, const QByteArray &previousHash)
+{
+    ProjectSaveResult result;
+    result.projectFilePath = projectFilePath;
+    const QByteArray data = QJsonDocument(rootJson).toJson();
+    result.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    if (!previousHash.isEmpty() && result.hash == previousHash) {
+        result.skipped = true;
+        return result;
+    }
+    if (!writeToSaveFile(data, projectFilePath)) {
+        result.error = QString("Error: Couldn't save project file: '%1'").arg(projectFilePath);
+        return result;
+    }
+    // Cache stores the size and modification time of the project file it was
+    // created from, so it is only used while the project file stays unchanged
+    const QFileInfo projectInfo(projectFilePath);
+    QJsonObject cacheJson = projectJsonWithCodeStrings(rootJson);
+    cacheJson.insert("projectSize", projectInfo.size());
+    cacheJson.insert("projectModified", projectInfo.lastModified().toMSecsSinceEpoch());
+    const QCborMap cbor = QCborMap::fromJsonObject(cacheJson);
+    writeToSaveFile(cbor.toCborValue().toCbor(), projectCacheFilePath(projectFilePath));
+    return result;
+}
 
+// Applies the result of the project save. Unsaved changes are cleared only
+// when the save succeeded and the project hasn't changed after the snapshot.
+// Returns false when saving failed.
+bool EffectManager::applyProjectSaveResult(const ProjectSaveResult &result)
+{
+    if (!result.error.isEmpty()) {
+        qWarning() << qPrintable(result.error);
+        setEffectError(result.error);
+        return false;
+    }
+    m_savedProjectRevision = result.revision;
+    m_savedProjectHash = result.hash;
+    if (result.revision == m_projectRevision)
+        setUnsavedChanges(false);
+    return true;
+}
+
+void EffectManager::handleProjectSaved()
+{
+    m_projectSaving = false;
+    const ProjectSaveResult result = m_projectSaveWatcher.result();
+    // Results of saves which were overtaken by a newer save, or which were
+    // saving a project that isn't open anymore, are not applied
+    bool outdated = result.revision < m_savedProjectRevision;
+    if (!result.explicitSave)
+        outdated |= result.projectFilePath != resolveFileFromUrl(m_projectFilename).fileName();
+    bool saved = result.error.isEmpty();
+    if (!outdated) {
+        saved = applyProjectSaveResult(result);
+        if (saved && result.explicitSave) {
+            m_projectFilename = result.fileUrl;
+            Q_EMIT projectFilenameChanged();
+            Q_EMIT hasProjectFilenameChanged();
+            setProjectName(QFileInfo(result.projectFilePath).baseName());
+            if (result.addToRecentProjects)
+                m_settings->updateRecentProjectsModel(m_projectName, m_projectFilename.toString());
+        }
+    }
+
+    if (m_pendingProjectSave) {
+        m_pendingProjectSave = false;
+        startProjectSave(m_pendingProjectSaveJob);
+    }
+    if (result.explicitSave)
+        Q_EMIT projectSaved(saved);
+}
+
+// Creates JSON presentation of the current project.
+// Parameter projectPath is the directory where project is saved to.
+QJsonObject EffectManager::projectToJson(const QString &projectPath)
+{
     QJsonObject json;
     // File format version
     json.insert("version", 1);
@@ -1780,7 +2907,7 @@ bool EffectManager::saveProject(const QUrl &filename)
     // Add nodes
     QJsonArray nodesArray;
     for (const auto &node : m_nodeView->m_nodesModel->m_nodesList) {
-        QJsonObject nodeObject = nodeToJson(node, false, fi.absolutePath());
+        QJsonObject nodeObject = nodeToJson(node, false, projectPath);
         nodesArray.append(nodeObject);
     }
     if (!nodesArray.isEmpty())
@@ -1800,17 +2927,48 @@ bool EffectManager::saveProject(const QUrl &filename)
 
     QJsonObject rootJson;
     rootJson.insert("QEP", json);
-    QJsonDocument jsonDoc(rootJson);
-    saveFile.write(jsonDoc.toJson());
+    return rootJson;
+}
 
-    setUnsavedChanges(false);
+// Reads the binary (CBOR) project cache of projectFilePath into rootJson.
+// Cache is used only when the size and content hash stored into it match
+// to projectData, so edits made into the JSON project file outside of QQEM
+// are not lost (file modification times are not reliable for this).
+// Returns false when the cache is missing, outdated or invalid.
+bool EffectManager::readProjectCache(const QString &projectFilePath, QCborMap &rootCbor)
+{
+    const QString cacheFilePath = projectCacheFilePath(projectFilePath);
+    QFile cacheFile(cacheFilePath);
+    if (!cacheFile.exists())
+        return false;
+
+    // Cache is valid while the project file has the same size and
+    // modification time as when the cache was written
+    const QFileInfo projectInfo(projectFilePath);
+    if (!projectInfo.exists())
+        return false;
+
+    if (!cacheFile.open(QIODevice::ReadOnly))
+        return false;
 
-    if (!filename.isEmpty()) {
-        // When called with filename (so initial save or save as),
-        // add into recent projects list.
-        m_settings->updateRecentProjectsModel(m_projectName, m_projectFilename.toString());
+    QCborParserError parseError;
+    const QCborValue cbor = QCborValue::fromCbor(cacheFile.readAll(), &parseError);
+    if (parseError.error != QCborError::NoError || !cbor.isMap()) {
+        qWarning() << "Ignoring invalid project cache:" << cacheFilePath;
+        return false;
     }
+    QCborMap map = cbor.toMap();
+    if (!map.contains(QLatin1String("QEP")))
+        return false;
+
+    if (map.value(QLatin1String("projectSize")).toInteger(-1) != projectInfo.size())
+        return false;
+    if (map.value(QLatin1String("projectModified")).toInteger(-1) != projectInfo.lastModified().toMSecsSinceEpoch())
+        return false;
+    map.remove(QLatin1String("projectSize"));
+    map.remove(QLatin1String("projectModified"));
 
+    rootCbor = map;
     return true;
 }
 
@@ -2030,9 +3188,7 @@ bool EffectManager::newProject(const QString &filepath, const QString &filename,
     } );
 
     // Save the new project, with whatever nodes user had at this point
-    saveProject(m_projectFilename);
-
-    return true;
+    return saveProject(m_projectFilename);
 }
 
 void EffectManager::closeProject()
@@ -2051,6 +3207,43 @@ void EffectManager::closeProject()
     setProjectName(QString());
 }
 
+// One exported file. Content is produced and the file
+// written in a worker thread, see exportEffect().
+struct ExportJob {
+    // Name of the file inside the export directory
+    QString filename;
+    FileType fileType = FileType::Binary;
+    bool includeInQrc = true;
+    // Produces the file content, returns false on failure
+    std::function<bool(QByteArray &data)> content;
+    // Results
+    bool ok = false;
+    bool written = false;
+    QByteArray data;
+
+    static ExportJob dataJob(const QString &filename, const QByteArray &data, FileType fileType)
+    {
+        ExportJob job;
+        job.filename = filename;
+        job.fileType = fileType;
+        job.content = [data](QByteArray &out) {
+            out = data;
+            return true;
+        };
+        return job;
+    }
+
+    static ExportJob copyJob(const QString &filename, const QString &sourcePath)
+    {
+        ExportJob job;
+        job.filename = filename;
+        job.content = [sourcePath](QByteArray &out) {
+            return readFileData(sourcePath, out);
+        };
+        return job;
+    }
+};
+
 bool EffectManager::exportEffect(const QString &dirPath, const QString &filename, int exportFlags, int qsbVersionIndex)
 {
     if (dirPath.isEmpty() || filename.isEmpty()) {
@@ -2080,7 +3273,12 @@ bool EffectManager::exportEffect(const QString &dirPath, const QString &filename
     QString vsSourceFilename = filename + ".vert";
     QString fsSourceFilename = filename + ".frag";
     QString qrcFilename = filename + ".qrc";
-    QStringList exportedFilenames;
+    QString cppSourceFilename = filename + "_resources.cpp";
+    QString cppHeaderFilename = filename + "_resources.h";
+    QString nativeSourceFilename = filename + "item.cpp";
+    QString nativeHeaderFilename = filename + "item.h";
+    const QString qmldirFilename = QStringLiteral("qmldir");
+    const QString cmakeFilename = QStringLiteral("CMakeLists.txt");
 
     // Make sure that QML component starts with capital letter
     qmlFilename[0] = qmlFilename[0].toUpper();
@@ -2090,6 +3288,122 @@ bool EffectManager::exportEffect(const QString &dirPath, const QString &filename
     vsSourceFilename = vsSourceFilename.toLower();
     fsSourceFilename = fsSourceFilename.toLower();
     qrcFilename = qrcFilename.toLower();
+    cppSourceFilename = cppSourceFilename.toLower();
+    cppHeaderFilename = cppHeaderFilename.toLower();
+    nativeSourceFilename = nativeSourceFilename.toLower();
+    nativeHeaderFilename = nativeHeaderFilename.toLower();
+
+    // Replace the runs of color adjusting nodes with LUT lookups, which
+    // requires regenerating the fragment shader
+    QString fragmentShader = m_fragmentShader;
+    QList<QPair<ColorLutFuser::Run, QImage>> fusedRuns;
+    if (exportFlags & FusedColorNodes)
+        fusedRuns = fuseColorNodes();
+    if (!fusedRuns.isEmpty()) {
+        QStringList samplerNames;
+        for (const auto &fusedRun : std::as_const(fusedRuns)) {
+            const ColorLutFuser::Run &run = fusedRun.first;
+            for (int nodeId : run.nodeIds)
+                m_nodeMainCodeOverrides.insert(nodeId, QString());
+            m_nodeMainCodeOverrides.insert(run.nodeIds.first(), ColorLutFuser::lookupCode(run));
+            samplerNames << run.samplerName;
+        }
+        fragmentShader = FunctionBaker::addSamplers(generateFragmentShader(), samplerNames);
+        m_nodeMainCodeOverrides.clear();
+        // Properties of the fused nodes are baked into the LUTs. These are kept in
+        // the component API (and in the uniform buffer shared with the vertex
+        // shader), but changing them has no effect anymore.
+        QStringList bakedProperties;
+        for (const auto &fusedRun : std::as_const(fusedRuns)) {
+            for (const auto &uniform : std::as_const(m_uniformTable)) {
+                if (!fusedRun.first.nodeIds.contains(uniform.nodeId) || !uniform.exportProperty ||
+                        uniform.type == UniformModel::Uniform::Type::Define)
+                    continue;
+                // Declaration of the uniform counts as one use
+                const QRegularExpression nameExp(QString("\\b%1\\b").arg(QRegularExpression::escape(uniform.name)));
+                if (fragmentShader.count(nameExp) <= 1 && !m_vertexShader.contains(nameExp))
+                    bakedProperties << QString::fromUtf8(uniform.name);
+            }
+        }
+        if (!bakedProperties.isEmpty()) {
+            qWarning("Warning: Properties '%s' are baked into the fused color LUTs, changing them has no effect",
+                     qPrintable(bakedProperties.join(", ")));
+        }
+    }
+
+    // Pack small images into an atlas, which requires modified fragment shader
+    ImageAtlas imageAtlas;
+    QString atlasFilename;
+    if ((exportFlags & Images) && (exportFlags & PackedImages))
+        imageAtlas = createImageAtlas(fragmentShader);
+    if (!imageAtlas.isEmpty()) {
+        fragmentShader = applyImageAtlasToShader(fragmentShader, imageAtlas);
+        const bool compressAtlas = exportFlags & (CompressedImagesETC2 | CompressedImagesBC);
+        atlasFilename = filename.toLower() + (compressAtlas ? "_atlas.ktx" : "_atlas.png");
+    }
+
+    // Evaluate the functions marked with "@bake" into textures, and
+    // fetch these in the fragment shader instead of calling the functions
+    QList<QPair<FunctionBaker::Function, QImage>> bakedFunctions;
+    if (exportFlags & BakedFunctions)
+        bakedFunctions = bakeFunctions();
+    if (!bakedFunctions.isEmpty()) {
+        QList<FunctionBaker::Function> functions;
+        for (const auto &bakedFunction : std::as_const(bakedFunctions))
+            functions << bakedFunction.first;
+        QList<FunctionBaker::SkippedCall> skippedCalls;
+        fragmentShader = FunctionBaker::applyToShader(fragmentShader, functions, &skippedCalls);
+        static const QRegularExpression whitespaceExp("\\s+");
+        for (const auto &skippedCall : std::as_const(skippedCalls)) {
+            // Node of the call, compared without whitespace as the code is reformatted
+            const QString call = QString(skippedCall.call).remove(whitespaceExp);
+            QString nodeName;
+            for (auto n : m_nodeView->m_activeNodesList) {
+                if (QString(n->fragmentCode).remove(whitespaceExp).contains(call)) {
+                    nodeName = n->name;
+                    break;
+                }
+            }
+            qWarning("Warning: Call '%s' of the baked function '%s' in node '%s' is not baked, "
+                     "the argument must be texCoord or a local assigned from it",
+                     qPrintable(skippedCall.call), qPrintable(skippedCall.functionName), qPrintable(nodeName));
+        }
+        // Functions without replaced calls don't need their textures
+        bakedFunctions.removeIf([&fragmentShader](const QPair<FunctionBaker::Function, QImage> &bakedFunction) {
+            const QRegularExpression samplerExp(QString("\\b%1\\b").arg(bakedFunction.first.samplerName));
+            return !fragmentShader.contains(samplerExp);
+        });
+    }
+
+    // Collect all the exported files as jobs, which are then
+    // produced and written concurrently in worker threads.
+    QList<ExportJob> jobs;
+
+    // Fused color LUT textures, these are needed by the shader
+    for (int i = 0; i < fusedRuns.size(); i++) {
+        const QImage image = fusedRuns.at(i).second;
+        ExportJob job;
+        job.filename = fusedColorLutFilename(filename, i + 1);
+        job.content = [image](QByteArray &data) {
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::WriteOnly);
+            return image.save(&buffer, "PNG");
+        };
+        jobs << job;
+    }
+
+    // Baked function textures, these are needed by the shader
+    for (const auto &bakedFunction : std::as_const(bakedFunctions)) {
+        const QImage image = bakedFunction.second;
+        ExportJob job;
+        job.filename = bakedFunctionFilename(filename, bakedFunction.first);
+        job.content = [image](QByteArray &data) {
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::WriteOnly);
+            return image.save(&buffer, "PNG");
+        };
+        jobs << job;
+    }
 
     // Bake shaders with correct settings
     if (exportFlags & QSBShaders) {
@@ -2099,43 +3413,103 @@ bool EffectManager::exportEffect(const QString &dirPath, const QString &filename
         else if (qsbVersionIndex == 2)
             qsbVersion = QShader::SerializedFormatVersion::Qt_6_4;
 
-        QString vsFilePath = dirPath + "/" + vsFilename;
-        removeIfExists(vsFilePath);
-        m_baker.setSourceString(m_vertexShader.toUtf8(), QShader::VertexStage);
-        QShader vertShader = m_baker.bake();
-        if (vertShader.isValid())
-            writeToFile(vertShader.serialized(qsbVersion), vsFilePath, FileType::Binary);
-
-        exportedFilenames << vsFilename;
-        QString fsFilePath = dirPath + "/" + fsFilename;
-        removeIfExists(fsFilePath);
-        m_baker.setSourceString(m_fragmentShader.toUtf8(), QShader::FragmentStage);
-        QShader fragShader = m_baker.bake();
-        if (fragShader.isValid())
-            writeToFile(fragShader.serialized(qsbVersion), fsFilePath, FileType::Binary);
-
-        exportedFilenames << fsFilename;
+        const auto targets = m_generatedShaders;
+        auto addBakeJob = [&jobs, &targets, qsbVersion](const QString &qsbFilename, const QString &source,
+                                                         QShader::Stage stage) {
+            ExportJob job;
+            job.filename = qsbFilename;
+            job.content = [source, stage, targets, qsbVersion](QByteArray &data) {
+                // QShaderBaker is not thread-safe, so each job uses its own
+                QShaderBaker baker;
+                baker.setGeneratedShaderVariants({ QShader::StandardShader });
+                baker.setGeneratedShaders(targets);
+                baker.setSourceString(source.toUtf8(), stage);
+                QShader shader = baker.bake();
+                if (!shader.isValid())
+                    return false;
+                data = shader.serialized(qsbVersion);
+                return true;
+            };
+            jobs << job;
+        };
+        addBakeJob(vsFilename, m_vertexShader, QShader::VertexStage);
+        addBakeJob(fsFilename, fragmentShader, QShader::FragmentStage);
     }
 
-    // Copy images
+    // Copy images, or transcode them into compressed textures
+    // Map from the original image filenames to the compressed ones
+    QHash<QString, QString> compressedImageFilenames;
     if (exportFlags & Images) {
+        const bool compressImages = exportFlags & (CompressedImagesETC2 | CompressedImagesBC);
+        const auto textureFormat = (exportFlags & CompressedImagesBC) ? TextureCompressor::BC
+                                                                     : TextureCompressor::ETC2;
+        QStringList packedImages;
+        if (!imageAtlas.isEmpty()) {
+            const QImage atlasImage = imageAtlas.atlasImage();
+            ExportJob job;
+            job.filename = atlasFilename;
+            job.content = [atlasImage, compressImages, textureFormat](QByteArray &data) {
+                if (compressImages) {
+                    data = TextureCompressor::compressToKtx(atlasImage, textureFormat, false);
+                    return !data.isEmpty();
+                }
+                QBuffer buffer(&data);
+                buffer.open(QIODevice::WriteOnly);
+                return atlasImage.save(&buffer, "PNG");
+            };
+            jobs << job;
+            for (const auto &entry : imageAtlas.entries())
+                packedImages << entry.name;
+        }
+        // Source image paths of the queued target filenames. Samplers can use
+        // the same image, and images can map to the same target filename,
+        // which are exported only once.
+        QHash<QString, QString> queuedImageSources;
+        auto queueImage = [&queuedImageSources](const QString &targetFilename, const QString &imagePath) {
+            auto it = queuedImageSources.constFind(targetFilename);
+            if (it == queuedImageSources.constEnd()) {
+                queuedImageSources.insert(targetFilename, imagePath);
+                return true;
+            }
+            if (it.value() != imagePath) {
+                qWarning("Warning: Images '%s' and '%s' are both exported as '%s', only the first one is used",
+                         qPrintable(it.value()), qPrintable(imagePath), qPrintable(targetFilename));
+            }
+            return false;
+        };
         for (auto &uniform : m_uniformTable) {
             if (uniform.type == UniformModel::Uniform::Type::Sampler &&
                 !uniform.value.toString().isEmpty() &&
-                uniform.exportImage) {
+                uniform.exportImage &&
+                !packedImages.contains(uniform.name)) {
                 QString imagePath = uniform.value.toString();
                 QFileInfo fi(imagePath);
                 QString imageFilename = fi.fileName();
                 QString imageFilePath = dirPath + "/" + imageFilename;
                 imagePath = stripFileFromURL(imagePath);
+                if (compressImages) {
+                    const QString ktxFilename = fi.completeBaseName() + ".ktx";
+                    compressedImageFilenames.insert(imageFilename, ktxFilename);
+                    if (!queueImage(ktxFilename, imagePath))
+                        continue;
+                    ExportJob job;
+                    job.filename = ktxFilename;
+                    const bool mipmaps = uniform.enableMipmap;
+                    job.content = [imagePath, textureFormat, mipmaps](QByteArray &data) {
+                        QImage image(imagePath);
+                        if (image.isNull())
+                            return false;
+                        data = TextureCompressor::compressToKtx(image, textureFormat, mipmaps);
+                        return !data.isEmpty();
+                    };
+                    jobs << job;
+                    continue;
+                }
                 if (imagePath.compare(imageFilePath, Qt::CaseInsensitive) == 0)
                     continue; // Exporting to same dir, so skip
-                removeIfExists(imageFilePath);
-                QFile imageFile(imagePath);
-                if (!imageFile.copy(imageFilePath))
-                    qWarning("Unable to copy image file: %s", qPrintable(imageFilename));
-                else
-                    exportedFilenames << imageFilename;
+                if (!queueImage(imageFilename, imagePath))
+                    continue;
+                jobs << ExportJob::copyJob(imageFilename, imagePath);
             }
         }
     }
@@ -2153,50 +3527,229 @@ bool EffectManager::exportEffect(const QString &dirPath, const QString &filename
             } else  if (line.startsWith("fragmentShader")) {
                 QString fsLine = "        fragmentShader: '" + fsFilename + "'";
                 qmlStringList[i] = fsLine;
+            } else if (line.startsWith("source: \"") && !compressedImageFilenames.isEmpty()) {
+                // Point images to the compressed textures
+                QString imageFilename = line.mid(9).chopped(1);
+                if (compressedImageFilenames.contains(imageFilename)) {
+                    QString sourceLine = "            source: \"" + compressedImageFilenames.value(imageFilename) + "\"";
+                    qmlStringList[i] = sourceLine;
+                }
             }
         }
 
+        if (!imageAtlas.isEmpty())
+            applyImageAtlasToQml(qmlStringList, imageAtlas, atlasFilename);
+
+        // Add the baked function and fused LUT textures into ShaderEffect
+        QList<QPair<QString, QString>> generatedImages;
+        for (const auto &bakedFunction : std::as_const(bakedFunctions)) {
+            generatedImages << qMakePair(bakedFunction.first.samplerName,
+                                         bakedFunctionFilename(filename, bakedFunction.first));
+        }
+        for (int i = 0; i < fusedRuns.size(); i++)
+            generatedImages << qMakePair(fusedRuns.at(i).first.samplerName, fusedColorLutFilename(filename, i + 1));
+        addGeneratedImagesToQml(qmlStringList, generatedImages);
+
         QString qmlString = qmlStringList.join('\n');
-        QString qmlFilePath = dirPath + "/" + qmlFilename;
-        writeToFile(qmlString.toUtf8(), qmlFilePath, FileType::Text);
-        exportedFilenames << qmlFilename;
+        jobs << ExportJob::dataJob(qmlFilename, qmlString.toUtf8(), FileType::Text);
 
         // Copy blur helpers
         if (m_shaderFeatures.enabled(ShaderFeatures::BlurSources)) {
-            QString blurHelperFilename("BlurHelper.qml");
-            QString blurFsFilename("bluritems.frag.qsb");
-            QString blurVsFilename("bluritems.vert.qsb");
             QString blurHelperPath(m_settings->defaultResourcePath() + "/defaultnodes/common/");
-            QString blurHelperSource(blurHelperPath + blurHelperFilename);
-            QString blurFsSource(blurHelperPath + blurFsFilename);
-            QString blurVsSource(blurHelperPath + blurVsFilename);
-            QFile blurHelperFile(blurHelperSource);
-            QFile blurFsFile(blurFsSource);
-            QFile blurVsFile(blurVsSource);
-            QString blurHelperFilePath = dirPath + "/" + "BlurHelper.qml";
-            QString blurFsFilePath = dirPath + "/" + "bluritems.frag.qsb";
-            QString blurVsFilePath = dirPath + "/" + "bluritems.vert.qsb";
-            removeIfExists(blurHelperFilePath);
-            removeIfExists(blurFsFilePath);
-            removeIfExists(blurVsFilePath);
-            if (!blurHelperFile.copy(blurHelperFilePath))
-                qWarning("Unable to copy file: %s", qPrintable(blurHelperFilePath));
-            if (!blurFsFile.copy(blurFsFilePath))
-                qWarning("Unable to copy file: %s", qPrintable(blurFsFilePath));
-            if (!blurVsFile.copy(blurVsFilePath))
-                qWarning("Unable to copy file: %s", qPrintable(blurVsFilePath));
-            exportedFilenames << blurHelperFilename;
-            exportedFilenames << blurFsFilename;
-            exportedFilenames << blurVsFilename;
+            const QStringList blurFilenames = { QStringLiteral("BlurHelper.qml"),
+                                                QStringLiteral("bluritems.frag.qsb"),
+                                                QStringLiteral("bluritems.vert.qsb") };
+            for (const auto &blurFilename : blurFilenames)
+                jobs << ExportJob::copyJob(blurFilename, blurHelperPath + blurFilename);
+            // Dual filter shaders are baked into the resources at build time
+            if (g_propertyData.value("BLUR_HELPER_DUAL_FILTER").toInt() > 0) {
+                const QStringList dualFilterFilenames = { QStringLiteral("dualkawase.vert.qsb"),
+                                                          QStringLiteral("dualkawasedown.frag.qsb"),
+                                                          QStringLiteral("dualkawaseup.frag.qsb") };
+                for (const auto &dualFilterFilename : dualFilterFilenames)
+                    jobs << ExportJob::copyJob(dualFilterFilename, ":/nodes/common/" + dualFilterFilename);
+            }
+        }
+    }
+
+    // Estimate of the GPU memory, with the exported image formats
+    {
+        GpuMemoryEstimator estimator;
+        if (m_shaderFeatures.enabled(ShaderFeatures::BlurSources))
+            estimator.addPixels(QStringLiteral("BlurHelper layers"), m_previewBlurPixels);
+        addImagesToGpuMemory(estimator, exportFlags, imageAtlas);
+        for (const auto &bakedFunction : std::as_const(bakedFunctions)) {
+            estimator.addTexture(bakedFunction.first.samplerName, bakedFunction.second.size(),
+                                 GpuMemoryEstimator::Format::RGBA8, false);
+        }
+        for (const auto &fusedRun : std::as_const(fusedRuns)) {
+            estimator.addTexture(fusedRun.first.samplerName, fusedRun.second.size(),
+                                 GpuMemoryEstimator::Format::RGBA8, false);
+        }
+        QString report = QString("GPU memory estimate of %1, excluding the source item.\n").arg(filename);
+        if (m_shaderFeatures.enabled(ShaderFeatures::BlurSources)) {
+            report += QString("BlurHelper layers are based on %1x%2 source.\n")
+                    .arg(m_previewSourceSize.width()).arg(m_previewSourceSize.height());
         }
+        report += '\n';
+        report += estimator.report(qint64(m_settings->gpuMemoryBudget()) * 1024 * 1024);
+        auto reportJob = ExportJob::dataJob(filename.toLower() + "_gpumemory.txt", report.toUtf8(), FileType::Text);
+        reportJob.includeInQrc = false;
+        jobs << reportJob;
     }
 
     // Export shaders as plain-text
     if (exportFlags & TextShaders) {
-        QString vsSourceFilePath = dirPath + "/" + vsSourceFilename;
-        writeToFile(m_vertexShader.toUtf8(), vsSourceFilePath, FileType::Text);
-        QString fsSourceFilePath = dirPath + "/" + fsSourceFilename;
-        writeToFile(m_fragmentShader.toUtf8(), fsSourceFilePath, FileType::Text);
+        auto vsJob = ExportJob::dataJob(vsSourceFilename, m_vertexShader.toUtf8(), FileType::Text);
+        auto fsJob = ExportJob::dataJob(fsSourceFilename, fragmentShader.toUtf8(), FileType::Text);
+        vsJob.includeInQrc = false;
+        fsJob.includeInQrc = false;
+        jobs << vsJob << fsJob;
+    }
+
+    // Export as C++ item, which renders without ShaderEffect
+    QStringList nativeItemFilenames;
+    if (exportFlags & NativeItem) {
+        const QStringList unsupportedFeatures = nativeItemUnsupportedFeatures();
+        if (!unsupportedFeatures.isEmpty()) {
+            QString error = QString("Warning: Native item not exported, unsupported features: %1")
+                    .arg(unsupportedFeatures.join(", "));
+            qWarning() << qPrintable(error);
+        } else if (!bakedFunctions.isEmpty()) {
+            qWarning("Warning: Native item not exported, baked functions are not supported");
+        } else if (!fusedRuns.isEmpty()) {
+            qWarning("Warning: Native item not exported, fused color nodes are not supported");
+        } else if (exportFlags & (CompressedImagesETC2 | CompressedImagesBC)) {
+            // Native item loads images with QImage, which can't read KTX textures
+            qWarning("Warning: Native item not exported, compressed images are not supported");
+        } else {
+            NativeItemGenerator::Settings settings = nativeItemSettings(imageAtlas);
+            settings.headerFilename = nativeHeaderFilename;
+            settings.vertexShaderFilename = vsFilename;
+            settings.fragmentShaderFilename = fsFilename;
+            settings.fragmentShader = fragmentShader;
+            settings.atlasFilename = atlasFilename;
+            // Resource path matching the qrc file, embedded resources or the QML module
+            const QString componentName = QFileInfo(qmlFilename).completeBaseName();
+            settings.className = componentName + "Item";
+            if (exportFlags & EmbeddedResources)
+                settings.resourcePath = QString(":/%1/").arg(filename.toLower());
+            else if (exportFlags & QmlModule)
+                settings.resourcePath = QString(":/qt/qml/%1/").arg(componentName);
+            else
+                settings.resourcePath = QStringLiteral(":/");
+            auto headerJob = ExportJob::dataJob(nativeHeaderFilename, NativeItemGenerator::cppHeader(settings), FileType::Text);
+            auto sourceJob = ExportJob::dataJob(nativeSourceFilename, NativeItemGenerator::cppSource(settings), FileType::Text);
+            headerJob.includeInQrc = false;
+            sourceJob.includeInQrc = false;
+            jobs << headerJob << sourceJob;
+            nativeItemFilenames << nativeHeaderFilename << nativeSourceFilename;
+        }
+    }
+
+    const bool keepData = exportFlags & EmbeddedResources;
+    QtConcurrent::blockingMap(jobs, [&dirPath, keepData](ExportJob &job) {
+        const QString filePath = dirPath + "/" + job.filename;
+        QByteArray data;
+        if (!job.content(data)) {
+            // Don't leave outdated file behind
+            removeIfExists(filePath);
+            return;
+        }
+        job.ok = writeIfChanged(data, filePath, job.fileType, &job.written);
+        if (keepData)
+            job.data = data;
+    });
+
+    QStringList exportedFilenames;
+    QList<ResourceGenerator::File> resourceFiles;
+    int writtenFiles = 0;
+    for (const auto &job : std::as_const(jobs)) {
+        if (!job.ok) {
+            qWarning("Unable to export file: %s", qPrintable(job.filename));
+            continue;
+        }
+        if (job.written)
+            writtenFiles++;
+        if (job.includeInQrc) {
+            exportedFilenames << job.filename;
+            resourceFiles << ResourceGenerator::File { job.filename, job.data };
+        }
+    }
+
+    // Embed the files into C++ source, registered as in-memory resources
+    if (exportFlags & EmbeddedResources) {
+        const QString componentName = QFileInfo(qmlFilename).completeBaseName();
+        const QString resourcePrefix = filename.toLower();
+        const QByteArray source = ResourceGenerator::cppSource(componentName, resourcePrefix, resourceFiles);
+        const QByteArray header = ResourceGenerator::cppHeader(componentName);
+        bool written = false;
+        if (writeIfChanged(source, dirPath + "/" + cppSourceFilename, FileType::Text, &written) && written)
+            writtenFiles++;
+        if (writeIfChanged(header, dirPath + "/" + cppHeaderFilename, FileType::Text, &written) && written)
+            writtenFiles++;
+    }
+
+    // Module files, so the component can be compiled ahead-of-time with qmlcachegen
+    if (exportFlags & QmlModule) {
+        const QString componentName = QFileInfo(qmlFilename).completeBaseName();
+        QStringList qmlFiles;
+        QStringList resourceFilenames;
+        for (const auto &filename : std::as_const(exportedFilenames)) {
+            if (filename.endsWith(".qml"))
+                qmlFiles << filename;
+            else
+                resourceFilenames << filename;
+        }
+
+        QString qmldir;
+        qmldir += QString("module %1\n").arg(componentName);
+        for (const auto &qmlFile : std::as_const(qmlFiles)) {
+            const QString typeName = QFileInfo(qmlFile).completeBaseName();
+            if (typeName == componentName)
+                qmldir += QString("%1 1.0 %2\n").arg(typeName, qmlFile);
+            else
+                qmldir += QString("internal %1 %2\n").arg(typeName, qmlFile);
+        }
+        bool written = false;
+        if (writeIfChanged(qmldir.toUtf8(), dirPath + "/" + qmldirFilename, FileType::Text, &written) && written)
+            writtenFiles++;
+
+        // Don't overwrite CMakeLists.txt which user has modified or created
+        const QString cmakeHeader = QStringLiteral("# Generated by Qt Quick Effect Maker.");
+        const QString cmakeFilePath = dirPath + "/" + cmakeFilename;
+        QByteArray oldCMake;
+        if (!readFileData(cmakeFilePath, oldCMake) || oldCMake.startsWith(cmakeHeader.toUtf8())) {
+            const QString target = ResourceGenerator::identifierName(componentName.toLower()) + "_effect";
+            QString cmake;
+            cmake += cmakeHeader + " Remove this line to keep manual changes.\n";
+            cmake += "# Add with add_subdirectory() into a project which has found Qt6::Quick\n";
+            cmake += "# and link the application to the plugin target.\n";
+            cmake += '\n';
+            cmake += QString("qt_add_library(%1 STATIC)\n").arg(target);
+            cmake += QString("qt_add_qml_module(%1\n").arg(target);
+            cmake += QString("    URI %1\n").arg(componentName);
+            cmake += "    VERSION 1.0\n";
+            cmake += "    QML_FILES\n";
+            for (const auto &qmlFile : std::as_const(qmlFiles))
+                cmake += QString("        %1\n").arg(qmlFile);
+            if (!resourceFilenames.isEmpty()) {
+                cmake += "    RESOURCES\n";
+                for (const auto &resourceFilename : std::as_const(resourceFilenames))
+                    cmake += QString("        %1\n").arg(resourceFilename);
+            }
+            if (!nativeItemFilenames.isEmpty()) {
+                cmake += "    SOURCES\n";
+                for (const auto &nativeItemFilename : std::as_const(nativeItemFilenames))
+                    cmake += QString("        %1\n").arg(nativeItemFilename);
+            }
+            cmake += ")\n";
+            cmake += QString("target_link_libraries(%1 PRIVATE Qt6::Quick)\n").arg(target);
+            if (writeIfChanged(cmake.toUtf8(), cmakeFilePath, FileType::Text, &written) && written)
+                writtenFiles++;
+        } else {
+            qWarning("Not overwriting modified file: %s", qPrintable(cmakeFilePath));
+        }
     }
 
     if (exportFlags & QRCFile) {
@@ -2211,9 +3764,13 @@ bool EffectManager::exportEffect(const QString &dirPath, const QString &filename
             stream.writeTextElement("file", filename);
         stream.writeEndElement(); // qresource
         stream.writeEndElement(); // RCC
-        writeToFile(qrcXmlString.toUtf8(), qrcFilePath, FileType::Text);
+        bool written = false;
+        if (writeIfChanged(qrcXmlString.toUtf8(), qrcFilePath, FileType::Text, &written) && written)
+            writtenFiles++;
     }
 
+    qInfo() << "Effect exported, files updated:" << writtenFiles;
+
     // Update exportFlags
     if (m_exportFlags != exportFlags) {
         m_exportFlags = exportFlags;
@@ -2222,6 +3779,246 @@ bool EffectManager::exportEffect(const QString &dirPath, const QString &filename
     return true;
 }
 
+// Collects the sampler images which can be packed into an atlas.
+// These are small images without mipmaps, which are sampled only with
+// texture(name, uv) in fragmentShader, so sampling can be redirected
+// into the atlas. Checks are done against the same fragment shader which
+// is then modified with applyImageAtlasToShader().
+// Returns empty atlas when packing wouldn't be useful.
+ImageAtlas EffectManager::createImageAtlas(const QString &fragmentShader)
+{
+    auto countMatches = [](const QString &code, const QRegularExpression &exp) {
+        int count = 0;
+        auto it = exp.globalMatch(code);
+        while (it.hasNext()) {
+            it.next();
+            count++;
+        }
+        return count;
+    };
+
+    ImageAtlas atlas;
+    for (const auto &uniform : std::as_const(m_uniformTable)) {
+        if (!m_nodeView->m_activeNodesIds.contains(uniform.nodeId))
+            continue;
+        if (uniform.type != UniformModel::Uniform::Type::Sampler || !uniform.exportProperty ||
+                !uniform.exportImage || uniform.enableMipmap || uniform.useCustomValue ||
+                !isUniformUsed(uniform))
+            continue;
+        const QString imagePath = stripFileFromURL(uniform.value.toString());
+        if (imagePath.isEmpty())
+            continue;
+        const QString name = QRegularExpression::escape(uniform.name);
+        const QRegularExpression nameExp(QString("\\b%1\\b").arg(name));
+        const QRegularExpression textureExp(QString("\\btexture\\s*\\(\\s*%1\\s*,").arg(name));
+        if (m_vertexShader.contains(nameExp))
+            continue;
+        // The declaration and texture() calls must be the only places where sampler is used
+        const int textureCalls = countMatches(fragmentShader, textureExp);
+        if (textureCalls == 0 || countMatches(fragmentShader, nameExp) != textureCalls + 1)
+            continue;
+        QImage image(imagePath);
+        if (image.isNull() || image.width() > ImageAtlas::MaxImageSize ||
+                image.height() > ImageAtlas::MaxImageSize)
+            continue;
+        atlas.addImage(uniform.name, image);
+    }
+
+    // Packing a single image wouldn't reduce the bindings
+    if (atlas.entries().size() < 2 || !atlas.pack())
+        return ImageAtlas();
+    return atlas;
+}
+
+// Replaces the packed sampler declarations with a single atlas sampler
+// and the texture() calls of those with the atlas helper functions.
+QString EffectManager::applyImageAtlasToShader(const QString &shader, const ImageAtlas &atlas) const
+{
+    const QString atlasSamplerName = QStringLiteral("iImageAtlas");
+    QStringList lines = shader.split('\n');
+    int atlasLineIndex = -1;
+    for (int i = 0; i < lines.size(); i++) {
+        for (const auto &entry : atlas.entries()) {
+            static const QRegularExpression declarationExp("^layout\\(binding = (\\d+)\\) uniform sampler2D (\\w+);$");
+            const auto match = declarationExp.match(lines.at(i).trimmed());
+            if (!match.hasMatch() || match.captured(2) != entry.name)
+                continue;
+            if (atlasLineIndex < 0) {
+                // Atlas takes the binding of the first packed sampler
+                lines[i] = QString("layout(binding = %1) uniform sampler2D %2;").arg(match.captured(1), atlasSamplerName);
+                atlasLineIndex = i;
+            } else {
+                lines.removeAt(i);
+                i--;
+            }
+            break;
+        }
+    }
+    if (atlasLineIndex < 0)
+        return shader;
+
+    lines.insert(atlasLineIndex + 1, atlas.shaderHelpers(atlasSamplerName));
+    QString s = lines.join('\n');
+    for (const auto &entry : atlas.entries()) {
+        const QRegularExpression textureExp(QString("\\btexture\\s*\\(\\s*%1\\s*,")
+                                            .arg(QRegularExpression::escape(entry.name)));
+        s.replace(textureExp, ImageAtlas::helperFunctionName(entry.name) + "(");
+    }
+    return s;
+}
+
+// Removes the properties & Image elements of the packed images from the
+// exported QML and adds the atlas image instead. Removed properties are
+// replaced with comments, so the changed component API is visible.
+void EffectManager::applyImageAtlasToQml(QStringList &qmlLines, const ImageAtlas &atlas, const QString &atlasFilename)
+{
+    QHash<QString, QString> imageElementNames;
+    for (const auto &uniform : std::as_const(m_uniformTable)) {
+        for (const auto &entry : atlas.entries()) {
+            if (entry.name == uniform.name)
+                imageElementNames.insert(entry.name, UniformModel::getImageElementName(uniform));
+        }
+    }
+
+    const QString atlasElementName = QStringLiteral("imageItemImageAtlas");
+    bool atlasPropertyAdded = false;
+    bool atlasImageAdded = false;
+    for (int i = 0; i < qmlLines.size(); i++) {
+        const QString line = qmlLines.at(i).trimmed();
+        for (auto it = imageElementNames.cbegin(); it != imageElementNames.cend(); ++it) {
+            const QString &name = it.key();
+            const QString &elementName = it.value();
+            if (line == QString("property Item %1: %2").arg(name, elementName)) {
+                // Root property, remove together with its description comments
+                qmlLines[i] = QString("    // Image property '%1' is packed into '%2' and not available").arg(name, atlasFilename);
+                while (i > 0 && qmlLines.at(i - 1).startsWith("    //")) {
+                    qmlLines.removeAt(i - 1);
+                    i--;
+                }
+                break;
+            } else if (line.startsWith(QString("readonly property Item %1:").arg(name))) {
+                if (!atlasPropertyAdded) {
+                    qmlLines[i] = QString("        readonly property Item iImageAtlas: %1").arg(atlasElementName);
+                    atlasPropertyAdded = true;
+                } else {
+                    qmlLines.removeAt(i);
+                    i--;
+                }
+                break;
+            } else if (line == "Image {" && i + 1 < qmlLines.size()
+                       && qmlLines.at(i + 1).trimmed() == "id: " + elementName) {
+                int end = i + 1;
+                while (end < qmlLines.size() && qmlLines.at(end).trimmed() != "}")
+                    end++;
+                for (int j = end; j >= i; j--) {
+                    if (j < qmlLines.size())
+                        qmlLines.removeAt(j);
+                }
+                if (!atlasImageAdded) {
+                    const QStringList atlasImage = {
+                        "        Image {",
+                        QString("            id: %1").arg(atlasElementName),
+                        "            anchors.fill: parent",
+                        QString("            source: \"%1\"").arg(atlasFilename),
+                        "            visible: false",
+                        "        }"
+                    };
+                    for (int j = 0; j < atlasImage.size(); j++)
+                        qmlLines.insert(i + j, atlasImage.at(j));
+                    i += atlasImage.size();
+                    atlasImageAdded = true;
+                }
+                i--;
+                break;
+            }
+        }
+    }
+}
+
+// Returns the features which can't be exported into native item,
+// as these need the QML engine.
+QStringList EffectManager::nativeItemUnsupportedFeatures() const
+{
+    QStringList features;
+    if (m_shaderFeatures.enabled(ShaderFeatures::BlurSources))
+        features << QStringLiteral("BlurHelper");
+    if (m_nodeView) {
+        for (auto n : m_nodeView->m_activeNodesList) {
+            if (!n->disabled && !n->qmlCode.isEmpty())
+                features << QString("QML code of node '%1'").arg(n->name);
+        }
+    }
+    for (const auto &uniform : m_uniformTable) {
+        if (!m_nodeView->m_activeNodesIds.contains(uniform.nodeId))
+            continue;
+        if (uniform.exportProperty && uniform.useCustomValue)
+            features << QString("custom value of property '%1'").arg(QString::fromUtf8(uniform.name));
+    }
+    return features;
+}
+
+NativeItemGenerator::Settings EffectManager::nativeItemSettings(const ImageAtlas &atlas) const
+{
+    NativeItemGenerator::Settings settings;
+    if (m_shaderFeatures.enabled(ShaderFeatures::GridMesh))
+        settings.gridMeshSize = QSize(m_shaderFeatures.m_gridMeshWidth, m_shaderFeatures.m_gridMeshHeight);
+    for (const auto &uniform : m_uniformTable) {
+        if (!m_nodeView->m_activeNodesIds.contains(uniform.nodeId))
+            continue;
+        if (!uniform.exportProperty || uniform.type == UniformModel::Uniform::Type::Define)
+            continue;
+        const bool isPacked = std::any_of(atlas.entries().cbegin(), atlas.entries().cend(),
+                                          [&uniform](const ImageAtlas::Entry &entry) {
+            return entry.name == uniform.name;
+        });
+        if (isPacked)
+            continue;
+        NativeItemGenerator::Property property;
+        property.name = QString::fromUtf8(uniform.name);
+        property.description = uniform.description;
+        property.defaultValue = uniform.value;
+        switch (uniform.type) {
+        case UniformModel::Uniform::Type::Bool:
+            property.type = NativeItemGenerator::PropertyType::Bool;
+            break;
+        case UniformModel::Uniform::Type::Int:
+            property.type = NativeItemGenerator::PropertyType::Int;
+            break;
+        case UniformModel::Uniform::Type::Float:
+            property.type = NativeItemGenerator::PropertyType::Real;
+            break;
+        case UniformModel::Uniform::Type::Vec2:
+            property.type = NativeItemGenerator::PropertyType::Point;
+            property.defaultValue = uniform.value.value<QVector2D>().toPointF();
+            break;
+        case UniformModel::Uniform::Type::Vec3:
+            property.type = NativeItemGenerator::PropertyType::Vector3D;
+            break;
+        case UniformModel::Uniform::Type::Vec4:
+            property.type = NativeItemGenerator::PropertyType::Vector4D;
+            break;
+        case UniformModel::Uniform::Type::Color:
+            property.type = NativeItemGenerator::PropertyType::Color;
+            break;
+        case UniformModel::Uniform::Type::Sampler: {
+            property.type = NativeItemGenerator::PropertyType::Image;
+            property.mipmap = uniform.enableMipmap;
+            // Images are loaded from the exported files
+            const QString imagePath = uniform.value.toString();
+            if (uniform.exportImage && !imagePath.isEmpty())
+                property.defaultValue = QFileInfo(imagePath).fileName();
+            else
+                property.defaultValue = QString();
+            break;
+        }
+        case UniformModel::Uniform::Type::Define:
+            break;
+        }
+        settings.properties << property;
+    }
+    return settings;
+}
+
 QFile EffectManager::resolveFileFromUrl(const QUrl &fileUrl)
 {
     const QQmlContext *context = qmlContext(this);
@@ -2391,16 +4188,14 @@ void EffectManager::setEffectHeadings(const QString &newEffectHeadings)
     Q_EMIT effectHeadingsChanged();
 }
 
-void EffectManager::autoIndentCurrentCode(int codeTab, const QString &code)
+// Indents the selected lines of the editor, the edited text is then
+// updated into the node code like when typing.
+void EffectManager::autoIndentCurrentCode(int codeTab, QQuickTextEdit *textEdit)
 {
     if (codeTab == 0) {
         // Note: Indent for QML not implemented yet
-    } else if (codeTab == 1) {
-        const QString indentedCode = m_codeHelper->autoIndentGLSLCode(code);
-        m_nodeView->setSelectedNodeVertexCode(indentedCode);
     } else {
-        const QString indentedCode = m_codeHelper->autoIndentGLSLCode(code);
-        m_nodeView->setSelectedNodeFragmentCode(indentedCode);
+        m_codeHelper->autoIndentGLSLRange(textEdit);
     }
 }
 
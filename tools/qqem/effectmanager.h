@@ -9,6 +9,10 @@
 #include <QTimer>
 #include <QQmlPropertyMap>
 #include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QPromise>
+#include <QJsonObject>
+#include <QCborMap>
 #include "uniformmodel.h"
 #include "nodeview.h"
 #include "shaderfeatures.h"
@@ -17,13 +21,67 @@
 #include "addnodemodel.h"
 #include "applicationsettings.h"
 #include "codehelper.h"
+#include "colorlutfuser.h"
+#include "expressionhoister.h"
+#include "functionbaker.h"
+#include "glslsymbolindex.h"
+#include "gpumemoryestimator.h"
+#include "imageatlas.h"
+#include "nativeitemgenerator.h"
 
 // The delay in ms to wait until updating the effect
 const int EFFECT_UPDATE_DELAY = 200;
 
+// Default size of the GridMesh cells in pixels
+const int DEFAULT_MESH_CELL_SIZE = 8;
+
+// Varying locations which all the shader targets support.
+// GLSL ES 2.0 guarantees 8 varying vectors, GLSL ES 3.0 15.
+const int MAX_VARYINGS_LEGACY = 8;
+const int MAX_VARYINGS = 15;
+
 // This will be used for commandline arguments.
 extern QQmlPropertyMap g_argData;
 
+// Result of the project save. Tagged with the saved file and project
+// revision, so results of outdated background saves can be ignored.
+struct ProjectSaveResult {
+    QString projectFilePath;
+    quint64 revision = 0;
+    QByteArray hash;
+    QString error;
+    bool skipped = false;
+    // Explicit saves (not autosaves) are reported with projectSaved()
+    bool explicitSave = false;
+    QUrl fileUrl;
+    bool addToRecentProjects = false;
+};
+
+// Snapshot of the project to be saved in a worker thread
+struct ProjectSaveJob {
+    QString projectFilePath;
+    QJsonObject rootJson;
+    // When set, writing is skipped if the content hash matches
+    QByteArray previousHash;
+    quint64 revision = 0;
+    bool explicitSave = false;
+    QUrl fileUrl;
+    bool addToRecentProjects = false;
+};
+
+// Project model, which is read and parsed in a worker thread and
+// then applied into the nodes, arrows and uniform models at once
+struct ProjectLoadData {
+    QString error;
+    QString warning;
+    // Contents of the "QEP" element
+    QJsonObject json;
+    double qqemVersion = 0.4;
+    QList<NodesModel::Node> nodes;
+    // Pairs of (fromId, toId)
+    QList<QPair<int, int>> connections;
+};
+
 struct EffectError {
     Q_GADGET
     Q_PROPERTY(QString message MEMBER m_message)
@@ -62,6 +120,8 @@ class EffectManager : public QObject
     Q_PROPERTY(QRect effectPadding READ effectPadding WRITE setEffectPadding NOTIFY effectPaddingChanged)
     Q_PROPERTY(QString effectHeadings READ effectHeadings WRITE setEffectHeadings NOTIFY effectHeadingsChanged)
     Q_PROPERTY(ApplicationSettings * settings READ settings NOTIFY settingsChanged)
+    Q_PROPERTY(bool projectLoading READ projectLoading NOTIFY projectLoadingChanged)
+    Q_PROPERTY(qreal projectLoadProgress READ projectLoadProgress NOTIFY projectLoadProgressChanged)
     QML_ELEMENT
 
 public:
@@ -119,6 +179,9 @@ public:
         return m_settings;
     }
 
+    bool projectLoading() const;
+    qreal projectLoadProgress() const;
+
     Q_INVOKABLE QString mipmapPropertyName(const QString &name) const;
     Q_INVOKABLE QString getSupportedImageFormatsFilter() const;
 
@@ -126,6 +189,13 @@ public:
         return EFFECT_UPDATE_DELAY;
     }
 
+    Q_INVOKABLE int defaultMeshCellSize() const {
+        return DEFAULT_MESH_CELL_SIZE;
+    }
+
+    Q_INVOKABLE QVariantMap gpuMemoryUsage(const QSize &sourceSize, int blurPixels);
+    Q_INVOKABLE QVariantMap goToSymbol(const QString &name, int stage, int line, bool nextUsage);
+
 public Q_SLOTS:
     QString generateVertexShader(bool includeUniforms = true);
     QString generateFragmentShader(bool includeUniforms = true);
@@ -134,8 +204,10 @@ public Q_SLOTS:
     NodesModel::Node loadEffectNode(const QString &filename);
     bool addEffectNode(const QString &filename, int startNodeId = -1, int endNodeId = -1);
     bool deleteEffectNodes(QList<int> nodeIds);
-    bool loadProject(const QUrl &filename);
+    bool loadProject(const QUrl &filename, bool background = true);
     bool saveProject(const QUrl &filename = QString());
+    void autoSaveProject();
+    void updateAutoSaveTimer();
     bool newProject(const QString &filepath, const QString &filename, bool clearNodeView, bool createProjectDir = false);
     void closeProject();
     bool exportEffect(const QString &dirPath, const QString &filename, int exportFlags, int qsbVersionIndex);
@@ -155,7 +227,7 @@ public Q_SLOTS:
     QString addFileToURL(const QString &urlString) const;
     QString getDirectory(const QString &path, bool useFileScheme = true) const;
     QString getDefaultImagesDirectory(bool useFileScheme = true) const;
-    void autoIndentCurrentCode(int codeTab, const QString &code);
+    void autoIndentCurrentCode(int codeTab, QQuickTextEdit *textEdit);
     bool processKey(int codeTab, int keyCode, int modifiers, QQuickTextEdit *textEdit);
     void setEffectError(const QString &errorMessage, int type = -1, int lineNumber = -1);
     void resetEffectError(int type = -1);
@@ -187,6 +259,10 @@ signals:
     void effectPaddingChanged();
     void effectHeadingsChanged();
     void settingsChanged();
+    void projectLoadingChanged();
+    void projectLoadProgressChanged();
+    // Emitted when the save started with saveProject() has finished
+    void projectSaved(bool saved);
 
 private:
     friend class AddNodeModel;
@@ -197,7 +273,22 @@ private:
         QSBShaders = 2,
         TextShaders = 4,
         Images = 8,
-        QRCFile = 16
+        QRCFile = 16,
+        // Sampler images transcoded into GPU compressed KTX textures
+        CompressedImagesETC2 = 32,
+        CompressedImagesBC = 64,
+        // Small sampler images packed into a single atlas image
+        PackedImages = 128,
+        // C++ source with the exported files embedded as resources
+        EmbeddedResources = 256,
+        // qmldir and CMakeLists.txt for adding the component as a QML module
+        QmlModule = 512,
+        // C++ QQuickItem which renders the effect with a custom QSGMaterial
+        NativeItem = 1024,
+        // Functions marked with "@bake" evaluated into textures
+        BakedFunctions = 2048,
+        // Runs of color adjusting nodes replaced with a single 3D LUT lookup
+        FusedColorNodes = 4096
     };
 
     enum ErrorTypes {
@@ -223,27 +314,67 @@ private:
     QString processVertexRootLine(const QString &line);
     QString processFragmentRootLine(const QString &line);
     QString getCustomShaderVaryings(bool outState);
+    static QString getNodeMainCode(const QStringList &code, int mainIndex);
+    QString getFragmentRootCode();
+    QString getBakeShaderHeader(const QString &rootCode);
+    QString getBakeShader(const FunctionBaker::Function &function);
+    QList<QPair<FunctionBaker::Function, QImage>> bakeFunctions();
+    static QString bakedFunctionFilename(const QString &filename, const FunctionBaker::Function &function);
+    QList<QPair<ColorLutFuser::Run, QImage>> fuseColorNodes();
+    static QString fusedColorLutFilename(const QString &filename, int index);
+    static void addGeneratedImagesToQml(QStringList &qmlLines, const QList<QPair<QString, QString>> &images);
+    void updateNodesSymbolIndex();
+    void addImagesToGpuMemory(GpuMemoryEstimator &estimator, int exportFlags, const ImageAtlas &imageAtlas);
+    void updateHoistedExpressions();
     QStringList removeTagsFromCode(const QStringList &codeLines);
     QString removeTagsFromCode(const QString &code);
-    QString replaceOldTagsWithNew(const QString &code);
+    static QString replaceOldTagsWithNew(const QString &code);
     QString detectErrorMessage(const QString &errorMessage);
 
     void doBakeShaders();
+    bool isHoistingError(const QString &shader, const QString &errorMessage) const;
+    QSet<QString> findUnusedUniforms(const QShader &vertShader, const QShader &fragShader) const;
+    bool isUniformUsed(const UniformModel::Uniform &uniform) const;
+    int blurHelperMipmapValue() const;
+    bool useMipmapBlur() const;
+    bool isMipmapBlurSupported(const QString &fragmentShader) const;
     QFile resolveFileFromUrl(const QUrl &fileUrl);
     bool createNodeFromJson(const QJsonObject &rootJson, NodesModel::Node &node, bool fullNode, const QString &nodePath);
+    static bool parseNodeFromJson(const QJsonObject &rootJson, NodesModel::Node &node, bool fullNode, const QString &nodePath, QString *error);
+    template <typename Map>
+    static bool parseNodeObject(const Map &json, NodesModel::Node &node, const QString &nodePath, QString *error);
+    void finalizeNode(NodesModel::Node &node);
     bool addNodeIntoView(NodesModel::Node &node, int startNodeId = -1, int endNodeId = -1);
     bool addNodeConnection(int startNodeId, int endNodeId);
     int getTagIndex(const QStringList &code, const QString &tag);
     QJsonObject nodeToJson(const NodesModel::Node &node, bool simplified, const QString &nodePath);
-    QString codeFromJsonArray(const QJsonArray &codeArray);
+    static bool readProjectCache(const QString &projectFilePath, QCborMap &rootCbor);
+    static ProjectLoadData readProjectData(const QString &projectFilePath, QPromise<ProjectLoadData> *promise = nullptr);
+    template <typename Map>
+    static void readProjectObject(const Map &rootJson, const QString &projectFilePath,
+                                  ProjectLoadData &data, QPromise<ProjectLoadData> *promise);
+    bool applyProjectData(const ProjectLoadData &data, const QUrl &filename);
+    void handleProjectLoaded();
+    void setProjectLoading(bool loading);
+    QJsonObject projectToJson(const QString &projectPath);
+    static ProjectSaveResult writeProjectFiles(const QString &projectFilePath, const QJsonObject &rootJson, const QByteArray &previousHash);
+    void startProjectSave(const ProjectSaveJob &job);
+    bool applyProjectSaveResult(const ProjectSaveResult &result);
+    void handleProjectSaved();
     QString absoluteToRelativePath(const QString &path, const QString &toPath = QString());
-    QString relativeToAbsolutePath(const QString &path, const QString &toPath = QString());
+    static QString relativeToAbsolutePath(const QString &path, const QString &toPath = QString());
     void updateImageWatchers();
     void clearImageWatchers();
+    ImageAtlas createImageAtlas(const QString &fragmentShader);
+    QString applyImageAtlasToShader(const QString &shader, const ImageAtlas &atlas) const;
+    void applyImageAtlasToQml(QStringList &qmlLines, const ImageAtlas &atlas, const QString &atlasFilename);
+    QStringList nativeItemUnsupportedFeatures() const;
+    NativeItemGenerator::Settings nativeItemSettings(const ImageAtlas &atlas) const;
 
     UniformModel *m_uniformModel = nullptr;
     UniformModel::UniformTable m_uniformTable;
     CodeHelper *m_codeHelper = nullptr;
+    GlslSymbolIndex *m_symbolIndex = nullptr;
     QString m_fragmentShader;
     QString m_vertexShader;
     QString m_qmlCode;
@@ -273,6 +404,14 @@ private:
 
     ApplicationSettings *m_settings = nullptr;
     QShaderBaker m_baker;
+    // Bakes only SPIR-V, used to find out the unused uniforms before the full bake
+    QShaderBaker m_probeBaker;
+    // Shader targets used in baking, also by the export
+    QList<QShaderBaker::GeneratedShader> m_generatedShaders;
+    // Exported uniforms which the shaders don't use, these are left out of the shaders
+    QSet<QString> m_unusedUniforms;
+    // True while baking with all the uniforms, to find out the unused ones
+    bool m_keepUnusedUniforms = false;
     NodeView *m_nodeView = nullptr;
     QMap<int, EffectError> m_effectErrors;
     QString m_fragmentShaderFilename;
@@ -291,9 +430,43 @@ private:
     ShaderFeatures m_shaderFeatures;
     AddNodeModel *m_addNodeModel = nullptr;
     QStringList m_shaderVaryingVariables;
+    // Preprocessor conditions of the varyings declared inside #if blocks
+    QHash<QString, QStringList> m_shaderVaryingConditions;
+    // Open preprocessor conditions while processing the vertex root code
+    QList<QStringList> m_vertexRootConditions;
+    // Fragment shader expressions which are calculated in the vertex shader
+    QList<ExpressionHoister::Hoisted> m_hoistedExpressions;
+    // False when the hoisted expressions fail to compile
+    bool m_hoistExpressions = true;
+    // Source size and BlurHelper pixels of the preview, for the GPU memory estimates
+    QSize m_previewSourceSize;
+    int m_previewBlurPixels = 0;
+    // True when BlurHelper uses mipmaps for the current component
+    bool m_mipmapBlur = false;
+    // False when the blurred sources are used in ways which mipmap blur can't replace
+    bool m_mipmapBlurSupported = true;
+    // Node main codes used instead of the node code, e.g. fused nodes
+    QHash<int, QString> m_nodeMainCodeOverrides;
     QRect m_effectPadding;
     QString m_effectHeadings;
     QFileSystemWatcher m_fileWatcher;
+    QFutureWatcher<ProjectSaveResult> m_projectSaveWatcher;
+    // True while a background save is in progress
+    bool m_projectSaving = false;
+    // Explicit save requested while the previous save was in progress
+    bool m_pendingProjectSave = false;
+    ProjectSaveJob m_pendingProjectSaveJob;
+    // Increased on every project change, to detect changes made during the save
+    quint64 m_projectRevision = 0;
+    // Revision and hash of the latest saved project content
+    quint64 m_savedProjectRevision = 0;
+    QByteArray m_savedProjectHash;
+    QTimer m_autoSaveTimer;
+    QFutureWatcher<ProjectLoadData> m_projectLoadWatcher;
+    // Project which is currently being loaded in the background
+    QUrl m_loadingProjectFilename;
+    bool m_projectLoading = false;
+    qreal m_projectLoadProgress = 0.0;
 };
 
 #endif // EFFECTMANAGER_H
@@ -0,0 +1,576 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "expressionhoister.h"
+#include <QHash>
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+
+enum class TokenType {
+    Identifier,
+    Number,
+    Operator,
+    Preprocessor
+};
+
+struct Token {
+    TokenType type;
+    QStringView text;
+    qsizetype start = 0;
+};
+
+// How an expression changes over the rendered item
+enum class Dependency {
+    // Same value for every fragment
+    Constant,
+    // Linear function of texCoord, so interpolation gives the exact value
+    Linear,
+    // Has to be calculated per fragment
+    Varying
+};
+
+const QStringList MULTI_CHAR_OPERATORS = {
+    "<<=", ">>=", "++", "--", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=",
+    "==", "!=", "<=", ">=", "&&", "||", "^^", "<<", ">>"
+};
+
+const QStringList ASSIGNMENT_OPERATORS = {
+    "=", "+=", "-=", "*=", "/=", "%=", "<<=", ">>=", "&=", "|=", "^="
+};
+
+// Types which can be passed as varyings without flat interpolation
+const QStringList HOISTABLE_TYPES = {
+    "float", "vec2", "vec3", "vec4"
+};
+
+// Constructors which keep the linearity of their arguments
+const QStringList LINEAR_CONSTRUCTORS = {
+    "float", "vec2", "vec3", "vec4", "mat2", "mat3", "mat4"
+};
+
+// Built-in functions which don't have side effects and are available in
+// the vertex shader. Result is constant when all the arguments are.
+const QStringList PURE_FUNCTIONS = {
+    "radians", "degrees", "sin", "cos", "tan", "asin", "acos", "atan",
+    "sinh", "cosh", "tanh", "pow", "exp", "log", "exp2", "log2", "sqrt",
+    "inversesqrt", "abs", "sign", "floor", "ceil", "fract", "mod", "min",
+    "max", "clamp", "mix", "step", "smoothstep", "length", "distance", "dot",
+    "cross", "normalize", "int", "uint", "bool", "ivec2", "ivec3", "ivec4",
+    "bvec2", "bvec3", "bvec4"
+};
+
+// Other built-in functions which only read their arguments. Variables passed
+// to any other function may be modified through out or inout parameters.
+const QStringList READ_ONLY_FUNCTIONS = {
+    "texture", "textureLod", "textureGrad", "textureOffset", "texelFetch",
+    "textureSize", "dFdx", "dFdy", "fwidth", "reflect", "refract",
+    "faceforward", "transpose", "inverse", "determinant", "lessThan",
+    "lessThanEqual", "greaterThan", "greaterThanEqual", "equal", "notEqual",
+    "any", "all", "not", "trunc", "round", "roundEven", "isnan", "isinf"
+};
+
+// Keywords which are followed by parentheses, but are not function calls
+const QStringList CONTROL_KEYWORDS = {
+    "if", "for", "while", "switch", "return"
+};
+
+// Expressions need to cost at least this much to be worth a varying
+const int MIN_HOISTED_COST = 2;
+
+bool isIdentifierChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+// Splits the code into tokens, leaving out comments and whitespace.
+// Preprocessor directives are returned as single tokens.
+QList<Token> tokenize(const QString &code)
+{
+    QList<Token> tokens;
+    const QStringView view(code);
+    const qsizetype n = view.size();
+    bool lineStart = true;
+    qsizetype i = 0;
+    while (i < n) {
+        const QChar c = view.at(i);
+        if (c == QLatin1Char('\n')) {
+            lineStart = true;
+            i++;
+            continue;
+        }
+        if (c.isSpace()) {
+            i++;
+            continue;
+        }
+        const qsizetype start = i;
+        if (c == QLatin1Char('/') && i + 1 < n && view.at(i + 1) == QLatin1Char('/')) {
+            while (i < n && view.at(i) != QLatin1Char('\n'))
+                i++;
+            continue;
+        }
+        if (c == QLatin1Char('/') && i + 1 < n && view.at(i + 1) == QLatin1Char('*')) {
+            const qsizetype end = view.indexOf(u"*/", i + 2);
+            i = end < 0 ? n : end + 2;
+            continue;
+        }
+        if (c == QLatin1Char('#') && lineStart) {
+            while (i < n && view.at(i) != QLatin1Char('\n'))
+                i++;
+            tokens.append({ TokenType::Preprocessor, view.sliced(start, i - start), start });
+            continue;
+        }
+        lineStart = false;
+        if (c.isLetter() || c == QLatin1Char('_')) {
+            while (i < n && isIdentifierChar(view.at(i)))
+                i++;
+            tokens.append({ TokenType::Identifier, view.sliced(start, i - start), start });
+        } else if (c.isDigit() || (c == QLatin1Char('.') && i + 1 < n && view.at(i + 1).isDigit())) {
+            // Numbers, including suffixes and exponents like "1.0e-5f"
+            while (i < n) {
+                const QChar d = view.at(i);
+                if ((d == QLatin1Char('-') || d == QLatin1Char('+'))
+                        && (view.at(i - 1) == QLatin1Char('e') || view.at(i - 1) == QLatin1Char('E'))) {
+                    i++;
+                } else if (isIdentifierChar(d) || d == QLatin1Char('.')) {
+                    i++;
+                } else {
+                    break;
+                }
+            }
+            tokens.append({ TokenType::Number, view.sliced(start, i - start), start });
+        } else {
+            qsizetype length = 1;
+            for (const auto &op : MULTI_CHAR_OPERATORS) {
+                if (view.sliced(i).startsWith(op)) {
+                    length = op.size();
+                    break;
+                }
+            }
+            i += length;
+            tokens.append({ TokenType::Operator, view.sliced(start, length), start });
+        }
+    }
+    return tokens;
+}
+
+bool isOperator(const Token &token, QStringView op)
+{
+    return token.type == TokenType::Operator && token.text == op;
+}
+
+int binaryPrecedence(const Token &token)
+{
+    if (token.type != TokenType::Operator)
+        return 0;
+    static const QHash<QString, int> precedences = {
+        { "||", 1 }, { "^^", 2 }, { "&&", 3 }, { "|", 4 }, { "^", 5 }, { "&", 6 },
+        { "==", 7 }, { "!=", 7 }, { "<", 8 }, { ">", 8 }, { "<=", 8 }, { ">=", 8 },
+        { "<<", 9 }, { ">>", 9 }, { "+", 10 }, { "-", 10 }, { "*", 11 }, { "/", 11 }, { "%", 11 }
+    };
+    return precedences.value(token.text.toString(), 0);
+}
+
+// Recursive descent parser which finds out the dependency of an expression
+class ExpressionParser
+{
+public:
+    ExpressionParser(const QList<Token> &tokens, qsizetype begin, qsizetype end,
+                     const QSet<QString> &uniforms, const QSet<QString> &constants,
+                     const QHash<QString, Dependency> &locals)
+        : m_tokens(tokens), m_pos(begin), m_end(end), m_uniforms(uniforms),
+          m_constants(constants), m_locals(locals)
+    {
+    }
+
+    // Returns the dependency of the whole expression, Varying when it
+    // can't be parsed.
+    Dependency parse()
+    {
+        Dependency d = parseTernary();
+        if (m_failed || m_pos != m_end)
+            return Dependency::Varying;
+        return d;
+    }
+
+    int cost() const { return m_cost; }
+    // True when the expression uses uniforms or texCoord, not just constants
+    bool isDynamic() const { return m_dynamic; }
+
+private:
+    bool atOperator(QStringView op) const
+    {
+        return m_pos < m_end && isOperator(m_tokens.at(m_pos), op);
+    }
+
+    bool expect(QStringView op)
+    {
+        if (!atOperator(op)) {
+            m_failed = true;
+            return false;
+        }
+        m_pos++;
+        return true;
+    }
+
+    Dependency parseTernary()
+    {
+        Dependency condition = parseBinary(1);
+        if (!atOperator(u"?"))
+            return condition;
+        m_pos++;
+        Dependency first = parseTernary();
+        expect(u":");
+        Dependency second = parseTernary();
+        if (condition != Dependency::Constant)
+            return Dependency::Varying;
+        return std::max(first, second);
+    }
+
+    Dependency parseBinary(int minPrecedence)
+    {
+        Dependency lhs = parseUnary();
+        while (m_pos < m_end && !m_failed) {
+            const Token &op = m_tokens.at(m_pos);
+            const int precedence = binaryPrecedence(op);
+            if (precedence == 0 || precedence < minPrecedence)
+                break;
+            m_pos++;
+            Dependency rhs = parseBinary(precedence + 1);
+            lhs = combine(op.text, lhs, rhs);
+        }
+        return lhs;
+    }
+
+    Dependency combine(QStringView op, Dependency lhs, Dependency rhs)
+    {
+        m_cost++;
+        if (op == u"+" || op == u"-")
+            return std::max(lhs, rhs);
+        if (op == u"*") {
+            if (lhs != Dependency::Constant && rhs != Dependency::Constant)
+                return Dependency::Varying;
+            return std::max(lhs, rhs);
+        }
+        if (op == u"/")
+            return rhs == Dependency::Constant ? lhs : Dependency::Varying;
+        // Comparisons, logical and bitwise operators are not linear
+        if (lhs == Dependency::Constant && rhs == Dependency::Constant)
+            return Dependency::Constant;
+        return Dependency::Varying;
+    }
+
+    Dependency parseUnary()
+    {
+        if (atOperator(u"-") || atOperator(u"+")) {
+            m_pos++;
+            return parseUnary();
+        }
+        if (atOperator(u"!") || atOperator(u"~")) {
+            m_pos++;
+            Dependency d = parseUnary();
+            return d == Dependency::Constant ? d : Dependency::Varying;
+        }
+        return parsePostfix();
+    }
+
+    Dependency parsePostfix()
+    {
+        Dependency d = parsePrimary();
+        while (m_pos < m_end && !m_failed) {
+            if (atOperator(u".")) {
+                // Swizzle or struct member
+                m_pos++;
+                if (m_pos >= m_end || m_tokens.at(m_pos).type != TokenType::Identifier) {
+                    m_failed = true;
+                    break;
+                }
+                m_pos++;
+            } else if (atOperator(u"[")) {
+                m_pos++;
+                Dependency index = parseTernary();
+                expect(u"]");
+                if (index != Dependency::Constant)
+                    d = Dependency::Varying;
+            } else {
+                break;
+            }
+        }
+        return d;
+    }
+
+    Dependency parsePrimary()
+    {
+        if (m_pos >= m_end) {
+            m_failed = true;
+            return Dependency::Varying;
+        }
+        const Token &token = m_tokens.at(m_pos);
+        m_pos++;
+        if (token.type == TokenType::Number)
+            return Dependency::Constant;
+        if (isOperator(token, u"(")) {
+            Dependency d = parseTernary();
+            expect(u")");
+            return d;
+        }
+        if (token.type != TokenType::Identifier) {
+            m_failed = true;
+            return Dependency::Varying;
+        }
+        const QString name = token.text.toString();
+        if (atOperator(u"("))
+            return parseCall(name);
+        if (name == QLatin1String("true") || name == QLatin1String("false"))
+            return Dependency::Constant;
+        if (m_constants.contains(name))
+            return Dependency::Constant;
+        if (name == QLatin1String("texCoord")) {
+            m_dynamic = true;
+            return Dependency::Linear;
+        }
+        if (m_locals.contains(name)) {
+            m_dynamic = true;
+            return m_locals.value(name);
+        }
+        if (m_uniforms.contains(name)) {
+            m_dynamic = true;
+            return Dependency::Constant;
+        }
+        // Other locals, varyings and samplers
+        return Dependency::Varying;
+    }
+
+    Dependency parseCall(const QString &name)
+    {
+        m_pos++;
+        Dependency d = Dependency::Constant;
+        if (!atOperator(u")")) {
+            while (!m_failed) {
+                d = std::max(d, parseTernary());
+                if (!atOperator(u","))
+                    break;
+                m_pos++;
+            }
+        }
+        expect(u")");
+        if (LINEAR_CONSTRUCTORS.contains(name))
+            return d;
+        m_cost += 2;
+        if (PURE_FUNCTIONS.contains(name))
+            return d == Dependency::Constant ? d : Dependency::Varying;
+        // Textures and user functions, which are not available in vertex shader
+        return Dependency::Varying;
+    }
+
+    const QList<Token> &m_tokens;
+    qsizetype m_pos;
+    qsizetype m_end;
+    const QSet<QString> &m_uniforms;
+    const QSet<QString> &m_constants;
+    const QHash<QString, Dependency> &m_locals;
+    int m_cost = 0;
+    bool m_dynamic = false;
+    bool m_failed = false;
+};
+
+// Returns true if the token at index is inside the arguments of a function
+// call, which may write into its out or inout parameters.
+bool isFunctionArgument(const QList<Token> &tokens, qsizetype index)
+{
+    int depth = 0;
+    for (qsizetype i = index - 1; i >= 0; i--) {
+        const Token &token = tokens.at(i);
+        if (isOperator(token, u")")) {
+            depth++;
+        } else if (isOperator(token, u"(")) {
+            if (depth > 0) {
+                depth--;
+                continue;
+            }
+            // Enclosing parenthesis, check if it belongs to a function call
+            if (i > 0 && tokens.at(i - 1).type == TokenType::Identifier) {
+                const QString function = tokens.at(i - 1).text.toString();
+                if (!CONTROL_KEYWORDS.contains(function))
+                    return !PURE_FUNCTIONS.contains(function) && !LINEAR_CONSTRUCTORS.contains(function)
+                            && !READ_ONLY_FUNCTIONS.contains(function);
+            }
+        } else if (depth == 0 && (isOperator(token, u";") || isOperator(token, u"{") || isOperator(token, u"}"))) {
+            break;
+        }
+    }
+    return false;
+}
+
+// Returns true if the variable is written after token index from.
+// Writes into a shadowing variable with the same name also count, as do
+// passing the variable to a function which isn't a read-only built-in.
+bool isModified(const QList<Token> &tokens, qsizetype from, QStringView name)
+{
+    for (qsizetype i = from; i < tokens.size(); i++) {
+        const Token &token = tokens.at(i);
+        if (token.type != TokenType::Identifier || token.text != name)
+            continue;
+        if (i > 0 && isOperator(tokens.at(i - 1), u"."))
+            continue;
+        if (i > 0 && (isOperator(tokens.at(i - 1), u"++") || isOperator(tokens.at(i - 1), u"--")))
+            return true;
+        if (isFunctionArgument(tokens, i))
+            return true;
+        // Skip swizzles and indexing, e.g. "name.x[1] = "
+        qsizetype j = i + 1;
+        while (j < tokens.size()) {
+            if (isOperator(tokens.at(j), u".")) {
+                j += 2;
+            } else if (isOperator(tokens.at(j), u"[")) {
+                int depth = 0;
+                for (; j < tokens.size(); j++) {
+                    if (isOperator(tokens.at(j), u"["))
+                        depth++;
+                    else if (isOperator(tokens.at(j), u"]") && --depth == 0)
+                        break;
+                }
+                j++;
+            } else {
+                break;
+            }
+        }
+        if (j < tokens.size()) {
+            const Token &next = tokens.at(j);
+            if (next.type == TokenType::Operator
+                    && (ASSIGNMENT_OPERATORS.contains(next.text) || next.text == u"++" || next.text == u"--"))
+                return true;
+        }
+    }
+    return false;
+}
+
+// Returns the expression as a single line, with the hoisted locals
+// replaced by their varyings.
+QString vertexExpression(const QList<Token> &tokens, qsizetype begin, qsizetype end,
+                         const QHash<QString, QString> &varyingNames)
+{
+    QString s;
+    for (qsizetype i = begin; i < end; i++) {
+        const Token &token = tokens.at(i);
+        if (i > begin) {
+            const Token &previous = tokens.at(i - 1);
+            if (previous.start + previous.text.size() != token.start)
+                s += QLatin1Char(' ');
+        }
+        const bool member = i > begin && isOperator(tokens.at(i - 1), u".");
+        if (token.type == TokenType::Identifier && !member && varyingNames.contains(token.text.toString()))
+            s += varyingNames.value(token.text.toString());
+        else
+            s += token.text;
+    }
+    return s;
+}
+
+} // namespace
+
+QList<ExpressionHoister::Hoisted> ExpressionHoister::findHoistable(const QString &code, int nodeId,
+                                                                   const QSet<QString> &uniforms,
+                                                                   const QSet<QString> &constants,
+                                                                   int maxCount, int firstIndex)
+{
+    QList<Hoisted> hoisted;
+    if (maxCount <= 0)
+        return hoisted;
+
+    const QList<Token> tokens = tokenize(code);
+    // Node main code is usually inside a block, its statements are on the top level
+    qsizetype first = 0;
+    while (first < tokens.size() && tokens.at(first).type == TokenType::Preprocessor)
+        first++;
+    const int topDepth = (first < tokens.size() && isOperator(tokens.at(first), u"{")) ? 1 : 0;
+
+    QHash<QString, Dependency> locals;
+    QHash<QString, QString> varyingNames;
+    int depth = 0;
+    int preprocessorDepth = 0;
+    qsizetype statementStart = 0;
+    for (qsizetype i = 0; i < tokens.size() && hoisted.size() < maxCount; i++) {
+        const Token &token = tokens.at(i);
+        if (token.type == TokenType::Preprocessor) {
+            const QString directive = token.text.sliced(1).trimmed().toString();
+            if (directive.startsWith(QLatin1String("if")))
+                preprocessorDepth++;
+            else if (directive.startsWith(QLatin1String("endif")))
+                preprocessorDepth--;
+            statementStart = i + 1;
+            continue;
+        }
+        if (isOperator(token, u"{") || isOperator(token, u"}")) {
+            depth += isOperator(token, u"{") ? 1 : -1;
+            if (depth < topDepth) {
+                // Top level block ended, its locals are not visible anymore
+                locals.clear();
+                varyingNames.clear();
+            }
+            statementStart = i + 1;
+            continue;
+        }
+        if (!isOperator(token, u";"))
+            continue;
+
+        const qsizetype start = statementStart;
+        statementStart = i + 1;
+        // Code inside #if blocks and inner blocks is conditional
+        if (preprocessorDepth > 0 || depth > topDepth)
+            continue;
+        // Match "[precision] type name = expression;"
+        qsizetype t = start;
+        if (t < i && tokens.at(t).type == TokenType::Identifier
+                && (tokens.at(t).text == u"lowp" || tokens.at(t).text == u"mediump" || tokens.at(t).text == u"highp"))
+            t++;
+        if (t + 3 >= i)
+            continue;
+        const Token &typeToken = tokens.at(t);
+        const Token &nameToken = tokens.at(t + 1);
+        if (typeToken.type != TokenType::Identifier || !HOISTABLE_TYPES.contains(typeToken.text)
+                || nameToken.type != TokenType::Identifier || !isOperator(tokens.at(t + 2), u"="))
+            continue;
+        const qsizetype expressionBegin = t + 3;
+        const QString name = nameToken.text.toString();
+
+        ExpressionParser parser(tokens, expressionBegin, i, uniforms, constants, locals);
+        const Dependency dependency = parser.parse();
+        if (dependency == Dependency::Varying || !parser.isDynamic())
+            continue;
+        if (isModified(tokens, i + 1, nameToken.text))
+            continue;
+        const QString expression = vertexExpression(tokens, expressionBegin, i, varyingNames);
+        locals.insert(name, dependency);
+        if (parser.cost() < MIN_HOISTED_COST) {
+            // Cheap expressions are kept, interpolating a varying isn't free either.
+            // Expressions using them can still be hoisted, with these inlined.
+            varyingNames.insert(name, QLatin1Char('(') + expression + QLatin1Char(')'));
+            continue;
+        }
+
+        Hoisted h;
+        h.nodeId = nodeId;
+        h.type = typeToken.text.toString();
+        h.name = name;
+        h.varyingName = QString("hoisted%1_%2").arg(firstIndex + hoisted.size()).arg(name);
+        h.expression = expression;
+        h.start = tokens.at(expressionBegin).start;
+        h.length = token.start - h.start;
+        hoisted << h;
+        varyingNames.insert(name, h.varyingName);
+    }
+    return hoisted;
+}
+
+QString ExpressionHoister::applyToCode(const QString &code, int nodeId, const QList<Hoisted> &hoisted)
+{
+    QString s = code;
+    // Replace from the end, so that the earlier ranges stay valid
+    for (auto it = hoisted.crbegin(); it != hoisted.crend(); ++it) {
+        if (it->nodeId == nodeId)
+            s.replace(it->start, it->length, it->varyingName);
+    }
+    return s;
+}
@@ -0,0 +1,42 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef EXPRESSIONHOISTER_H
+#define EXPRESSIONHOISTER_H
+
+#include <QList>
+#include <QSet>
+#include <QString>
+
+// Finds local variables of the fragment shader code which only depend on
+// uniforms, constants or linearly on texCoord. These can be calculated
+// in the vertex shader and passed to the fragment shader as varyings,
+// as the interpolation gives the same result for every fragment.
+class ExpressionHoister
+{
+public:
+    struct Hoisted {
+        int nodeId = -1;
+        // Type and name of the local variable in the fragment shader
+        QString type;
+        QString name;
+        // Name of the varying which replaces the expression
+        QString varyingName;
+        // Expression for the vertex shader
+        QString expression;
+        // Range of the expression in the node code
+        qsizetype start = 0;
+        qsizetype length = 0;
+    };
+
+    // Finds the hoistable declarations from the fragment shader main code of
+    // a node. Uniforms and constants are available in both shader stages.
+    // At most maxCount declarations are hoisted, varyings are numbered
+    // starting from firstIndex.
+    static QList<Hoisted> findHoistable(const QString &code, int nodeId, const QSet<QString> &uniforms,
+                                        const QSet<QString> &constants, int maxCount, int firstIndex);
+    // Replaces the hoisted expressions of the node with their varyings.
+    static QString applyToCode(const QString &code, int nodeId, const QList<Hoisted> &hoisted);
+};
+
+#endif // EXPRESSIONHOISTER_H
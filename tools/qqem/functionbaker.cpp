@@ -0,0 +1,374 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "functionbaker.h"
+#include <QOffscreenSurface>
+#include <QSet>
+#include <QRegularExpression>
+#include <rhi/qrhi.h>
+#include <algorithm>
+#include <memory>
+
+// Covers the whole render target with a single triangle
+static const char *bakeVertexShader =
+        "#version 440\n"
+        "layout(location = 0) out vec2 texCoord;\n"
+        "out gl_PerVertex { vec4 gl_Position; };\n"
+        "void main() {\n"
+        "    vec2 position = vec2(float((gl_VertexIndex & 1) * 4 - 1), float((gl_VertexIndex & 2) * 2 - 1));\n"
+        "    texCoord = position * 0.5 + 0.5;\n"
+        "    gl_Position = vec4(position, 0.0, 1.0);\n"
+        "}\n";
+
+static QShader bakeShader(const QString &source, QShader::Stage stage,
+                          const QList<QShaderBaker::GeneratedShader> &targets, QString *error)
+{
+    QShaderBaker baker;
+    baker.setGeneratedShaderVariants({ QShader::StandardShader });
+    baker.setGeneratedShaders(targets);
+    baker.setSourceString(source.toUtf8(), stage);
+    QShader shader = baker.bake();
+    if (!shader.isValid() && error)
+        *error = baker.errorMessage().split('\n').first();
+    return shader;
+}
+
+static std::unique_ptr<QRhi> createRhi(std::unique_ptr<QOffscreenSurface> &fallbackSurface)
+{
+    std::unique_ptr<QRhi> rhi;
+#if defined(Q_OS_WIN)
+    QRhiD3D11InitParams d3dParams;
+    rhi.reset(QRhi::create(QRhi::D3D11, &d3dParams));
+#elif defined(Q_OS_MACOS) || defined(Q_OS_IOS)
+    QRhiMetalInitParams metalParams;
+    rhi.reset(QRhi::create(QRhi::Metal, &metalParams));
+#endif
+#if QT_CONFIG(opengl)
+    if (!rhi) {
+        fallbackSurface.reset(QRhiGles2InitParams::newFallbackSurface());
+        QRhiGles2InitParams glParams;
+        glParams.fallbackSurface = fallbackSurface.get();
+        rhi.reset(QRhi::create(QRhi::OpenGLES2, &glParams));
+    }
+#else
+    Q_UNUSED(fallbackSurface);
+#endif
+    return rhi;
+}
+
+QList<FunctionBaker::Function> FunctionBaker::findFunctions(const QStringList &codeLines)
+{
+    static const QRegularExpression tagExp("^@bake\\b\\s*(?:(\\d+)\\s*,\\s*(\\d+))?\\s*$");
+    static const QRegularExpression functionExp("^(float|vec2|vec3)\\s+(\\w+)\\s*\\(\\s*(?:in\\s+)?vec2\\s+\\w+\\s*\\)");
+    QList<Function> functions;
+    for (int i = 0; i < codeLines.size(); i++) {
+        const auto tagMatch = tagExp.match(codeLines.at(i).trimmed());
+        if (!tagMatch.hasMatch())
+            continue;
+        // Function is on the next non-empty line
+        int functionLine = i + 1;
+        while (functionLine < codeLines.size() && codeLines.at(functionLine).trimmed().isEmpty())
+            functionLine++;
+        if (functionLine >= codeLines.size())
+            continue;
+        const auto functionMatch = functionExp.match(codeLines.at(functionLine).trimmed());
+        if (!functionMatch.hasMatch()) {
+            qWarning("@bake tag is not followed by a function of vec2 returning float, vec2 or vec3");
+            continue;
+        }
+        Function function;
+        function.returnType = functionMatch.captured(1);
+        function.name = functionMatch.captured(2);
+        function.size = QSize(DefaultSize, DefaultSize);
+        if (tagMatch.hasCaptured(1)) {
+            function.size = QSize(qBound(1, tagMatch.captured(1).toInt(), MaxSize),
+                                  qBound(1, tagMatch.captured(2).toInt(), MaxSize));
+        }
+        QString samplerName = function.name;
+        samplerName[0] = samplerName[0].toUpper();
+        function.samplerName = "iBaked" + samplerName;
+        functions << function;
+    }
+    return functions;
+}
+
+// Top-level part of the code: a function, a declaration or a preprocessor line
+struct CodeChunk {
+    QString text;
+    // Text without the comments
+    QString code;
+    // Name of the function, empty for other chunks
+    QString functionName;
+};
+
+static QList<CodeChunk> splitTopLevel(const QString &code)
+{
+    static const QRegularExpression functionNameExp("(\\w+)\\s*$");
+    QList<CodeChunk> chunks;
+    CodeChunk chunk;
+    int depth = 0;
+    bool lineStart = true;
+    auto endChunk = [&chunks, &chunk]() {
+        if (!chunk.text.trimmed().isEmpty())
+            chunks << chunk;
+        chunk = CodeChunk();
+    };
+    for (qsizetype i = 0; i < code.size(); i++) {
+        const QChar c = code.at(i);
+        if (c == '/' && i + 1 < code.size() && (code.at(i + 1) == '/' || code.at(i + 1) == '*')) {
+            // Comments are kept in the text, but not in the code
+            const bool lineComment = code.at(i + 1) == '/';
+            qsizetype end = lineComment ? code.indexOf('\n', i) : code.indexOf(QLatin1String("*/"), i + 2);
+            end = end < 0 ? code.size() : (lineComment ? end : end + 2);
+            chunk.text += code.mid(i, end - i);
+            i = end - 1;
+            continue;
+        }
+        if (c == '#' && lineStart && depth == 0) {
+            endChunk();
+            qsizetype end = code.indexOf('\n', i);
+            end = end < 0 ? code.size() : end + 1;
+            chunk.text = code.mid(i, end - i);
+            chunk.code = chunk.text;
+            endChunk();
+            i = end - 1;
+            lineStart = true;
+            continue;
+        }
+        chunk.text += c;
+        chunk.code += c;
+        if (c == '\n')
+            lineStart = true;
+        else if (!c.isSpace())
+            lineStart = false;
+        if (c == '{') {
+            if (depth == 0) {
+                // Function, when the header has parameters and this isn't a struct
+                const QString header = chunk.code.left(chunk.code.size() - 1);
+                const qsizetype parameters = header.indexOf('(');
+                if (parameters > 0 && !header.trimmed().startsWith(QLatin1String("struct")))
+                    chunk.functionName = functionNameExp.match(header.left(parameters)).captured(1);
+            }
+            depth++;
+        } else if (c == '}') {
+            depth--;
+            if (depth == 0 && !chunk.functionName.isEmpty())
+                endChunk();
+        } else if (c == ';' && depth == 0) {
+            endChunk();
+        }
+    }
+    endChunk();
+    return chunks;
+}
+
+QString FunctionBaker::dependencyCode(const QString &code, const QString &functionName)
+{
+    static const QRegularExpression identifierExp("\\b[A-Za-z_]\\w*\\b");
+    const QList<CodeChunk> chunks = splitTopLevel(code);
+    QSet<QString> functionNames;
+    for (const auto &chunk : chunks) {
+        if (!chunk.functionName.isEmpty())
+            functionNames << chunk.functionName;
+    }
+    // Collect the functions reachable from the named one, including overloads
+    QSet<QString> required = { functionName };
+    QStringList pending = { functionName };
+    while (!pending.isEmpty()) {
+        const QString name = pending.takeLast();
+        for (const auto &chunk : chunks) {
+            if (chunk.functionName != name)
+                continue;
+            auto it = identifierExp.globalMatch(chunk.code);
+            while (it.hasNext()) {
+                const QString identifier = it.next().captured();
+                if (functionNames.contains(identifier) && !required.contains(identifier)) {
+                    required << identifier;
+                    pending << identifier;
+                }
+            }
+        }
+    }
+    QString s;
+    for (const auto &chunk : chunks) {
+        if (chunk.functionName.isEmpty() || required.contains(chunk.functionName))
+            s += chunk.text;
+    }
+    return s;
+}
+
+QString FunctionBaker::shaderMain(const Function &function)
+{
+    QString value = QString("%1(texCoord)").arg(function.name);
+    if (function.returnType == QLatin1String("float"))
+        value = QString("vec3(%1, 0.0, 0.0)").arg(value);
+    else if (function.returnType == QLatin1String("vec2"))
+        value = QString("vec3(%1, 0.0)").arg(value);
+    QString s;
+    s += "void main() {\n";
+    s += QString("    fragColor = vec4(%1, 1.0);\n").arg(value);
+    s += "}\n";
+    return s;
+}
+
+QImage FunctionBaker::render(const QString &fragmentShader, const QSize &size,
+                             const QList<QShaderBaker::GeneratedShader> &targets, QString *error)
+{
+    auto setError = [error](const QString &message) {
+        if (error)
+            *error = message;
+    };
+    const QShader vs = bakeShader(QString::fromLatin1(bakeVertexShader), QShader::VertexStage, targets, error);
+    const QShader fs = bakeShader(fragmentShader, QShader::FragmentStage, targets, error);
+    if (!vs.isValid() || !fs.isValid())
+        return QImage();
+
+    std::unique_ptr<QOffscreenSurface> fallbackSurface;
+    std::unique_ptr<QRhi> rhi = createRhi(fallbackSurface);
+    if (!rhi) {
+        setError(QStringLiteral("Unable to initialize graphics for baking"));
+        return QImage();
+    }
+
+    std::unique_ptr<QRhiTexture> texture(rhi->newTexture(QRhiTexture::RGBA8, size, 1,
+                                                         QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource));
+    if (!texture->create()) {
+        setError(QStringLiteral("Unable to create the bake texture"));
+        return QImage();
+    }
+    std::unique_ptr<QRhiTextureRenderTarget> renderTarget(rhi->newTextureRenderTarget({ texture.get() }));
+    std::unique_ptr<QRhiRenderPassDescriptor> renderPass(renderTarget->newCompatibleRenderPassDescriptor());
+    renderTarget->setRenderPassDescriptor(renderPass.get());
+    renderTarget->create();
+
+    std::unique_ptr<QRhiShaderResourceBindings> bindings(rhi->newShaderResourceBindings());
+    bindings->create();
+    std::unique_ptr<QRhiGraphicsPipeline> pipeline(rhi->newGraphicsPipeline());
+    pipeline->setShaderStages({ { QRhiShaderStage::Vertex, vs }, { QRhiShaderStage::Fragment, fs } });
+    pipeline->setVertexInputLayout({});
+    pipeline->setShaderResourceBindings(bindings.get());
+    pipeline->setRenderPassDescriptor(renderPass.get());
+    if (!pipeline->create()) {
+        setError(QStringLiteral("Unable to create the bake pipeline"));
+        return QImage();
+    }
+
+    QRhiCommandBuffer *cb = nullptr;
+    if (rhi->beginOffscreenFrame(&cb) != QRhi::FrameOpSuccess) {
+        setError(QStringLiteral("Unable to render the bake frame"));
+        return QImage();
+    }
+    QRhiReadbackResult readback;
+    QRhiResourceUpdateBatch *updates = rhi->nextResourceUpdateBatch();
+    updates->readBackTexture({ texture.get() }, &readback);
+    cb->beginPass(renderTarget.get(), Qt::black, { 1.0f, 0 });
+    cb->setGraphicsPipeline(pipeline.get());
+    cb->setViewport({ 0, 0, float(size.width()), float(size.height()) });
+    cb->draw(3);
+    cb->endPass(updates);
+    rhi->endOffscreenFrame();
+
+    QImage image(reinterpret_cast<const uchar *>(readback.data.constData()),
+                 readback.pixelSize.width(), readback.pixelSize.height(), QImage::Format_RGBA8888);
+    // Flip so that the first row has texCoord.y = 0, like Qt Quick textures
+    const bool flip = rhi->isYUpInNDC() != rhi->isYUpInFramebuffer();
+    return image.mirrored(false, flip);
+}
+
+QString FunctionBaker::addSamplers(const QString &shader, const QStringList &samplerNames)
+{
+    QStringList lines = shader.split('\n');
+    // Samplers are declared after the uniform buffer and the other samplers
+    static const QRegularExpression bindingExp("^layout\\(binding = (\\d+)\\)");
+    int binding = 0;
+    int declarationIndex = -1;
+    for (int i = 0; i < lines.size(); i++) {
+        const QString line = lines.at(i).trimmed();
+        const auto match = bindingExp.match(line);
+        if (match.hasMatch()) {
+            binding = std::max(binding, match.captured(1).toInt());
+            if (line.endsWith(';'))
+                declarationIndex = i;
+        } else if (line == QLatin1String("};") && declarationIndex < 0) {
+            declarationIndex = i;
+        }
+    }
+    if (declarationIndex < 0)
+        return shader;
+    for (int i = samplerNames.size() - 1; i >= 0; i--) {
+        const QString declaration = QString("layout(binding = %1) uniform sampler2D %2;")
+                .arg(binding + 1 + i).arg(samplerNames.at(i));
+        lines.insert(declarationIndex + 1, declaration);
+    }
+    return lines.join('\n');
+}
+
+// Returns true when the argument is texCoord, or a local vec2 which is assigned
+// only once, from texCoord or from another such local
+static bool isTexCoordArgument(const QString &shader, const QString &argument, int depth = 0)
+{
+    const QString name = argument.trimmed();
+    if (name == QLatin1String("texCoord"))
+        return true;
+    static const QRegularExpression identifierExp("^[A-Za-z_]\\w*$");
+    if (depth > 8 || !identifierExp.match(name).hasMatch())
+        return false;
+    const QString escapedName = QRegularExpression::escape(name);
+    const QRegularExpression assignmentExp(QString("\\b%1\\s*(?:[-+*/]=|=(?!=))").arg(escapedName));
+    if (shader.count(assignmentExp) != 1)
+        return false;
+    const QRegularExpression declarationExp(QString("\\bvec2\\s+%1\\s*=\\s*([^;]+);").arg(escapedName));
+    const auto match = declarationExp.match(shader);
+    return match.hasMatch() && isTexCoordArgument(shader, match.captured(1), depth + 1);
+}
+
+QString FunctionBaker::applyToShader(const QString &shader, const QList<Function> &functions,
+                                     QList<SkippedCall> *skippedCalls)
+{
+    QString s = shader;
+    QStringList samplerNames;
+    for (const auto &function : functions) {
+        const QString swizzle = function.returnType == QLatin1String("float") ? QStringLiteral("r")
+                              : function.returnType == QLatin1String("vec2") ? QStringLiteral("rg")
+                                                                              : QStringLiteral("rgb");
+        const QRegularExpression callExp(QString("\\b%1\\s*\\(").arg(QRegularExpression::escape(function.name)));
+        bool replaced = false;
+        qsizetype from = 0;
+        QRegularExpressionMatch match;
+        while ((match = callExp.match(s, from)).hasMatch()) {
+            const qsizetype start = match.capturedStart();
+            // Skip the declaration, which follows the return type
+            const QString before = s.left(start).trimmed();
+            if (before.endsWith(function.returnType)) {
+                from = match.capturedEnd();
+                continue;
+            }
+            // Find the closing parenthesis of the call
+            qsizetype end = match.capturedEnd();
+            int depth = 1;
+            for (; end < s.size() && depth > 0; end++) {
+                if (s.at(end) == '(')
+                    depth++;
+                else if (s.at(end) == ')')
+                    depth--;
+            }
+            if (depth > 0)
+                break;
+            const QString argument = s.mid(match.capturedEnd(), end - 1 - match.capturedEnd());
+            // Scaled or offset UV would fetch the clamped texture, so keep the call
+            if (!isTexCoordArgument(s, argument)) {
+                if (skippedCalls)
+                    skippedCalls->append({ function.name, s.mid(start, end - start) });
+                from = end;
+                continue;
+            }
+            const QString fetch = QString("texture(%1, %2).%3").arg(function.samplerName, argument, swizzle);
+            s.replace(start, end - start, fetch);
+            from = start + fetch.size();
+            replaced = true;
+        }
+        if (replaced)
+            samplerNames << function.samplerName;
+    }
+    return addSamplers(s, samplerNames);
+}
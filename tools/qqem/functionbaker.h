@@ -0,0 +1,65 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef FUNCTIONBAKER_H
+#define FUNCTIONBAKER_H
+
+#include <QImage>
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <rhi/qshaderbaker.h>
+
+// Evaluates fragment shader functions of UV, marked with the "@bake" tag,
+// offscreen into textures. The exported shader then replaces the calls
+// with texture fetches, trading ALU for bandwidth.
+class FunctionBaker
+{
+public:
+    // Texture size when the tag doesn't define it
+    static const int DefaultSize = 256;
+    // Maximum texture size
+    static const int MaxSize = 4096;
+
+    struct Function {
+        // Name and return type (float, vec2 or vec3) of the function
+        QString name;
+        QString returnType;
+        // Size of the baked texture
+        QSize size;
+        // Name of the sampler replacing the function calls
+        QString samplerName;
+    };
+
+    // Finds the functions marked with "@bake [w, h]" tag from the code.
+    // Tag must be on the line before the function, which takes a single
+    // vec2 argument.
+    static QList<Function> findFunctions(const QStringList &codeLines);
+    // Returns the root code with only the functions which the named function
+    // calls directly or indirectly. Other declarations are kept as-is.
+    static QString dependencyCode(const QString &code, const QString &functionName);
+    // Returns main() of the shader evaluating the function
+    static QString shaderMain(const Function &function);
+    // Renders the fragment shader offscreen into RGBA image,
+    // returns null image on failure
+    static QImage render(const QString &fragmentShader, const QSize &size,
+                         const QList<QShaderBaker::GeneratedShader> &targets, QString *error);
+    // Declares the samplers after the existing uniforms and samplers
+    static QString addSamplers(const QString &shader, const QStringList &samplerNames);
+    // Call which was not replaced, as its argument isn't the plain UV
+    struct SkippedCall {
+        QString functionName;
+        QString call;
+    };
+
+    // Replaces the calls of the functions with texture fetches and adds the
+    // samplers of the replaced functions. Only calls with texCoord, or with a
+    // local vec2 assigned once from it, as the argument are replaced, as the
+    // textures cover UV range 0.0 - 1.0. Other calls are kept and added into
+    // skippedCalls.
+    static QString applyToShader(const QString &shader, const QList<Function> &functions,
+                                 QList<SkippedCall> *skippedCalls = nullptr);
+};
+
+#endif // FUNCTIONBAKER_H
@@ -0,0 +1,202 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "glslsymbolindex.h"
+#include "glsltokenizer.h"
+#include <QRegularExpression>
+#include <algorithm>
+#include <QtConcurrent/QtConcurrentRun>
+
+GlslSymbolIndex::GlslSymbolIndex(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_indexWatcher, &QFutureWatcher<NodeIndex>::finished,
+            this, &GlslSymbolIndex::handleNodeIndexed);
+}
+
+void GlslSymbolIndex::updateNode(int nodeId, const QString &vertexCode, const QString &fragmentCode)
+{
+    const size_t codeHash = qHashMulti(0, vertexCode, fragmentCode);
+    auto it = m_codeHashes.constFind(nodeId);
+    if (it != m_codeHashes.constEnd() && it.value() == codeHash)
+        return;
+    m_codeHashes[nodeId] = codeHash;
+    m_pendingNodes[nodeId] = PendingNode { vertexCode, fragmentCode };
+    if (!m_indexing)
+        startNextNode();
+}
+
+void GlslSymbolIndex::removeNode(int nodeId)
+{
+    m_codeHashes.remove(nodeId);
+    m_pendingNodes.remove(nodeId);
+    if (m_nodes.remove(nodeId))
+        Q_EMIT nodeRemoved(nodeId);
+}
+
+void GlslSymbolIndex::removeOtherNodes(const QList<int> &nodeIds)
+{
+    const QList<int> indexedIds = m_codeHashes.keys();
+    for (int nodeId : indexedIds) {
+        if (nodeId != BuiltInNodeId && !nodeIds.contains(nodeId))
+            removeNode(nodeId);
+    }
+}
+
+QList<GlslSymbolIndex::Symbol> GlslSymbolIndex::nodeSymbols(int nodeId) const
+{
+    return m_nodes.value(nodeId).symbols;
+}
+
+QList<GlslSymbolIndex::Symbol> GlslSymbolIndex::findDefinitions(const QString &name) const
+{
+    QList<Symbol> definitions;
+    for (const auto &node : m_nodes) {
+        for (const auto &symbol : node.symbols) {
+            if (symbol.name == name)
+                definitions << symbol;
+        }
+    }
+    return definitions;
+}
+
+QList<GlslSymbolIndex::Location> GlslSymbolIndex::findUsages(const QString &name) const
+{
+    QList<Location> usages;
+    for (const auto &node : m_nodes)
+        usages << node.usages.value(name);
+    std::sort(usages.begin(), usages.end(), [](const Location &a, const Location &b) {
+        if (a.nodeId != b.nodeId)
+            return a.nodeId < b.nodeId;
+        if (a.stage != b.stage)
+            return a.stage < b.stage;
+        return a.line < b.line;
+    });
+    return usages;
+}
+
+// Adds the declarations of a single shader stage
+static void indexDeclarations(const QString &code, GlslSymbolIndex::Location location,
+                              QList<GlslSymbolIndex::Symbol> &symbols)
+{
+    static const QRegularExpression functionExp("^\\s*(\\w+)\\s+(\\w+)\\s*\\([^;]*$");
+    static const QRegularExpression structExp("^\\s*struct\\s+(\\w+)");
+    static const QRegularExpression defineExp("^\\s*#\\s*define\\s+(\\w+)");
+    static const QRegularExpression varyingExp("^\\s*(?:layout\\s*\\([^)]*\\)\\s*)?(?:flat\\s+|smooth\\s+|noperspective\\s+)?"
+                                               "(?:in|out)\\s+\\w+\\s+(\\w+)\\s*;");
+    static const QRegularExpression uniformExp("^\\s*(?:layout\\s*\\([^)]*\\)\\s*)?uniform\\s+\\w+\\s+(\\w+)\\s*;");
+    static const QRegularExpression uniformBlockExp("^\\s*(?:layout\\s*\\([^)]*\\)\\s*)?uniform\\s+\\w+\\s*\\{");
+    static const QRegularExpression blockMemberExp("^\\s*\\w+\\s+(\\w+)\\s*(\\[[^\\]]*\\])?\\s*;");
+    static const QRegularExpression keywordExp("^(if|for|while|switch|return|else|case)$");
+
+    auto addSymbol = [&](const QString &name, GlslSymbolIndex::Kind kind) {
+        GlslSymbolIndex::Symbol symbol;
+        symbol.name = name;
+        symbol.kind = kind;
+        symbol.location = location;
+        symbols << symbol;
+    };
+
+    bool multilineComment = false;
+    bool uniformBlock = false;
+    const QStringList lines = code.split('\n');
+    for (int i = 0; i < lines.size(); ++i) {
+        location.line = i;
+        QString line = lines.at(i);
+        // Strip the comments
+        if (multilineComment) {
+            const int commentEnd = line.indexOf(QLatin1String("*/"));
+            if (commentEnd < 0)
+                continue;
+            line = line.mid(commentEnd + 2);
+            multilineComment = false;
+        }
+        const int commentStart = line.indexOf(QLatin1String("/*"));
+        if (commentStart >= 0 && line.indexOf(QLatin1String("*/"), commentStart) < 0) {
+            line.truncate(commentStart);
+            multilineComment = true;
+        }
+        const int lineComment = line.indexOf(QLatin1String("//"));
+        if (lineComment >= 0)
+            line.truncate(lineComment);
+
+        if (uniformBlock) {
+            if (line.contains('}')) {
+                uniformBlock = false;
+                continue;
+            }
+            const auto match = blockMemberExp.match(line);
+            if (match.hasMatch())
+                addSymbol(match.captured(1), GlslSymbolIndex::Kind::Uniform);
+            continue;
+        }
+
+        QRegularExpressionMatch match;
+        if ((match = defineExp.match(line)).hasMatch()) {
+            addSymbol(match.captured(1), GlslSymbolIndex::Kind::Define);
+        } else if ((match = structExp.match(line)).hasMatch()) {
+            addSymbol(match.captured(1), GlslSymbolIndex::Kind::Struct);
+        } else if ((match = uniformExp.match(line)).hasMatch()) {
+            addSymbol(match.captured(1), GlslSymbolIndex::Kind::Uniform);
+        } else if (uniformBlockExp.match(line).hasMatch()) {
+            uniformBlock = !line.contains('}');
+        } else if ((match = varyingExp.match(line)).hasMatch()) {
+            addSymbol(match.captured(1), GlslSymbolIndex::Kind::Varying);
+        } else if ((match = functionExp.match(line)).hasMatch()) {
+            if (!keywordExp.match(match.captured(1)).hasMatch() && !keywordExp.match(match.captured(2)).hasMatch()
+                    && match.captured(2) != QLatin1String("main")) {
+                addSymbol(match.captured(2), GlslSymbolIndex::Kind::Function);
+            }
+        }
+    }
+}
+
+GlslSymbolIndex::NodeIndex GlslSymbolIndex::indexCode(int nodeId, const QString &vertexCode,
+                                                      const QString &fragmentCode)
+{
+    NodeIndex index;
+    const QList<QPair<int, const QString *>> stages = { { Vertex, &vertexCode }, { Fragment, &fragmentCode } };
+    for (const auto &stage : stages) {
+        Location location;
+        location.nodeId = nodeId;
+        location.stage = stage.first;
+        indexDeclarations(*stage.second, location, index.symbols);
+        GlslTokenizer::forEachIdentifier(*stage.second, [&](const GlslTokenizer::Identifier &identifier) {
+            if (identifier.isTag)
+                return;
+            location.line = identifier.line;
+            auto &lines = index.usages[identifier.name.toString()];
+            // Only one location per line
+            if (lines.isEmpty() || lines.last().stage != location.stage || lines.last().line != location.line)
+                lines << location;
+        });
+    }
+    return index;
+}
+
+void GlslSymbolIndex::startNextNode()
+{
+    if (m_pendingNodes.isEmpty())
+        return;
+    auto it = m_pendingNodes.begin();
+    const int nodeId = it.key();
+    const PendingNode pending = it.value();
+    m_pendingNodes.erase(it);
+    m_indexingNodeId = nodeId;
+    m_indexing = true;
+    m_indexWatcher.setFuture(QtConcurrent::run(&GlslSymbolIndex::indexCode, nodeId,
+                                               pending.vertexCode, pending.fragmentCode));
+}
+
+void GlslSymbolIndex::handleNodeIndexed()
+{
+    const int nodeId = m_indexingNodeId;
+    m_indexing = false;
+    // Node may have been removed while indexing, or the newer
+    // code is pending. Then the results are not used.
+    if (m_codeHashes.contains(nodeId) && !m_pendingNodes.contains(nodeId)) {
+        m_nodes[nodeId] = m_indexWatcher.result();
+        Q_EMIT nodeIndexed(nodeId);
+    }
+    startNextNode();
+}
@@ -0,0 +1,96 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef GLSLSYMBOLINDEX_H
+#define GLSLSYMBOLINDEX_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+
+// Index of the symbols declared in the code of the nodes, and the lines
+// where identifiers are used. Nodes are indexed on a worker thread, and
+// only when their code has changed since the previous update.
+class GlslSymbolIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Node id of the generated uniforms and varyings
+    static const int BuiltInNodeId = -1;
+
+    enum class Kind {
+        Function,
+        Struct,
+        Define,
+        Varying,
+        Uniform
+    };
+    // Same as the indexes of the code editor tabs
+    enum Stage {
+        Vertex = 1,
+        Fragment = 2
+    };
+
+    struct Location {
+        int nodeId = BuiltInNodeId;
+        int stage = Fragment;
+        // 0-based line number
+        int line = 0;
+    };
+
+    struct Symbol {
+        QString name;
+        Kind kind = Kind::Function;
+        Location location;
+    };
+
+    struct NodeIndex {
+        QList<Symbol> symbols;
+        // Lines of the identifiers, including the declarations
+        QHash<QString, QList<Location>> usages;
+    };
+
+    explicit GlslSymbolIndex(QObject *parent = nullptr);
+
+    // Queues the node for indexing, when the code has changed
+    void updateNode(int nodeId, const QString &vertexCode, const QString &fragmentCode);
+    void removeNode(int nodeId);
+    // Removes the nodes not in the list, except the built-ins
+    void removeOtherNodes(const QList<int> &nodeIds);
+
+    QList<Symbol> nodeSymbols(int nodeId) const;
+    QList<Symbol> findDefinitions(const QString &name) const;
+    QList<Location> findUsages(const QString &name) const;
+
+    // Parses the code of the node, can be called from any thread
+    static NodeIndex indexCode(int nodeId, const QString &vertexCode, const QString &fragmentCode);
+
+signals:
+    void nodeIndexed(int nodeId);
+    void nodeRemoved(int nodeId);
+
+private:
+    struct PendingNode {
+        QString vertexCode;
+        QString fragmentCode;
+    };
+
+    void startNextNode();
+    void handleNodeIndexed();
+
+    // Hash of the latest code of each node, indexed or pending
+    QHash<int, size_t> m_codeHashes;
+    QHash<int, NodeIndex> m_nodes;
+    QMap<int, PendingNode> m_pendingNodes;
+    int m_indexingNodeId = BuiltInNodeId;
+    // Set while a node is indexed, until handleNodeIndexed() has taken the
+    // results. The watcher isRunning() is false already before that.
+    bool m_indexing = false;
+    QFutureWatcher<NodeIndex> m_indexWatcher;
+};
+
+#endif // GLSLSYMBOLINDEX_H
@@ -0,0 +1,254 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "glsltokenizer.h"
+#include <QList>
+#include <QRegularExpression>
+
+#ifdef QQEM_SYNTAX_HIGHLIGHTING_ENABLED
+#include <QtQuick3DGlslParser/private/glsllexer_p.h>
+#include <QtQuick3DGlslParser/private/glslparser_p.h>
+#endif
+
+static void reportIdentifier(QStringView line, qsizetype position, qsizetype length, int lineNumber,
+                             const GlslTokenizer::Callback &callback)
+{
+    GlslTokenizer::Identifier identifier;
+    identifier.name = line.sliced(position, length);
+    identifier.lineRest = line.sliced(position + length);
+    identifier.line = lineNumber;
+    identifier.isTag = position > 0 && line.at(position - 1) == QLatin1Char('@');
+    callback(identifier);
+}
+
+#ifdef QQEM_SYNTAX_HIGHLIGHTING_ENABLED
+
+static void scanLine(QStringView line, int lineNumber, int *state, const GlslTokenizer::Callback &callback)
+{
+    const QByteArray data = line.toLatin1();
+    GLSL::Lexer lex(/*engine=*/ nullptr, data.constData(), data.size());
+    lex.setState(*state);
+    lex.setScanKeywords(false);
+    lex.setScanComments(false);
+    lex.setVariant(GLSL::Lexer::Variant_GLSL_400);
+    GLSL::Token tk;
+    do {
+        lex.yylex(&tk);
+        if (tk.is(GLSL::Parser::T_IDENTIFIER))
+            reportIdentifier(line, tk.position, tk.length, lineNumber, callback);
+    } while (tk.isNot(GLSL::Parser::EOF_SYMBOL));
+    *state = lex.state() & 0xff;
+}
+
+#else
+
+// Lexer state when inside multi-line comment
+const int STATE_COMMENT = 1;
+
+// Minimal version without glslparser dependency, which only
+// needs to separate identifiers from comments and numbers.
+static void scanLine(QStringView line, int lineNumber, int *state, const GlslTokenizer::Callback &callback)
+{
+    const qsizetype n = line.size();
+    qsizetype i = 0;
+    while (i < n) {
+        if (*state == STATE_COMMENT) {
+            const qsizetype end = line.indexOf(u"*/", i);
+            if (end < 0)
+                return;
+            *state = 0;
+            i = end + 2;
+            continue;
+        }
+        const QChar c = line.at(i);
+        if (c == QLatin1Char('/') && i + 1 < n && line.at(i + 1) == QLatin1Char('/'))
+            return;
+        if (c == QLatin1Char('/') && i + 1 < n && line.at(i + 1) == QLatin1Char('*')) {
+            *state = STATE_COMMENT;
+            i += 2;
+        } else if (c.isLetter() || c == QLatin1Char('_')) {
+            const qsizetype start = i;
+            while (i < n && (line.at(i).isLetterOrNumber() || line.at(i) == QLatin1Char('_')))
+                i++;
+            reportIdentifier(line, start, i - start, lineNumber, callback);
+        } else if (c.isDigit()) {
+            // Skip numbers, including suffixes and exponents like "1.0e5f"
+            while (i < n && (line.at(i).isLetterOrNumber() || line.at(i) == QLatin1Char('.')))
+                i++;
+        } else {
+            i++;
+        }
+    }
+}
+
+#endif
+
+// Macros which the shader compiler defines, these can't be evaluated here
+static bool isPredefined(const QString &name)
+{
+    return name.startsWith(QLatin1String("GL_")) || name.startsWith(QLatin1String("QSHADER_"))
+            || name.startsWith(QLatin1String("__")) || name == QLatin1String("VULKAN");
+}
+
+// Evaluates simple preprocessor conditions like "0", "NAME", "defined(NAME)"
+// and "NAME > 2". More complex ones are unknown, and treated as enabled.
+GlslTokenizer::Condition GlslTokenizer::evaluate(QStringView expression, const QHash<QString, QString> &defines)
+{
+    QString e = expression.toString().simplified();
+    bool negate = false;
+    while (e.startsWith(QLatin1Char('!'))) {
+        negate = !negate;
+        e = e.sliced(1).trimmed();
+    }
+    if (e.startsWith(QLatin1Char('(')) && e.endsWith(QLatin1Char(')')) && e.count(QLatin1Char('(')) == 1)
+        e = e.sliced(1, e.size() - 2).trimmed();
+
+    auto value = [&defines](const QString &token, bool *known) {
+        bool ok = false;
+        int v = token.toInt(&ok, 0);
+        if (ok) {
+            *known = true;
+            return v;
+        }
+        if (defines.contains(token)) {
+            v = defines.value(token).toInt(&ok, 0);
+            *known = ok;
+            return v;
+        }
+        // Undefined macros are 0
+        *known = !isPredefined(token);
+        return 0;
+    };
+
+    Condition result = Condition::Unknown;
+    static const QRegularExpression definedExp("^defined\\s*\\(?\\s*(\\w+)\\s*\\)?$");
+    static const QRegularExpression compareExp("^(\\w+)\\s*(==|!=|>=|<=|>|<)\\s*(\\w+)$");
+    static const QRegularExpression valueExp("^\\w+$");
+    if (const auto match = definedExp.match(e); match.hasMatch()) {
+        const QString name = match.captured(1);
+        if (defines.contains(name))
+            result = Condition::True;
+        else if (!isPredefined(name))
+            result = Condition::False;
+    } else if (const auto match = compareExp.match(e); match.hasMatch()) {
+        bool knownA = false;
+        bool knownB = false;
+        const int a = value(match.captured(1), &knownA);
+        const int b = value(match.captured(3), &knownB);
+        const QString op = match.captured(2);
+        if (knownA && knownB) {
+            bool r = false;
+            if (op == "==")
+                r = a == b;
+            else if (op == "!=")
+                r = a != b;
+            else if (op == ">=")
+                r = a >= b;
+            else if (op == "<=")
+                r = a <= b;
+            else if (op == ">")
+                r = a > b;
+            else
+                r = a < b;
+            result = r ? Condition::True : Condition::False;
+        }
+    } else if (valueExp.match(e).hasMatch()) {
+        bool known = false;
+        const int v = value(e, &known);
+        if (known)
+            result = v != 0 ? Condition::True : Condition::False;
+    }
+
+    if (negate && result != Condition::Unknown)
+        result = result == Condition::True ? Condition::False : Condition::True;
+    return result;
+}
+
+void GlslTokenizer::forEachIdentifier(const QString &code, const Callback &callback)
+{
+    // Preprocessor conditional blocks
+    struct Branch {
+        bool parentActive = true;
+        bool active = true;
+        // True when some branch of the block has been taken
+        bool taken = false;
+        // True when some condition of the block couldn't be evaluated
+        bool unknown = false;
+    };
+    QList<Branch> branches;
+    QHash<QString, QString> defines;
+    auto isActive = [&branches]() {
+        return branches.isEmpty() || branches.constLast().active;
+    };
+    auto setCondition = [](Branch &branch, Condition condition) {
+        branch.unknown = branch.unknown || condition == Condition::Unknown;
+        branch.active = branch.parentActive && condition != Condition::False;
+        branch.taken = branch.taken || condition == Condition::True;
+    };
+
+    int state = 0;
+    int lineNumber = 0;
+    const QStringView codeView(code);
+    qsizetype lineStart = 0;
+    while (lineStart <= codeView.size()) {
+        qsizetype lineEnd = codeView.indexOf(QLatin1Char('\n'), lineStart);
+        if (lineEnd < 0)
+            lineEnd = codeView.size();
+        const QStringView line = codeView.sliced(lineStart, lineEnd - lineStart);
+        const QStringView trimmed = line.trimmed();
+        lineStart = lineEnd + 1;
+        const int currentLine = lineNumber++;
+
+        // Non-zero state means that line starts inside multi-line comment
+        if (state != 0 || !trimmed.startsWith(QLatin1Char('#'))) {
+            if (isActive())
+                scanLine(line, currentLine, &state, callback);
+            continue;
+        }
+
+        // Preprocessor directive
+        const QStringView directive = trimmed.sliced(1).trimmed();
+        qsizetype keywordEnd = 0;
+        while (keywordEnd < directive.size() && directive.at(keywordEnd).isLetter())
+            keywordEnd++;
+        const QStringView keyword = directive.first(keywordEnd);
+        QStringView args = directive.sliced(keywordEnd).trimmed();
+        const qsizetype commentIndex = args.indexOf(u"//");
+        if (commentIndex >= 0)
+            args = args.first(commentIndex).trimmed();
+
+        if (keyword == u"if" || keyword == u"ifdef" || keyword == u"ifndef") {
+            QString expression = args.toString();
+            if (keyword == u"ifdef")
+                expression = "defined(" + expression + ')';
+            else if (keyword == u"ifndef")
+                expression = "!defined(" + expression + ')';
+            const Condition condition = evaluate(expression, defines);
+            Branch branch;
+            branch.parentActive = isActive();
+            setCondition(branch, condition);
+            branches << branch;
+        } else if (keyword == u"elif" && !branches.isEmpty()) {
+            Branch &branch = branches.last();
+            if (branch.unknown)
+                branch.active = branch.parentActive;
+            else if (branch.taken)
+                branch.active = false;
+            else
+                setCondition(branch, evaluate(args, defines));
+        } else if (keyword == u"else" && !branches.isEmpty()) {
+            Branch &branch = branches.last();
+            branch.active = branch.parentActive && (branch.unknown || !branch.taken);
+            branch.taken = true;
+        } else if (keyword == u"endif" && !branches.isEmpty()) {
+            branches.removeLast();
+        } else if (keyword == u"define" && isActive()) {
+            qsizetype nameEnd = 0;
+            while (nameEnd < args.size() && (args.at(nameEnd).isLetterOrNumber() || args.at(nameEnd) == QLatin1Char('_')))
+                nameEnd++;
+            defines.insert(args.first(nameEnd).toString(), args.sliced(nameEnd).trimmed().toString());
+        } else if (keyword == u"undef" && isActive()) {
+            defines.remove(args.toString());
+        }
+    }
+}
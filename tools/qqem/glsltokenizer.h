@@ -0,0 +1,40 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef GLSLTOKENIZER_H
+#define GLSLTOKENIZER_H
+
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <functional>
+
+// Goes through GLSL code in a single pass and reports the identifiers.
+// Comments and blocks disabled by the preprocessor (#if, #ifdef etc.) are
+// skipped. Uses the GLSL lexer when syntax highlighting is available.
+class GlslTokenizer
+{
+public:
+    struct Identifier {
+        QStringView name;
+        // Rest of the line after the identifier, e.g. tag arguments
+        QStringView lineRest;
+        // 0-based line number
+        int line = 0;
+        // True for tags, e.g. "@mesh"
+        bool isTag = false;
+    };
+    using Callback = std::function<void(const Identifier &identifier)>;
+
+    static void forEachIdentifier(const QString &code, const Callback &callback);
+
+private:
+    enum class Condition {
+        False,
+        True,
+        Unknown
+    };
+    static Condition evaluate(QStringView expression, const QHash<QString, QString> &defines);
+};
+
+#endif // GLSLTOKENIZER_H
@@ -0,0 +1,104 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "gpumemoryestimator.h"
+#include <algorithm>
+
+void GpuMemoryEstimator::addTexture(const QString &name, const QSize &size, Format format, bool mipmaps)
+{
+    if (size.isEmpty())
+        return;
+    Entry entry;
+    entry.name = name;
+    entry.size = size;
+    entry.format = format;
+    entry.mipmaps = mipmaps;
+    entry.bytes = textureBytes(size, format, mipmaps);
+    m_entries << entry;
+}
+
+void GpuMemoryEstimator::addPixels(const QString &name, qint64 pixels)
+{
+    if (pixels <= 0)
+        return;
+    Entry entry;
+    entry.name = name;
+    entry.bytes = pixels * 4;
+    m_entries << entry;
+}
+
+qint64 GpuMemoryEstimator::totalBytes() const
+{
+    qint64 total = 0;
+    for (const auto &entry : m_entries)
+        total += entry.bytes;
+    return total;
+}
+
+QString GpuMemoryEstimator::report(qint64 budgetBytes) const
+{
+    QString s;
+    for (const auto &entry : m_entries) {
+        QString details;
+        if (!entry.size.isEmpty()) {
+            details = QString(" (%1x%2 %3%4)").arg(entry.size.width()).arg(entry.size.height())
+                    .arg(formatName(entry.format), entry.mipmaps ? QStringLiteral(", mipmaps") : QString());
+        }
+        s += QString("%1: %2%3\n").arg(entry.name, formatBytes(entry.bytes), details);
+    }
+    const qint64 total = totalBytes();
+    s += QString("Total: %1").arg(formatBytes(total));
+    if (budgetBytes > 0) {
+        s += QString(" / %1").arg(formatBytes(budgetBytes));
+        if (total > budgetBytes)
+            s += QStringLiteral("\nWarning: Effect exceeds the GPU memory budget");
+    }
+    s += '\n';
+    return s;
+}
+
+qint64 GpuMemoryEstimator::textureBytes(const QSize &size, Format format, bool mipmaps)
+{
+    const bool compressed = format != Format::RGBA8;
+    const int blockBytes = (format == Format::ETC2 || format == Format::BC1) ? 8 : 16;
+    qint64 bytes = 0;
+    int w = size.width();
+    int h = size.height();
+    while (w > 0 && h > 0) {
+        if (compressed)
+            bytes += qint64((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+        else
+            bytes += qint64(w) * h * 4;
+        if (!mipmaps || (w == 1 && h == 1))
+            break;
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    return bytes;
+}
+
+QString GpuMemoryEstimator::formatBytes(qint64 bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return QString("%1 MB").arg(double(bytes) / (1024 * 1024), 0, 'f', 1);
+    if (bytes >= 1024)
+        return QString("%1 kB").arg(double(bytes) / 1024, 0, 'f', 1);
+    return QString("%1 B").arg(bytes);
+}
+
+QString GpuMemoryEstimator::formatName(Format format)
+{
+    switch (format) {
+    case Format::RGBA8:
+        return QStringLiteral("RGBA8");
+    case Format::ETC2:
+        return QStringLiteral("ETC2");
+    case Format::BC1:
+        return QStringLiteral("BC1");
+    case Format::ETC2Alpha:
+        return QStringLiteral("ETC2 EAC");
+    case Format::BC3:
+        return QStringLiteral("BC3");
+    }
+    return QString();
+}
@@ -0,0 +1,53 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef GPUMEMORYESTIMATOR_H
+#define GPUMEMORYESTIMATOR_H
+
+#include <QList>
+#include <QSize>
+#include <QString>
+
+// Estimates the GPU memory used by the textures and offscreen layers of
+// the effect, based on their sizes, formats and mipmaps. Drivers may pad
+// and align the textures, so the real usage can be somewhat higher.
+class GpuMemoryEstimator
+{
+public:
+    enum class Format {
+        RGBA8,
+        // 4 bits per pixel
+        ETC2,
+        BC1,
+        // 8 bits per pixel
+        ETC2Alpha,
+        BC3
+    };
+
+    struct Entry {
+        QString name;
+        // Empty size for the entries added as pixel counts
+        QSize size;
+        Format format = Format::RGBA8;
+        bool mipmaps = false;
+        qint64 bytes = 0;
+    };
+
+    void addTexture(const QString &name, const QSize &size, Format format, bool mipmaps);
+    // Adds layers which are known only by their total RGBA8 pixel count
+    void addPixels(const QString &name, qint64 pixels);
+    QList<Entry> entries() const { return m_entries; }
+    qint64 totalBytes() const;
+    // Returns plain-text report of the entries, with a warning
+    // when the total exceeds the budget. Budget 0 means no budget.
+    QString report(qint64 budgetBytes) const;
+
+    static qint64 textureBytes(const QSize &size, Format format, bool mipmaps);
+    static QString formatBytes(qint64 bytes);
+    static QString formatName(Format format);
+
+private:
+    QList<Entry> m_entries;
+};
+
+#endif // GPUMEMORYESTIMATOR_H
@@ -0,0 +1,111 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "imageatlas.h"
+#include <QPainter>
+#include <algorithm>
+
+// Empty space between the images, to keep the filtering from bleeding
+const int ATLAS_IMAGE_SPACING = 2;
+
+void ImageAtlas::addImage(const QString &name, const QImage &image)
+{
+    Entry entry;
+    entry.name = name;
+    entry.image = image;
+    m_entries << entry;
+}
+
+bool ImageAtlas::pack()
+{
+    if (m_entries.isEmpty())
+        return false;
+
+    // Taller images first, so shelves get filled tightly
+    std::stable_sort(m_entries.begin(), m_entries.end(), [](const Entry &a, const Entry &b) {
+        return a.image.height() > b.image.height();
+    });
+
+    for (int width = MaxImageSize; width <= MaxAtlasSize; width *= 2) {
+        if (packInto(QSize(width, width / 2)) || packInto(QSize(width, width)))
+            return true;
+    }
+    m_size = QSize();
+    return false;
+}
+
+// Simple shelf packing, images are placed left to right on rows
+bool ImageAtlas::packInto(const QSize &size)
+{
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    for (auto &entry : m_entries) {
+        const QSize imageSize = entry.image.size();
+        if (x + imageSize.width() > size.width()) {
+            // Start a new shelf
+            x = 0;
+            y += shelfHeight + ATLAS_IMAGE_SPACING;
+            shelfHeight = 0;
+        }
+        if (imageSize.width() > size.width() || y + imageSize.height() > size.height())
+            return false;
+        entry.rect = QRect(QPoint(x, y), imageSize);
+        x += imageSize.width() + ATLAS_IMAGE_SPACING;
+        shelfHeight = qMax(shelfHeight, imageSize.height());
+    }
+    m_size = size;
+    return true;
+}
+
+QImage ImageAtlas::atlasImage() const
+{
+    if (m_size.isEmpty())
+        return QImage();
+
+    QImage atlas(m_size, QImage::Format_RGBA8888);
+    atlas.fill(Qt::transparent);
+    QPainter painter(&atlas);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for (const auto &entry : m_entries)
+        painter.drawImage(entry.rect.topLeft(), entry.image);
+    painter.end();
+    return atlas;
+}
+
+QString ImageAtlas::helperFunctionName(const QString &name)
+{
+    return QStringLiteral("atlasTexture_") + name;
+}
+
+// Generates helper function for each packed image. These map the image
+// coordinates into the atlas and clamp them inside the image, which
+// matches the default ClampToEdge wrapping of the images.
+QString ImageAtlas::shaderHelpers(const QString &samplerName) const
+{
+    if (m_size.isEmpty())
+        return QString();
+
+    auto toString = [](double value) {
+        return QString::number(value, 'f', 8);
+    };
+    const double atlasWidth = m_size.width();
+    const double atlasHeight = m_size.height();
+    QString s;
+    for (const auto &entry : m_entries) {
+        const QString functionName = helperFunctionName(entry.name);
+        s += QString("vec4 %1(vec2 uv, float bias) {\n").arg(functionName);
+        s += QString("    const vec4 rect = vec4(%1, %2, %3, %4);\n")
+                .arg(toString(entry.rect.x() / atlasWidth), toString(entry.rect.y() / atlasHeight),
+                     toString(entry.rect.width() / atlasWidth), toString(entry.rect.height() / atlasHeight));
+        s += QString("    const vec2 halfTexel = vec2(%1, %2);\n")
+                .arg(toString(0.5 / atlasWidth), toString(0.5 / atlasHeight));
+        s += "    vec2 atlasUv = clamp(rect.xy + uv * rect.zw, rect.xy + halfTexel, rect.xy + rect.zw - halfTexel);\n";
+        s += QString("    return texture(%1, atlasUv, bias);\n").arg(samplerName);
+        s += "}\n";
+        s += QString("vec4 %1(vec2 uv) {\n").arg(functionName);
+        s += QString("    return %1(uv, 0.0);\n").arg(functionName);
+        s += "}\n";
+    }
+    return s;
+}
@@ -0,0 +1,57 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef IMAGEATLAS_H
+#define IMAGEATLAS_H
+
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QString>
+
+// Packs small sampler images into a single atlas image and generates
+// the GLSL helpers for sampling them from the atlas.
+class ImageAtlas
+{
+public:
+    // Images larger than this (in either dimension) are not packed
+    static const int MaxImageSize = 256;
+    // Maximum atlas size
+    static const int MaxAtlasSize = 2048;
+
+    struct Entry {
+        // Sampler uniform name
+        QString name;
+        QImage image;
+        // Position of the image inside the atlas
+        QRect rect;
+    };
+
+    void addImage(const QString &name, const QImage &image);
+    // Packs the added images. Returns false if they don't fit into MaxAtlasSize.
+    bool pack();
+
+    bool isEmpty() const {
+        return m_entries.isEmpty();
+    }
+    const QList<Entry> &entries() const {
+        return m_entries;
+    }
+    QSize size() const {
+        return m_size;
+    }
+    QImage atlasImage() const;
+
+    // Name of the helper function used instead of texture(name, ...)
+    static QString helperFunctionName(const QString &name);
+    // GLSL helper functions for sampling the packed images from samplerName
+    QString shaderHelpers(const QString &samplerName) const;
+
+private:
+    bool packInto(const QSize &size);
+
+    QList<Entry> m_entries;
+    QSize m_size;
+};
+
+#endif // IMAGEATLAS_H
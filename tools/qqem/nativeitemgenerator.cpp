@@ -0,0 +1,814 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "nativeitemgenerator.h"
+#include <QColor>
+#include <QPointF>
+#include <QRegularExpression>
+#include <QVector3D>
+#include <QVector4D>
+#include <algorithm>
+
+// qt_Matrix & qt_Opacity are always first in the uniform buffer
+const int UNIFORM_DATA_OFFSET = 68;
+
+static QString cppType(NativeItemGenerator::PropertyType type)
+{
+    switch (type) {
+    case NativeItemGenerator::PropertyType::Bool:
+        return QStringLiteral("bool");
+    case NativeItemGenerator::PropertyType::Int:
+        return QStringLiteral("int");
+    case NativeItemGenerator::PropertyType::Real:
+        return QStringLiteral("qreal");
+    case NativeItemGenerator::PropertyType::Point:
+        return QStringLiteral("QPointF");
+    case NativeItemGenerator::PropertyType::Vector3D:
+        return QStringLiteral("QVector3D");
+    case NativeItemGenerator::PropertyType::Vector4D:
+        return QStringLiteral("QVector4D");
+    case NativeItemGenerator::PropertyType::Color:
+        return QStringLiteral("QColor");
+    case NativeItemGenerator::PropertyType::Image:
+        return QStringLiteral("QUrl");
+    }
+    return QString();
+}
+
+// Type used as the setter argument
+static QString argumentType(NativeItemGenerator::PropertyType type)
+{
+    switch (type) {
+    case NativeItemGenerator::PropertyType::Bool:
+    case NativeItemGenerator::PropertyType::Int:
+    case NativeItemGenerator::PropertyType::Real:
+        return cppType(type) + ' ';
+    default:
+        return QString("const %1 &").arg(cppType(type));
+    }
+}
+
+static QString setterName(const QString &name)
+{
+    return QStringLiteral("set") + name.at(0).toUpper() + name.mid(1);
+}
+
+static QString memberName(const QString &name)
+{
+    return QStringLiteral("m_") + name;
+}
+
+// Returns the default value as C++ initializer, or empty when there is none
+static QString defaultValueString(const NativeItemGenerator::Property &property, const QString &resourcePath)
+{
+    const QVariant &v = property.defaultValue;
+    switch (property.type) {
+    case NativeItemGenerator::PropertyType::Bool:
+        return v.toBool() ? QStringLiteral("true") : QStringLiteral("false");
+    case NativeItemGenerator::PropertyType::Int:
+        return QString::number(v.toInt());
+    case NativeItemGenerator::PropertyType::Real:
+        return QString::number(v.toDouble(), 'g', 8);
+    case NativeItemGenerator::PropertyType::Point: {
+        const QPointF p = v.toPointF();
+        return QString("QPointF(%1, %2)").arg(p.x()).arg(p.y());
+    }
+    case NativeItemGenerator::PropertyType::Vector3D: {
+        const QVector3D v3 = v.value<QVector3D>();
+        return QString("QVector3D(%1, %2, %3)").arg(v3.x()).arg(v3.y()).arg(v3.z());
+    }
+    case NativeItemGenerator::PropertyType::Vector4D: {
+        const QVector4D v4 = v.value<QVector4D>();
+        return QString("QVector4D(%1, %2, %3, %4)").arg(v4.x()).arg(v4.y()).arg(v4.z()).arg(v4.w());
+    }
+    case NativeItemGenerator::PropertyType::Color: {
+        const QColor c = v.value<QColor>();
+        return QString("QColor::fromRgbF(%1, %2, %3, %4)")
+                .arg(c.redF()).arg(c.greenF()).arg(c.blueF()).arg(c.alphaF());
+    }
+    case NativeItemGenerator::PropertyType::Image: {
+        const QString filename = v.toString();
+        if (filename.isEmpty())
+            return QString();
+        return QString("QUrl(QStringLiteral(\"qrc%1%2\"))").arg(resourcePath, filename);
+    }
+    }
+    return QString();
+}
+
+// Returns the expression which converts the property into the uniform value
+static QString uniformValueString(const NativeItemGenerator::Property &property)
+{
+    const QString member = memberName(property.name);
+    switch (property.type) {
+    case NativeItemGenerator::PropertyType::Bool:
+        // bool takes 4 bytes in std140
+        return QString("int(%1)").arg(member);
+    case NativeItemGenerator::PropertyType::Int:
+        return member;
+    case NativeItemGenerator::PropertyType::Real:
+        return QString("float(%1)").arg(member);
+    case NativeItemGenerator::PropertyType::Point:
+        return QString("QVector2D(%1)").arg(member);
+    case NativeItemGenerator::PropertyType::Vector3D:
+    case NativeItemGenerator::PropertyType::Vector4D:
+        return member;
+    case NativeItemGenerator::PropertyType::Color:
+        return QString("premultiplied(%1)").arg(member);
+    case NativeItemGenerator::PropertyType::Image:
+        break;
+    }
+    return QString();
+}
+
+// Parses the members of the "buf" uniform block and calculates their std140 offsets
+QList<NativeItemGenerator::UniformMember> NativeItemGenerator::uniformLayout(const QString &shader, int *size)
+{
+    QList<UniformMember> members;
+    int offset = 0;
+    bool inBlock = false;
+    static const QRegularExpression memberExp("^(\\w+)\\s+(\\w+);$");
+    const QStringList lines = shader.split('\n');
+    for (const auto &l : lines) {
+        const QString line = l.trimmed();
+        if (!inBlock) {
+            inBlock = line.startsWith("layout(std140") && line.contains("uniform buf");
+            continue;
+        }
+        if (line.startsWith("};"))
+            break;
+        const auto match = memberExp.match(line);
+        if (!match.hasMatch())
+            continue;
+        const QString type = match.captured(1);
+        int memberSize = 4;
+        int alignment = 4;
+        if (type == "vec2") {
+            memberSize = 8;
+            alignment = 8;
+        } else if (type == "vec3") {
+            memberSize = 12;
+            alignment = 16;
+        } else if (type == "vec4") {
+            memberSize = 16;
+            alignment = 16;
+        } else if (type == "mat4") {
+            memberSize = 64;
+            alignment = 16;
+        }
+        offset = (offset + alignment - 1) / alignment * alignment;
+        members << UniformMember { type, match.captured(2), offset };
+        offset += memberSize;
+    }
+    if (size)
+        *size = (offset + 15) / 16 * 16;
+    return members;
+}
+
+QList<NativeItemGenerator::SamplerBinding> NativeItemGenerator::samplerBindings(const QString &shader)
+{
+    QList<SamplerBinding> bindings;
+    static const QRegularExpression samplerExp("^layout\\(binding = (\\d+)\\) uniform sampler2D (\\w+);$");
+    const QStringList lines = shader.split('\n');
+    for (const auto &line : lines) {
+        const auto match = samplerExp.match(line.trimmed());
+        if (match.hasMatch())
+            bindings << SamplerBinding { match.captured(2), match.captured(1).toInt() };
+    }
+    return bindings;
+}
+
+QByteArray NativeItemGenerator::cppHeader(const Settings &settings)
+{
+    const QList<UniformMember> members = uniformLayout(settings.fragmentShader, nullptr);
+    const QList<SamplerBinding> samplers = samplerBindings(settings.fragmentShader);
+    auto hasMember = [&members](const QString &name) {
+        return std::any_of(members.cbegin(), members.cend(), [&name](const UniformMember &m) {
+            return m.name == name;
+        });
+    };
+    const bool usesSource = std::any_of(samplers.cbegin(), samplers.cend(), [](const SamplerBinding &s) {
+        return s.name == QLatin1String("iSource");
+    });
+    const bool usesTime = hasMember("iTime");
+    const bool usesFrame = hasMember("iFrame");
+    const bool usesMouse = hasMember("iMouse");
+    const QString guard = settings.className.toUpper() + "_H";
+    const QString &c = settings.className;
+
+    QString s;
+    s += "// Generated by Qt Quick Effect Maker, do not edit.\n";
+    s += '\n';
+    s += QString("#ifndef %1\n").arg(guard);
+    s += QString("#define %1\n").arg(guard);
+    s += '\n';
+    s += "#include <QtCore/qelapsedtimer.h>\n";
+    s += "#include <QtCore/qpointer.h>\n";
+    s += "#include <QtCore/qurl.h>\n";
+    s += "#include <QtGui/qcolor.h>\n";
+    s += "#include <QtGui/qimage.h>\n";
+    s += "#include <QtGui/qvector3d.h>\n";
+    s += "#include <QtGui/qvector4d.h>\n";
+    s += "#include <QtQml/qqmlregistration.h>\n";
+    s += "#include <QtQuick/qquickitem.h>\n";
+    s += '\n';
+    s += QString("class %1 : public QQuickItem\n").arg(c);
+    s += "{\n";
+    s += "    Q_OBJECT\n";
+    s += "    QML_ELEMENT\n";
+    if (usesSource) {
+        s += "    // This is the main source for the effect. Needs to be a texture provider,\n";
+        s += "    // so Image, ShaderEffectSource or an item with layer.enabled.\n";
+        s += "    Q_PROPERTY(QQuickItem *source READ source WRITE setSource NOTIFY sourceChanged)\n";
+    }
+    if (usesTime || usesFrame) {
+        s += "    // Enable this to animate iTime property\n";
+        s += "    Q_PROPERTY(bool timeRunning READ timeRunning WRITE setTimeRunning NOTIFY timeRunningChanged)\n";
+    }
+    if (usesTime) {
+        s += "    // When timeRunning is false, this can be used to control iTime manually\n";
+        s += "    Q_PROPERTY(qreal animatedTime READ animatedTime WRITE setAnimatedTime NOTIFY animatedTimeChanged)\n";
+    }
+    if (usesFrame) {
+        s += "    // When timeRunning is false, this can be used to control iFrame manually\n";
+        s += "    Q_PROPERTY(int animatedFrame READ animatedFrame WRITE setAnimatedFrame NOTIFY animatedFrameChanged)\n";
+    }
+    for (const auto &property : settings.properties) {
+        const QStringList descriptionLines = property.description.split('\n');
+        for (const auto &line : descriptionLines) {
+            if (!property.description.isEmpty())
+                s += line.trimmed().isEmpty() ? QString("    //\n") : QString("    // %1\n").arg(line);
+        }
+        s += QString("    Q_PROPERTY(%1 %2 READ %2 WRITE %3 NOTIFY %2Changed)\n")
+                .arg(cppType(property.type), property.name, setterName(property.name));
+    }
+    s += '\n';
+    s += "public:\n";
+    s += QString("    explicit %1(QQuickItem *parent = nullptr);\n").arg(c);
+    s += '\n';
+    if (usesSource) {
+        s += "    QQuickItem *source() const { return m_source; }\n";
+        s += "    void setSource(QQuickItem *source);\n";
+    }
+    if (usesTime || usesFrame) {
+        s += "    bool timeRunning() const { return m_timeRunning; }\n";
+        s += "    void setTimeRunning(bool timeRunning);\n";
+    }
+    if (usesTime) {
+        s += "    qreal animatedTime() const { return m_animatedTime; }\n";
+        s += "    void setAnimatedTime(qreal animatedTime);\n";
+    }
+    if (usesFrame) {
+        s += "    int animatedFrame() const { return m_animatedFrame; }\n";
+        s += "    void setAnimatedFrame(int animatedFrame);\n";
+    }
+    for (const auto &property : settings.properties) {
+        s += QString("    %1 %2() const { return %3; }\n")
+                .arg(cppType(property.type), property.name, memberName(property.name));
+        s += QString("    void %1(%2%3);\n")
+                .arg(setterName(property.name), argumentType(property.type), property.name);
+    }
+    s += '\n';
+    s += "Q_SIGNALS:\n";
+    if (usesSource)
+        s += "    void sourceChanged();\n";
+    if (usesTime || usesFrame)
+        s += "    void timeRunningChanged();\n";
+    if (usesTime)
+        s += "    void animatedTimeChanged();\n";
+    if (usesFrame)
+        s += "    void animatedFrameChanged();\n";
+    for (const auto &property : settings.properties)
+        s += QString("    void %1Changed();\n").arg(property.name);
+    s += '\n';
+    s += "protected:\n";
+    s += "    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;\n";
+    if (usesTime || usesFrame)
+        s += "    void itemChange(ItemChange change, const ItemChangeData &value) override;\n";
+    if (usesMouse) {
+        s += "    void mousePressEvent(QMouseEvent *event) override;\n";
+        s += "    void mouseMoveEvent(QMouseEvent *event) override;\n";
+        s += "    void mouseReleaseEvent(QMouseEvent *event) override;\n";
+    }
+    s += '\n';
+    s += "private:\n";
+    if (usesTime || usesFrame) {
+        s += "    void advanceTime();\n";
+        s += '\n';
+    }
+    if (usesSource)
+        s += "    QPointer<QQuickItem> m_source;\n";
+    if (usesTime || usesFrame) {
+        s += "    bool m_timeRunning = false;\n";
+        s += "    QElapsedTimer m_elapsedTimer;\n";
+        s += "    QMetaObject::Connection m_windowConnection;\n";
+    }
+    if (usesTime)
+        s += "    qreal m_animatedTime = 0.0;\n";
+    if (usesFrame)
+        s += "    int m_animatedFrame = 0;\n";
+    if (usesMouse)
+        s += "    QVector4D m_mouse;\n";
+    for (const auto &property : settings.properties) {
+        const QString value = defaultValueString(property, settings.resourcePath);
+        if (value.isEmpty())
+            s += QString("    %1 %2;\n").arg(cppType(property.type), memberName(property.name));
+        else
+            s += QString("    %1 %2 = %3;\n").arg(cppType(property.type), memberName(property.name), value);
+        if (property.type == PropertyType::Image) {
+            s += QString("    QImage %1Image;\n").arg(memberName(property.name));
+            s += QString("    bool %1Dirty = true;\n").arg(memberName(property.name));
+        }
+    }
+    if (!settings.atlasFilename.isEmpty()) {
+        s += "    QImage m_atlasImage;\n";
+        s += "    bool m_atlasDirty = true;\n";
+    }
+    s += "};\n";
+    s += '\n';
+    s += QString("#endif // %1\n").arg(guard);
+    return s.toUtf8();
+}
+
+QByteArray NativeItemGenerator::cppSource(const Settings &settings)
+{
+    int uniformDataSize = 0;
+    const QList<UniformMember> members = uniformLayout(settings.fragmentShader, &uniformDataSize);
+    const QList<SamplerBinding> samplers = samplerBindings(settings.fragmentShader);
+    auto hasMember = [&members](const QString &name) {
+        return std::any_of(members.cbegin(), members.cend(), [&name](const UniformMember &m) {
+            return m.name == name;
+        });
+    };
+    auto findProperty = [&settings](const QString &name) -> const Property * {
+        for (const auto &property : settings.properties) {
+            if (property.name == name)
+                return &property;
+        }
+        return nullptr;
+    };
+    const bool usesSource = std::any_of(samplers.cbegin(), samplers.cend(), [](const SamplerBinding &s) {
+        return s.name == QLatin1String("iSource");
+    });
+    const bool usesTime = hasMember("iTime");
+    const bool usesFrame = hasMember("iFrame");
+    const bool usesMouse = hasMember("iMouse");
+    const bool usesColor = std::any_of(settings.properties.cbegin(), settings.properties.cend(), [](const Property &p) {
+        return p.type == PropertyType::Color;
+    });
+    int textureCount = 1;
+    for (const auto &sampler : samplers)
+        textureCount = qMax(textureCount, sampler.binding + 1);
+    const bool useGrid = !settings.gridMeshSize.isEmpty();
+    const int gridWidth = settings.gridMeshSize.width();
+    const int gridHeight = settings.gridMeshSize.height();
+    const bool useIntIndices = (gridWidth + 1) * (gridHeight + 1) > 0xffff;
+    const QString &c = settings.className;
+    const QString materialName = c + "Material";
+    const QString shaderName = c + "Shader";
+    const QString nodeName = c + "Node";
+
+    QString s;
+    s += "// Generated by Qt Quick Effect Maker, do not edit.\n";
+    s += '\n';
+    s += QString("#include \"%1\"\n").arg(settings.headerFilename);
+    s += '\n';
+    s += "#include <QtCore/qtimer.h>\n";
+    s += "#include <QtGui/qevent.h>\n";
+    s += "#include <QtGui/qmatrix4x4.h>\n";
+    s += "#include <QtGui/qvector2d.h>\n";
+    s += "#include <QtQml/qqmlfile.h>\n";
+    s += "#include <QtQuick/qquickwindow.h>\n";
+    s += "#include <QtQuick/qsgmaterial.h>\n";
+    s += "#include <QtQuick/qsgnode.h>\n";
+    s += "#include <QtQuick/qsgtexture.h>\n";
+    s += "#include <QtQuick/qsgtextureprovider.h>\n";
+    s += "#include <cstring>\n";
+    s += '\n';
+    s += "namespace {\n";
+    s += '\n';
+    s += "// Location of the exported shaders and images\n";
+    s += QString("const QString RESOURCE_PATH = QStringLiteral(\"%1\");\n").arg(settings.resourcePath);
+    s += "// Uniform buffer (std140) starts with qt_Matrix & qt_Opacity, followed by the effect uniforms\n";
+    s += QString("const int UNIFORM_DATA_OFFSET = %1;\n").arg(UNIFORM_DATA_OFFSET);
+    s += QString("const int UNIFORM_DATA_SIZE = %1;\n").arg(qMax(uniformDataSize, UNIFORM_DATA_OFFSET));
+    s += "// Texture slots, indexed by the sampler binding\n";
+    s += QString("const int TEXTURE_COUNT = %1;\n").arg(textureCount);
+    if (useGrid) {
+        s += QString("const int GRID_WIDTH = %1;\n").arg(gridWidth);
+        s += QString("const int GRID_HEIGHT = %1;\n").arg(gridHeight);
+    }
+    s += '\n';
+    s += "template <typename T>\n";
+    s += "void writeUniform(QByteArray &data, int offset, const T &value)\n";
+    s += "{\n";
+    s += "    memcpy(data.data() + offset - UNIFORM_DATA_OFFSET, &value, sizeof(T));\n";
+    s += "}\n";
+    s += '\n';
+    if (usesColor) {
+        s += "// Colors are passed premultiplied, like ShaderEffect does\n";
+        s += "QVector4D premultiplied(const QColor &color)\n";
+        s += "{\n";
+        s += "    const float a = color.alphaF();\n";
+        s += "    return QVector4D(color.redF() * a, color.greenF() * a, color.blueF() * a, a);\n";
+        s += "}\n";
+        s += '\n';
+    }
+    s += "QImage loadImage(const QString &path)\n";
+    s += "{\n";
+    s += "    if (path.isEmpty())\n";
+    s += "        return QImage();\n";
+    s += "    QImage image(path);\n";
+    s += "    if (image.isNull())\n";
+    s += "        qWarning(\"Unable to load image: %s\", qPrintable(path));\n";
+    s += "    return image;\n";
+    s += "}\n";
+    s += '\n';
+    s += "QSGTexture *createTexture(QQuickWindow *window, const QImage &image, bool mipmap)\n";
+    s += "{\n";
+    s += "    if (image.isNull())\n";
+    s += "        return nullptr;\n";
+    s += "    QSGTexture *texture = window->createTextureFromImage(image, mipmap ? QQuickWindow::TextureHasMipmaps\n";
+    s += "                                                                      : QQuickWindow::CreateTextureOptions());\n";
+    s += "    texture->setFiltering(QSGTexture::Linear);\n";
+    s += "    if (mipmap)\n";
+    s += "        texture->setMipmapFiltering(QSGTexture::Linear);\n";
+    s += "    return texture;\n";
+    s += "}\n";
+    s += '\n';
+
+    // Material
+    s += QString("class %1 : public QSGMaterial\n").arg(materialName);
+    s += "{\n";
+    s += "public:\n";
+    s += QString("    %1()\n").arg(materialName);
+    s += "        : uniformData(UNIFORM_DATA_SIZE - UNIFORM_DATA_OFFSET, 0)\n";
+    s += "    {\n";
+    s += "        // Full matrix is needed as the shaders may use vertex positions\n";
+    s += "        setFlag(Blending | RequiresFullMatrix);\n";
+    s += "    }\n";
+    s += '\n';
+    s += "    QSGMaterialType *type() const override\n";
+    s += "    {\n";
+    s += "        static QSGMaterialType type;\n";
+    s += "        return &type;\n";
+    s += "    }\n";
+    s += '\n';
+    s += "    QSGMaterialShader *createShader(QSGRendererInterface::RenderMode) const override;\n";
+    s += '\n';
+    s += "    int compare(const QSGMaterial *other) const override\n";
+    s += "    {\n";
+    s += QString("        auto *o = static_cast<const %1 *>(other);\n").arg(materialName);
+    s += "        for (int i = 0; i < TEXTURE_COUNT; ++i) {\n";
+    s += "            const qint64 key = textures[i] ? textures[i]->comparisonKey() : 0;\n";
+    s += "            const qint64 otherKey = o->textures[i] ? o->textures[i]->comparisonKey() : 0;\n";
+    s += "            if (key != otherKey)\n";
+    s += "                return key < otherKey ? -1 : 1;\n";
+    s += "        }\n";
+    s += "        return memcmp(uniformData.constData(), o->uniformData.constData(), uniformData.size());\n";
+    s += "    }\n";
+    s += '\n';
+    s += "    // Effect uniforms, starting from UNIFORM_DATA_OFFSET\n";
+    s += "    QByteArray uniformData;\n";
+    s += "    bool uniformsDirty = true;\n";
+    s += "    QSGTexture *textures[TEXTURE_COUNT] = {};\n";
+    s += "};\n";
+    s += '\n';
+
+    // Material shader
+    s += QString("class %1 : public QSGMaterialShader\n").arg(shaderName);
+    s += "{\n";
+    s += "public:\n";
+    s += QString("    %1()\n").arg(shaderName);
+    s += "    {\n";
+    s += QString("        setShaderFileName(VertexStage, RESOURCE_PATH + QStringLiteral(\"%1\"));\n")
+            .arg(settings.vertexShaderFilename);
+    s += QString("        setShaderFileName(FragmentStage, RESOURCE_PATH + QStringLiteral(\"%1\"));\n")
+            .arg(settings.fragmentShaderFilename);
+    s += "    }\n";
+    s += '\n';
+    s += "    bool updateUniformData(RenderState &state, QSGMaterial *newMaterial, QSGMaterial *oldMaterial) override\n";
+    s += "    {\n";
+    s += "        bool changed = false;\n";
+    s += "        QByteArray *buf = state.uniformData();\n";
+    s += "        Q_ASSERT(buf->size() >= UNIFORM_DATA_SIZE);\n";
+    s += "        if (state.isMatrixDirty()) {\n";
+    s += "            const QMatrix4x4 m = state.combinedMatrix();\n";
+    s += "            memcpy(buf->data(), m.constData(), 64);\n";
+    s += "            changed = true;\n";
+    s += "        }\n";
+    s += "        if (state.isOpacityDirty()) {\n";
+    s += "            const float opacity = state.opacity();\n";
+    s += "            memcpy(buf->data() + 64, &opacity, 4);\n";
+    s += "            changed = true;\n";
+    s += "        }\n";
+    s += QString("        auto *material = static_cast<%1 *>(newMaterial);\n").arg(materialName);
+    s += "        if (newMaterial != oldMaterial || material->uniformsDirty) {\n";
+    s += "            memcpy(buf->data() + UNIFORM_DATA_OFFSET, material->uniformData.constData(),\n";
+    s += "                   material->uniformData.size());\n";
+    s += "            material->uniformsDirty = false;\n";
+    s += "            changed = true;\n";
+    s += "        }\n";
+    s += "        return changed;\n";
+    s += "    }\n";
+    s += '\n';
+    s += "    void updateSampledImage(RenderState &state, int binding, QSGTexture **texture,\n";
+    s += "                            QSGMaterial *newMaterial, QSGMaterial *) override\n";
+    s += "    {\n";
+    s += QString("        auto *material = static_cast<%1 *>(newMaterial);\n").arg(materialName);
+    s += "        if (binding < 0 || binding >= TEXTURE_COUNT || !material->textures[binding])\n";
+    s += "            return;\n";
+    s += "        *texture = material->textures[binding];\n";
+    s += "        (*texture)->commitTextureOperations(state.rhi(), state.resourceUpdateBatch());\n";
+    s += "    }\n";
+    s += "};\n";
+    s += '\n';
+    s += QString("QSGMaterialShader *%1::createShader(QSGRendererInterface::RenderMode) const\n").arg(materialName);
+    s += "{\n";
+    s += QString("    return new %1;\n").arg(shaderName);
+    s += "}\n";
+    s += '\n';
+
+    // Node
+    s += QString("class %1 : public QSGGeometryNode\n").arg(nodeName);
+    s += "{\n";
+    s += "public:\n";
+    s += QString("    %1()\n").arg(nodeName);
+    s += "    {\n";
+    if (useGrid) {
+        s += "        auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(),\n";
+        s += "                                         (GRID_WIDTH + 1) * (GRID_HEIGHT + 1),\n";
+        s += QString("                                         GRID_WIDTH * GRID_HEIGHT * 6, QSGGeometry::%1);\n")
+                .arg(useIntIndices ? "UnsignedIntType" : "UnsignedShortType");
+        s += "        geometry->setDrawingMode(QSGGeometry::DrawTriangles);\n";
+    } else {
+        s += "        auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 4);\n";
+    }
+    s += "        setGeometry(geometry);\n";
+    s += "        setFlag(OwnsGeometry);\n";
+    s += QString("        setMaterial(new %1);\n").arg(materialName);
+    s += "        setFlag(OwnsMaterial);\n";
+    s += "    }\n";
+    s += '\n';
+    s += QString("    ~%1() override\n").arg(nodeName);
+    s += "    {\n";
+    s += "        delete dummyTexture;\n";
+    s += "        for (auto *texture : imageTextures)\n";
+    s += "            delete texture;\n";
+    s += "    }\n";
+    s += '\n';
+    s += QString("    %1 *effectMaterial() const\n").arg(materialName);
+    s += "    {\n";
+    s += QString("        return static_cast<%1 *>(material());\n").arg(materialName);
+    s += "    }\n";
+    s += '\n';
+    s += "    void updateGeometry(const QSizeF &size)\n";
+    s += "    {\n";
+    if (useGrid) {
+        s += "        QSGGeometry::TexturedPoint2D *v = geometry()->vertexDataAsTexturedPoint2D();\n";
+        s += "        for (int y = 0; y <= GRID_HEIGHT; ++y) {\n";
+        s += "            for (int x = 0; x <= GRID_WIDTH; ++x) {\n";
+        s += "                const float tx = float(x) / GRID_WIDTH;\n";
+        s += "                const float ty = float(y) / GRID_HEIGHT;\n";
+        s += "                v->set(tx * size.width(), ty * size.height(), tx, ty);\n";
+        s += "                ++v;\n";
+        s += "            }\n";
+        s += "        }\n";
+        s += QString("        auto *i = geometry()->%1();\n").arg(useIntIndices ? "indexDataAsUInt" : "indexDataAsUShort");
+        s += "        for (int y = 0; y < GRID_HEIGHT; ++y) {\n";
+        s += "            for (int x = 0; x < GRID_WIDTH; ++x) {\n";
+        s += "                const int topLeft = y * (GRID_WIDTH + 1) + x;\n";
+        s += "                const int bottomLeft = topLeft + GRID_WIDTH + 1;\n";
+        s += "                i[0] = topLeft;\n";
+        s += "                i[1] = bottomLeft;\n";
+        s += "                i[2] = topLeft + 1;\n";
+        s += "                i[3] = topLeft + 1;\n";
+        s += "                i[4] = bottomLeft;\n";
+        s += "                i[5] = bottomLeft + 1;\n";
+        s += "                i += 6;\n";
+        s += "            }\n";
+        s += "        }\n";
+    } else {
+        s += "        QSGGeometry::updateTexturedRectGeometry(geometry(), QRectF(QPointF(), size), QRectF(0, 0, 1, 1));\n";
+    }
+    s += "        markDirty(QSGNode::DirtyGeometry);\n";
+    s += "    }\n";
+    s += '\n';
+    s += "    QSizeF size;\n";
+    s += "    // Transparent texture for the samplers without an image\n";
+    s += "    QSGTexture *dummyTexture = nullptr;\n";
+    s += "    // Textures created from the images, indexed by the sampler binding\n";
+    s += "    QSGTexture *imageTextures[TEXTURE_COUNT] = {};\n";
+    if (usesSource) {
+        s += "    QPointer<QSGTextureProvider> sourceProvider;\n";
+        s += "    QMetaObject::Connection sourceConnection;\n";
+    }
+    s += "};\n";
+    s += '\n';
+    s += "} // namespace\n";
+    s += '\n';
+
+    // Item
+    s += QString("%1::%1(QQuickItem *parent)\n").arg(c);
+    s += "    : QQuickItem(parent)\n";
+    s += "{\n";
+    s += "    setFlag(ItemHasContents);\n";
+    if (usesMouse)
+        s += "    setAcceptedMouseButtons(Qt::LeftButton);\n";
+    for (const auto &property : settings.properties) {
+        if (property.type == PropertyType::Image) {
+            const QString member = memberName(property.name);
+            s += QString("    %1Image = loadImage(QQmlFile::urlToLocalFileOrQrc(%1));\n").arg(member);
+        }
+    }
+    if (!settings.atlasFilename.isEmpty())
+        s += QString("    m_atlasImage = loadImage(RESOURCE_PATH + QStringLiteral(\"%1\"));\n").arg(settings.atlasFilename);
+    s += "}\n";
+    s += '\n';
+
+    // Setters
+    auto addSetter = [&s, &c](const QString &name, const QString &argument, const QString &extra) {
+        const QString member = memberName(name);
+        s += QString("void %1::%2(%3%4)\n").arg(c, setterName(name), argument, name);
+        s += "{\n";
+        s += QString("    if (%1 == %2)\n").arg(member, name);
+        s += "        return;\n";
+        s += QString("    %1 = %2;\n").arg(member, name);
+        s += extra;
+        s += QString("    Q_EMIT %1Changed();\n").arg(name);
+        s += "    update();\n";
+        s += "}\n";
+        s += '\n';
+    };
+    if (usesSource)
+        addSetter("source", "QQuickItem *", QString());
+    if (usesTime || usesFrame)
+        addSetter("timeRunning", "bool ", "    m_elapsedTimer.invalidate();\n");
+    if (usesTime)
+        addSetter("animatedTime", "qreal ", QString());
+    if (usesFrame)
+        addSetter("animatedFrame", "int ", QString());
+    for (const auto &property : settings.properties) {
+        QString extra;
+        if (property.type == PropertyType::Image) {
+            const QString member = memberName(property.name);
+            extra += QString("    %1Image = loadImage(QQmlFile::urlToLocalFileOrQrc(%1));\n").arg(member);
+            extra += QString("    %1Dirty = true;\n").arg(member);
+        }
+        addSetter(property.name, argumentType(property.type), extra);
+    }
+
+    // Animation
+    if (usesTime || usesFrame) {
+        s += QString("void %1::itemChange(ItemChange change, const ItemChangeData &value)\n").arg(c);
+        s += "{\n";
+        s += "    if (change == ItemSceneChange) {\n";
+        s += "        disconnect(m_windowConnection);\n";
+        s += "        if (value.window)\n";
+        s += QString("            m_windowConnection = connect(value.window, &QQuickWindow::afterAnimating, this, &%1::advanceTime);\n").arg(c);
+        s += "    }\n";
+        s += "    QQuickItem::itemChange(change, value);\n";
+        s += "}\n";
+        s += '\n';
+        s += "// Advances the time once per frame, like FrameAnimation\n";
+        s += QString("void %1::advanceTime()\n").arg(c);
+        s += "{\n";
+        s += "    if (!m_timeRunning)\n";
+        s += "        return;\n";
+        s += "    if (!m_elapsedTimer.isValid()) {\n";
+        s += "        m_elapsedTimer.start();\n";
+        s += "        update();\n";
+        s += "        return;\n";
+        s += "    }\n";
+        if (usesTime)
+            s += "    setAnimatedTime(m_animatedTime + m_elapsedTimer.restart() / 1000.0);\n";
+        if (usesFrame)
+            s += "    setAnimatedFrame(m_animatedFrame + 1);\n";
+        s += "}\n";
+        s += '\n';
+    }
+
+    // Mouse handling for iMouse variable, matches the exported QML component
+    if (usesMouse) {
+        s += QString("void %1::mousePressEvent(QMouseEvent *event)\n").arg(c);
+        s += "{\n";
+        s += "    const QPointF pos = event->position();\n";
+        s += "    m_mouse = QVector4D(pos.x(), pos.y(), pos.x(), pos.y());\n";
+        s += "    QTimer::singleShot(20, this, [this]() {\n";
+        s += "        m_mouse.setW(-m_mouse.w());\n";
+        s += "        update();\n";
+        s += "    });\n";
+        s += "    update();\n";
+        s += "}\n";
+        s += '\n';
+        s += QString("void %1::mouseMoveEvent(QMouseEvent *event)\n").arg(c);
+        s += "{\n";
+        s += "    const QPointF pos = event->position();\n";
+        s += "    m_mouse.setX(pos.x());\n";
+        s += "    m_mouse.setY(pos.y());\n";
+        s += "    update();\n";
+        s += "}\n";
+        s += '\n';
+        s += QString("void %1::mouseReleaseEvent(QMouseEvent *)\n").arg(c);
+        s += "{\n";
+        s += "    m_mouse.setZ(-m_mouse.z());\n";
+        s += "    update();\n";
+        s += "}\n";
+        s += '\n';
+    }
+
+    // Scene graph update
+    s += QString("QSGNode *%1::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)\n").arg(c);
+    s += "{\n";
+    s += QString("    auto *node = static_cast<%1 *>(oldNode);\n").arg(nodeName);
+    s += "    if (width() <= 0 || height() <= 0) {\n";
+    s += "        delete node;\n";
+    s += "        return nullptr;\n";
+    s += "    }\n";
+    s += "    if (!node) {\n";
+    s += QString("        node = new %1;\n").arg(nodeName);
+    s += "        QImage dummyImage(1, 1, QImage::Format_RGBA8888_Premultiplied);\n";
+    s += "        dummyImage.fill(Qt::transparent);\n";
+    s += "        node->dummyTexture = window()->createTextureFromImage(dummyImage);\n";
+    for (const auto &property : settings.properties) {
+        if (property.type == PropertyType::Image)
+            s += QString("        %1Dirty = true;\n").arg(memberName(property.name));
+    }
+    if (!settings.atlasFilename.isEmpty())
+        s += "        m_atlasDirty = true;\n";
+    s += "    }\n";
+    s += QString("    %1 *material = node->effectMaterial();\n").arg(materialName);
+    s += '\n';
+    s += "    if (node->size != size()) {\n";
+    s += "        node->size = size();\n";
+    s += "        node->updateGeometry(node->size);\n";
+    s += "    }\n";
+    s += '\n';
+    for (const auto &sampler : samplers) {
+        const QString index = QString::number(sampler.binding);
+        if (sampler.name == QLatin1String("iSource")) {
+            s += "    QSGTextureProvider *provider = (m_source && m_source->isTextureProvider())\n";
+            s += "            ? m_source->textureProvider() : nullptr;\n";
+            s += "    if (node->sourceProvider != provider) {\n";
+            s += "        disconnect(node->sourceConnection);\n";
+            s += "        if (provider)\n";
+            s += "            node->sourceConnection = connect(provider, &QSGTextureProvider::textureChanged,\n";
+            s += "                                             this, &QQuickItem::update, Qt::QueuedConnection);\n";
+            s += "        node->sourceProvider = provider;\n";
+            s += "    }\n";
+            s += "    QSGTexture *sourceTexture = provider ? provider->texture() : nullptr;\n";
+            s += QString("    material->textures[%1] = sourceTexture ? sourceTexture : node->dummyTexture;\n").arg(index);
+            continue;
+        }
+        QString imageMember;
+        bool mipmap = false;
+        if (sampler.name == QLatin1String("iImageAtlas") && !settings.atlasFilename.isEmpty()) {
+            imageMember = QStringLiteral("m_atlas");
+        } else if (const Property *property = findProperty(sampler.name)) {
+            imageMember = memberName(property->name);
+            mipmap = property->mipmap;
+        }
+        if (imageMember.isEmpty()) {
+            s += QString("    // %1 is not available\n").arg(sampler.name);
+            s += QString("    material->textures[%1] = node->dummyTexture;\n").arg(index);
+            continue;
+        }
+        s += QString("    if (%1Dirty) {\n").arg(imageMember);
+        s += QString("        delete node->imageTextures[%1];\n").arg(index);
+        s += QString("        node->imageTextures[%1] = createTexture(window(), %2Image, %3);\n")
+                .arg(index, imageMember, mipmap ? "true" : "false");
+        s += QString("        %1Dirty = false;\n").arg(imageMember);
+        s += "    }\n";
+        s += QString("    material->textures[%1] = node->imageTextures[%1] ? node->imageTextures[%1]\n").arg(index);
+        s += QString("                                                   : node->dummyTexture;\n");
+    }
+    s += '\n';
+    s += "    QByteArray data(UNIFORM_DATA_SIZE - UNIFORM_DATA_OFFSET, 0);\n";
+    for (const auto &member : members) {
+        if (member.offset < UNIFORM_DATA_OFFSET)
+            continue; // qt_Matrix & qt_Opacity
+        QString value;
+        if (member.name == QLatin1String("iTime"))
+            value = QStringLiteral("float(m_animatedTime)");
+        else if (member.name == QLatin1String("iFrame"))
+            value = QStringLiteral("m_animatedFrame");
+        else if (member.name == QLatin1String("iResolution"))
+            value = QStringLiteral("QVector3D(float(width()), float(height()), 1.0f)");
+        else if (member.name == QLatin1String("iMouse"))
+            value = QStringLiteral("m_mouse");
+        else if (const Property *property = findProperty(member.name))
+            value = uniformValueString(*property);
+        if (value.isEmpty())
+            s += QString("    // %1 is not available\n").arg(member.name);
+        else
+            s += QString("    writeUniform(data, %1, %2); // %3\n").arg(member.offset).arg(value, member.name);
+    }
+    s += "    if (material->uniformData != data) {\n";
+    s += "        material->uniformData = data;\n";
+    s += "        material->uniformsDirty = true;\n";
+    s += "    }\n";
+    s += "    node->markDirty(QSGNode::DirtyMaterial);\n";
+    s += "    return node;\n";
+    s += "}\n";
+    return s.toUtf8();
+}
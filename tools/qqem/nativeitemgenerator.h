@@ -0,0 +1,76 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef NATIVEITEMGENERATOR_H
+#define NATIVEITEMGENERATOR_H
+
+#include <QByteArray>
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QVariant>
+
+// Generates C++ QQuickItem subclass which renders the effect with a custom
+// QSGMaterial. Uniform values are written straight into the uniform buffer
+// with the std140 layout of the shaders, without ShaderEffect property
+// introspection and QVariant conversions.
+class NativeItemGenerator
+{
+public:
+    enum class PropertyType
+    {
+        Bool,
+        Int,
+        Real,
+        Point,
+        Vector3D,
+        Vector4D,
+        Color,
+        Image
+    };
+
+    struct Property {
+        QString name;
+        PropertyType type = PropertyType::Real;
+        // For images, the default image filename
+        QVariant defaultValue;
+        QString description;
+        bool mipmap = false;
+    };
+
+    struct Settings {
+        QString className;
+        QString headerFilename;
+        // Resource path of the shaders & images, e.g. ":/"
+        QString resourcePath;
+        QString vertexShaderFilename;
+        QString fragmentShaderFilename;
+        // Fragment shader source, used for the uniform buffer & sampler layout
+        QString fragmentShader;
+        // Filename of the image atlas, when used
+        QString atlasFilename;
+        QList<Property> properties;
+        // Size of the grid mesh, empty when not used
+        QSize gridMeshSize;
+    };
+
+    static QByteArray cppHeader(const Settings &settings);
+    static QByteArray cppSource(const Settings &settings);
+
+private:
+    struct UniformMember {
+        QString type;
+        QString name;
+        int offset = 0;
+    };
+    struct SamplerBinding {
+        QString name;
+        int binding = 0;
+    };
+
+    // Returns the members of the uniform buffer with std140 offsets
+    static QList<UniformMember> uniformLayout(const QString &shader, int *size);
+    static QList<SamplerBinding> samplerBindings(const QString &shader);
+};
+
+#endif // NATIVEITEMGENERATOR_H
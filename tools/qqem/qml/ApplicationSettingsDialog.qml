@@ -14,7 +14,7 @@ Window {
 
     title: qsTr("Preferences")
     width: 660
-    height: 620
+    height: 700
     minimumWidth: 400
     minimumHeight: 400
     color: mainView.backgroundColor1
@@ -293,6 +293,99 @@ Window {
                 width: 1
                 height: 20
             }
+            Column {
+                width: parent.width
+                Row {
+                    height: 40
+                    spacing: 10
+                    Text {
+                        anchors.verticalCenter: parent.verticalCenter
+                        color: mainView.foregroundColor2
+                        font.pixelSize: 14
+                        font.bold: true
+                        text: "Autosave project:"
+                    }
+                    ComboBox {
+                        id: autoSaveSelector
+                        anchors.verticalCenter: parent.verticalCenter
+                        width: 160
+                        height: parent.height
+                        textRole: "text"
+                        valueRole: "value"
+                        model: [
+                            { value: 0, text: qsTr("Disabled") },
+                            { value: 1, text: qsTr("Every minute") },
+                            { value: 2, text: qsTr("Every 2 minutes") },
+                            { value: 5, text: qsTr("Every 5 minutes") },
+                            { value: 10, text: qsTr("Every 10 minutes") }
+                        ]
+                        onActivated: {
+                            effectManager.settings.autoSaveInterval = currentValue;
+                        }
+                        Component.onCompleted: {
+                            currentIndex = indexOfValue(effectManager.settings.autoSaveInterval);
+                        }
+                    }
+                }
+                Text {
+                    width: parent.width
+                    color: mainView.foregroundColor2
+                    font.pixelSize: 11
+                    wrapMode: Text.WordWrap
+                    text: "When enabled, unsaved changes are saved into the project file periodically. Saving happens in the background and is skipped when the project content hasn't changed."
+                }
+            }
+            Item {
+                width: 1
+                height: 20
+            }
+            Column {
+                width: parent.width
+                Row {
+                    height: 40
+                    spacing: 10
+                    Text {
+                        anchors.verticalCenter: parent.verticalCenter
+                        color: mainView.foregroundColor2
+                        font.pixelSize: 14
+                        font.bold: true
+                        text: "GPU memory budget:"
+                    }
+                    ComboBox {
+                        id: gpuMemoryBudgetSelector
+                        anchors.verticalCenter: parent.verticalCenter
+                        width: 160
+                        height: parent.height
+                        textRole: "text"
+                        valueRole: "value"
+                        model: [
+                            { value: 0, text: qsTr("No budget") },
+                            { value: 16, text: qsTr("16 MB") },
+                            { value: 32, text: qsTr("32 MB") },
+                            { value: 64, text: qsTr("64 MB") },
+                            { value: 128, text: qsTr("128 MB") },
+                            { value: 256, text: qsTr("256 MB") }
+                        ]
+                        onActivated: {
+                            effectManager.settings.gpuMemoryBudget = currentValue;
+                        }
+                        Component.onCompleted: {
+                            currentIndex = indexOfValue(effectManager.settings.gpuMemoryBudget);
+                        }
+                    }
+                }
+                Text {
+                    width: parent.width
+                    color: mainView.foregroundColor2
+                    font.pixelSize: 11
+                    wrapMode: Text.WordWrap
+                    text: "Estimated GPU memory of the effect layers and textures is shown in the preview, with a warning when it exceeds the budget of the target device."
+                }
+            }
+            Item {
+                width: 1
+                height: 20
+            }
             RowLayout {
                 id: fontSelection
                 width: parent.width
@@ -227,7 +227,16 @@ Item {
                         return;
 
                     if ((event.modifiers & Qt.ControlModifier) && (event.key === Qt.Key_I)) {
-                        effectManager.autoIndentCurrentCode(tabBarEditors.currentIndex, textArea.text);
+                        effectManager.autoIndentCurrentCode(tabBarEditors.currentIndex, textArea);
+                        event.accepted = true;
+                    } else if (event.key === Qt.Key_F12 && contentType === 0) {
+                        // Go to definition, or with shift to the next usage
+                        const word = effectManager.codeHelper.getCurrentWord(textArea);
+                        const line = textArea.text.substring(0, textArea.cursorPosition).split("\n").length - 1;
+                        const nextUsage = (event.modifiers & Qt.ShiftModifier) !== 0;
+                        const location = effectManager.goToSymbol(word, editorIndex, line, nextUsage);
+                        if (location.stage !== undefined)
+                            editorView.showCodeLine(location.stage, location.line);
                         event.accepted = true;
                     } else {
                         event.accepted = effectManager.processKey(tabBarEditors.currentIndex, event.key, event.modifiers, textArea);
@@ -288,6 +297,10 @@ Item {
                         typeColor  = "#00ff00";
                     else if (model.type === 2)
                         typeColor = "#0000ff";
+                    else if (model.type === 3)
+                        typeColor = "#ffff00";
+                    else if (model.type === 4)
+                        typeColor = "#ff00ff";
                     return typeColor;
                 }
             }
@@ -35,6 +35,19 @@ Item {
             fragmentEditor.scrollToLine(codeLine);
     }
 
+    // Shows the code line of the tab, with the cursor at the start of the line
+    function showCodeLine(tabIndex, codeLine) {
+        tabBarEditors.currentIndex = tabIndex;
+        const editor = tabIndex === 0 ? qmlEditor : (tabIndex === 1 ? vertexEditor : fragmentEditor);
+        const lines = editor.text.split("\n");
+        let position = 0;
+        for (let i = 0; i < Math.min(codeLine, lines.length); i++)
+            position += lines[i].length + 1;
+        editor.textArea.cursorPosition = Math.min(position, editor.text.length);
+        editor.textArea.forceActiveFocus();
+        editor.scrollToLine(codeLine);
+    }
+
     ColumnLayout {
         width: parent.width
         height: parent.height
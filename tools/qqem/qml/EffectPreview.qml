@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
 
 import QtQuick
+import QtQuick.Controls
 import "../nodes/common"
 
 Item {
@@ -12,6 +13,19 @@ Item {
     property bool timeRunning: previewAnimationRunning
     property rect paddingRect: effectManager.effectPadding
     property alias source: source
+    // Size of the GridMesh cells in pixels, mesh resolution follows the item size
+    property real meshCellSize: effectManager.defaultMeshCellSize()
+    // Amount of vertices in the current GridMesh, 0 when the effect doesn't use a mesh
+    property int meshVertexCount: 0
+    // Amount of pixels BlurHelper renders offscreen, 0 when the effect doesn't use blur sources
+    property int blurPixelCount: 0
+    // Estimated GPU memory of the effect, see EffectManager::gpuMemoryUsage()
+    property var gpuMemoryUsage: ({})
+
+    function updateGpuMemory() {
+        rootItem.gpuMemoryUsage = effectManager.gpuMemoryUsage(Qt.size(source.width, source.height),
+                                                               rootItem.blurPixelCount);
+    }
 
     // Scale the content automatically to closest scale step
     // With a small minimum margin
@@ -132,8 +146,11 @@ Item {
     BlurHelper {
         id: blurHelper
         anchors.fill: parent
-        property int blurMax: g_propertyData.blur_helper_max_level ? g_propertyData.blur_helper_max_level : 64
-        property real blurMultiplier: g_propertyData.blurMultiplier ? g_propertyData.blurMultiplier : 0
+        source: rootItem.source
+        blurMax: g_propertyData.blur_helper_max_level ? g_propertyData.blur_helper_max_level : 64
+        blurMultiplier: g_propertyData.blurMultiplier ? g_propertyData.blurMultiplier : 0
+        useMipmap: g_propertyData.BLUR_HELPER_MIPMAP ? Number(g_propertyData.BLUR_HELPER_MIPMAP) === 1 : false
+        dualFilterPasses: g_propertyData.BLUR_HELPER_DUAL_FILTER ? Number(g_propertyData.BLUR_HELPER_DUAL_FILTER) : 0
     }
 
     Item {
@@ -161,6 +178,40 @@ Item {
         visible: effectPreviewToolbar.showContentBorders
     }
 
+    Column {
+        anchors.left: parent.left
+        anchors.bottom: parent.bottom
+        anchors.margins: 10
+        Text {
+            text: "Blur offscreen pixels: " + rootItem.blurPixelCount
+            font.pixelSize: 14
+            color: mainView.foregroundColor2
+            visible: rootItem.blurPixelCount > 0
+        }
+        Text {
+            text: "Mesh vertices: " + rootItem.meshVertexCount
+            font.pixelSize: 14
+            color: mainView.foregroundColor2
+            visible: rootItem.meshVertexCount > 0
+        }
+        Text {
+            text: "GPU memory: " + rootItem.gpuMemoryUsage.total
+            font.pixelSize: 14
+            color: rootItem.gpuMemoryUsage.overBudget ? "#e04040" : mainView.foregroundColor2
+            visible: rootItem.gpuMemoryUsage.total !== undefined
+            MouseArea {
+                id: gpuMemoryMouseArea
+                anchors.fill: parent
+                hoverEnabled: true
+            }
+            ToolTip {
+                visible: gpuMemoryMouseArea.containsMouse
+                delay: 500
+                text: rootItem.gpuMemoryUsage.report ?? ""
+            }
+        }
+    }
+
     EffectPreviewToolbar {
         id: effectPreviewToolbar
         anchors.top: parent.top
@@ -171,6 +222,8 @@ Item {
         var oldComponent = componentParent.children[0];
         if (oldComponent)
             oldComponent.destroy();
+        rootItem.meshVertexCount = 0;
+        rootItem.blurPixelCount = 0;
 
         try {
             const newObject = Qt.createQmlObject(
@@ -178,6 +231,16 @@ Item {
                 componentParent,
                 ""
             );
+            if (newObject.meshResolution !== undefined) {
+                rootItem.meshVertexCount = Qt.binding(function() {
+                    return (newObject.meshResolution.width + 1) * (newObject.meshResolution.height + 1);
+                });
+            }
+            if (newObject.iSourceBlur1 !== undefined || newObject.iSourceBlurMipmap !== undefined) {
+                rootItem.blurPixelCount = Qt.binding(function() {
+                    return blurHelper.offscreenPixels;
+                });
+            }
             effectManager.resetEffectError(0);
         } catch(error) {
             let errorString = "QML: ERROR: ";
@@ -190,6 +253,25 @@ Item {
             }
             effectManager.setEffectError(errorString, 0, errorLine);
         }
+        updateGpuMemory();
+    }
+
+    onBlurPixelCountChanged: updateGpuMemory()
+
+    Connections {
+        target: source
+        function onWidthChanged() {
+            updateGpuMemory();
+        }
+        function onHeightChanged() {
+            updateGpuMemory();
+        }
+    }
+    Connections {
+        target: effectManager.settings
+        function onGpuMemoryBudgetChanged() {
+            updateGpuMemory();
+        }
     }
 
     Connections {
@@ -14,7 +14,7 @@ CustomDialog {
     property string defaultPath: "file:///" + effectManager.projectDirectory + "/export"
     title: qsTr("Export Effect")
     width: 540
-    height: 580
+    height: 860
     modal: true
     focus: true
     standardButtons: Dialog.Ok | Dialog.Cancel
@@ -51,6 +51,18 @@ CustomDialog {
         plainShadersCheckBox.checked = (effectManager.exportFlags & 4);
         imagesCheckBox.checked = (effectManager.exportFlags & 8);
         qrcCheckBox.checked = (effectManager.exportFlags & 16);
+        if (effectManager.exportFlags & 32)
+            imageCompressionSelector.currentIndex = 1;
+        else if (effectManager.exportFlags & 64)
+            imageCompressionSelector.currentIndex = 2;
+        else
+            imageCompressionSelector.currentIndex = 0;
+        imageAtlasCheckBox.checked = (effectManager.exportFlags & 128);
+        embeddedResourcesCheckBox.checked = (effectManager.exportFlags & 256);
+        qmlModuleCheckBox.checked = (effectManager.exportFlags & 512);
+        nativeItemCheckBox.checked = (effectManager.exportFlags & 1024);
+        bakedFunctionsCheckBox.checked = (effectManager.exportFlags & 2048);
+        fusedColorNodesCheckBox.checked = (effectManager.exportFlags & 4096);
     }
 
     function exportEffect() {
@@ -61,6 +73,14 @@ CustomDialog {
         exportFlags += Number(plainShadersCheckBox.checked) * 4;
         exportFlags += Number(imagesCheckBox.checked) * 8;
         exportFlags += Number(qrcCheckBox.checked) * 16;
+        exportFlags += Number(imageCompressionSelector.currentIndex === 1) * 32;
+        exportFlags += Number(imageCompressionSelector.currentIndex === 2) * 64;
+        exportFlags += Number(imageAtlasCheckBox.checked) * 128;
+        exportFlags += Number(embeddedResourcesCheckBox.checked) * 256;
+        exportFlags += Number(qmlModuleCheckBox.checked) * 512;
+        exportFlags += Number(nativeItemCheckBox.checked) * 1024;
+        exportFlags += Number(bakedFunctionsCheckBox.checked) * 2048;
+        exportFlags += Number(fusedColorNodesCheckBox.checked) * 4096;
         var qsbVersionIndex = qsbVersionSelector.currentIndex;
         effectManager.exportEffect(pathTextEdit.text, nameTextEdit.text, exportFlags, qsbVersionIndex);
     }
@@ -164,11 +184,61 @@ CustomDialog {
             text: "Images"
             checked: true
         }
+        Row {
+            leftPadding: 30
+            spacing: 10
+            enabled: imagesCheckBox.checked
+            Label {
+                anchors.verticalCenter: parent.verticalCenter
+                text: qsTr("Compression:")
+                font.pixelSize: 14
+                color: mainView.foregroundColor2
+                opacity: parent.enabled ? 1.0 : 0.5
+            }
+            ComboBox {
+                id: imageCompressionSelector
+                anchors.verticalCenter: parent.verticalCenter
+                width: 260
+                height: 40
+                model: ["None", "ETC2 KTX (embedded & mobile)", "BC1/BC3 KTX (desktop)"]
+            }
+        }
+        CheckBox {
+            id: imageAtlasCheckBox
+            leftPadding: 30
+            enabled: imagesCheckBox.checked
+            text: "Pack small images into an atlas"
+            ToolTip {
+                visible: imageAtlasCheckBox.hovered
+                delay: 1000
+                text: "Packed images are not available as properties of the exported component"
+            }
+        }
+        CheckBox {
+            id: bakedFunctionsCheckBox
+            text: "Bake @bake functions into textures"
+        }
+        CheckBox {
+            id: fusedColorNodesCheckBox
+            text: "Fuse color adjustment nodes into a LUT"
+        }
         CheckBox {
             id: qrcCheckBox
             text: "Resource collection file (qrc)"
             checked: true
         }
+        CheckBox {
+            id: embeddedResourcesCheckBox
+            text: "C++ source with embedded resources"
+        }
+        CheckBox {
+            id: qmlModuleCheckBox
+            text: "QML module files (qmldir, CMakeLists.txt)"
+        }
+        CheckBox {
+            id: nativeItemCheckBox
+            text: "C++ QQuickItem (renders without ShaderEffect)"
+        }
     }
     onAccepted: {
         root.exportEffect();
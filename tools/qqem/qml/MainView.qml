@@ -169,4 +169,39 @@ Item {
             }
         }
     }
+
+    // Shown while project is loaded in the background
+    Rectangle {
+        anchors.fill: parent
+        color: "#80000000"
+        visible: effectManager.projectLoading
+        z: 10
+        MouseArea {
+            // Block the input until project has been loaded
+            anchors.fill: parent
+            acceptedButtons: Qt.AllButtons
+            hoverEnabled: true
+            onWheel: (wheel) => {
+                wheel.accepted = true;
+            }
+        }
+        Column {
+            anchors.centerIn: parent
+            width: parent.width * 0.3
+            spacing: 10
+            Text {
+                anchors.horizontalCenter: parent.horizontalCenter
+                font.pixelSize: 14
+                color: mainView.foregroundColor2
+                text: qsTr("Loading project...")
+            }
+            ProgressBar {
+                width: parent.width
+                from: 0.0
+                to: 1.0
+                value: effectManager.projectLoadProgress
+                indeterminate: value <= 0.0
+            }
+        }
+    }
 }
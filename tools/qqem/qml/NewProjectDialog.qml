@@ -77,11 +77,12 @@ CustomDialog {
     }
     onAccepted: {
         mainView.mainToolbar.setDesignModeInstantly(true);
-        effectManager.newProject(pathTextEdit.text, nameTextEdit.text, clearNodeView, true);
         if (root.exportNext) {
-            // Proceed next with exporting
-            mainWindow.exportAction();
+            // Proceed next with exporting, once the new project has been saved
+            mainWindow.afterSaveAction = mainWindow.exportAction;
             root.exportNext = false;
         }
+        if (!effectManager.newProject(pathTextEdit.text, nameTextEdit.text, clearNodeView, true))
+            mainWindow.afterSaveAction = null;
     }
 }
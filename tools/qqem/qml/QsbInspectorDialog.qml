@@ -38,10 +38,22 @@ CustomDialog {
         }
     }
 
+    FileDialog {
+        id: baselineFileDialog
+        title: "Open an QSB File to Compare With"
+        nameFilters: ["Qt Shader Baker File (*.qsb)"]
+        onAccepted: {
+            if (currentFile && qsbInspectorHelper.loadBaselineQsb(currentFile)) {
+                // Show the changes in the analysis
+                sourceComboBox.currentIndex = sourceComboBox.indexOfValue(-2);
+            }
+        }
+    }
+
     GridLayout {
         id: detailsArea
         width: parent.width
-        columns: 4
+        columns: 5
         columnSpacing: 10
         rowSpacing: 0
         Text {
@@ -80,7 +92,17 @@ CustomDialog {
                 qsbFileDialog.open();
             }
         }
+        Button {
+            Layout.preferredHeight: 40
+            text: qsTr("Compare");
+            enabled: qsbInspectorHelper.shaderData.currentFile !== ""
+            onClicked: {
+                baselineFileDialog.currentFolder = effectManager.getDirectory(qsbInspectorHelper.shaderData.currentFile);
+                baselineFileDialog.open();
+            }
+        }
         ComboBox {
+            id: sourceComboBox
             Layout.preferredWidth: 160
             Layout.preferredHeight: 40
             textRole: "name"
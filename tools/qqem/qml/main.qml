@@ -21,6 +21,8 @@ ApplicationWindow {
     property bool canRedo: !mainView.designMode && currentEditorComponent ? currentEditorComponent.canRedo : false
     property bool canFind: !mainView.designMode && currentEditorComponent
     property bool quitAccepted: false
+    // Action to continue with when the project has been saved
+    property var afterSaveAction: null
 
     onClosing: function(close) {
         maybeQuitAction();
@@ -290,9 +292,8 @@ ApplicationWindow {
         }
 
         onAccepted: {
-            // Save and then proceed to action
-            effectManager.saveProject();
-            goToAction();
+            // Save and then proceed to action, unless saving failed
+            mainWindow.saveProjectAndThen(goToAction);
         }
         onDiscarded: {
             // Discard saving, proceed to action directly
@@ -304,6 +305,17 @@ ApplicationWindow {
         }
     }
 
+    Connections {
+        target: effectManager
+        function onProjectSaved(saved) {
+            const action = mainWindow.afterSaveAction;
+            mainWindow.afterSaveAction = null;
+            // The action is canceled when saving failed
+            if (saved && action)
+                action();
+        }
+    }
+
     AboutDialog {
         id: aboutDialog
         parent: Overlay.overlay
@@ -357,10 +369,17 @@ ApplicationWindow {
         }
     }
 
+    // Saves the project in the background and calls action
+    // when the save has succeeded
+    function saveProjectAndThen(action) {
+        mainWindow.afterSaveAction = action;
+        if (!effectManager.saveProject())
+            mainWindow.afterSaveAction = null;
+    }
+
     function saveAndExportProjectAction() {
         if (effectManager.hasProjectFilename) {
-            effectManager.saveProject();
-            mainWindow.exportAction();
+            saveProjectAndThen(mainWindow.exportAction);
         } else {
             newProjectDialog.exportNext = true;
             mainWindow.newProjectAction(false);
@@ -2,9 +2,17 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
 
 #include "qsbinspectorhelper.h"
+#include "spirvusage.h"
 #include <QFile>
+#include <QFileInfo>
 #include <QCollator>
 #include <QUrl>
+#include <algorithm>
+
+// Targets larger than this times the median size are flagged
+static const double LargeTargetFactor = 2.0;
+// Amount of opcodes listed per target
+static const int HistogramOpcodes = 15;
 
 // Note: These methods should be kept up-to-date with the qsb tool.
 
@@ -58,6 +66,276 @@ static QString sourceVersionStr(const QShaderVersion &v)
     return s;
 }
 
+static QString variableTypeStr(QShaderDescription::VariableType type)
+{
+    switch (type) {
+    case QShaderDescription::Float:
+        return QStringLiteral("float");
+    case QShaderDescription::Vec2:
+        return QStringLiteral("vec2");
+    case QShaderDescription::Vec3:
+        return QStringLiteral("vec3");
+    case QShaderDescription::Vec4:
+        return QStringLiteral("vec4");
+    case QShaderDescription::Mat2:
+        return QStringLiteral("mat2");
+    case QShaderDescription::Mat3:
+        return QStringLiteral("mat3");
+    case QShaderDescription::Mat4:
+        return QStringLiteral("mat4");
+    case QShaderDescription::Int:
+        return QStringLiteral("int");
+    case QShaderDescription::Int2:
+        return QStringLiteral("ivec2");
+    case QShaderDescription::Int3:
+        return QStringLiteral("ivec3");
+    case QShaderDescription::Int4:
+        return QStringLiteral("ivec4");
+    case QShaderDescription::Uint:
+        return QStringLiteral("uint");
+    case QShaderDescription::Bool:
+        return QStringLiteral("bool");
+    case QShaderDescription::Sampler2D:
+        return QStringLiteral("sampler2D");
+    case QShaderDescription::Sampler3D:
+        return QStringLiteral("sampler3D");
+    case QShaderDescription::SamplerCube:
+        return QStringLiteral("samplerCube");
+    case QShaderDescription::Struct:
+        return QStringLiteral("struct");
+    default:
+        return QString("type %1").arg(int(type));
+    }
+}
+
+// Name of the shader, including the variant
+static QString shaderKeyStr(const QShaderKey &key)
+{
+    QString name = QString("%1 %2").arg(sourceStr(key.source()), sourceVersionStr(key.sourceVersion()));
+    if (key.sourceVariant() != QShader::StandardShader)
+        name += QString(" (variant %1)").arg(int(key.sourceVariant()));
+    return name.simplified();
+}
+
+static QString percentChangeStr(qint64 from, qint64 to)
+{
+    const qint64 change = to - from;
+    const QString sign = change >= 0 ? QStringLiteral("+") : QString();
+    QString s = QString("%1%2").arg(sign).arg(change);
+    if (from > 0)
+        s += QString(", %1%2%").arg(sign).arg(100.0 * change / from, 0, 'f', 1);
+    return s;
+}
+
+// Statistics of a single shader of the qsb
+struct ShaderStats {
+    QString name;
+    qint64 size = 0;
+    // SPIR-V instructions, -1 for other targets
+    int instructionCount = -1;
+    QHash<quint32, int> histogram;
+    // Lines of the source code targets, -1 for binaries
+    int lineCount = -1;
+};
+
+static QList<ShaderStats> shaderStats(const QShader &shader)
+{
+    QList<ShaderStats> stats;
+    const auto keys = shader.availableShaders();
+    for (const auto &key : keys) {
+        const QByteArray code = shader.shader(key).shader();
+        ShaderStats s;
+        s.name = shaderKeyStr(key);
+        s.size = code.size();
+        if (key.source() == QShader::SpirvShader) {
+            if (SpirvUsage::instructionHistogram(code, &s.histogram)) {
+                s.instructionCount = 0;
+                for (const int count : std::as_const(s.histogram))
+                    s.instructionCount += count;
+            }
+        } else if (key.source() == QShader::GlslShader || key.source() == QShader::HlslShader
+                   || key.source() == QShader::MslShader) {
+            s.lineCount = int(code.count('\n'));
+        }
+        stats << s;
+    }
+    std::sort(stats.begin(), stats.end(), [](const ShaderStats &a, const ShaderStats &b) {
+        return a.name < b.name;
+    });
+    return stats;
+}
+
+// Returns the reflection summary lines: uniform blocks, samplers, inputs and outputs
+static QStringList reflectionLines(const QShaderDescription &description)
+{
+    QStringList lines;
+    const auto blocks = description.uniformBlocks();
+    for (const auto &block : blocks) {
+        lines << QString("Uniform block %1 (binding %2): %3 bytes")
+                 .arg(QString::fromUtf8(block.blockName)).arg(block.binding).arg(block.size);
+        for (const auto &member : block.members) {
+            lines << QString("    %1 %2, offset %3, %4 bytes").arg(variableTypeStr(member.type),
+                                                                   QString::fromUtf8(member.name))
+                     .arg(member.offset).arg(member.size);
+        }
+    }
+    const auto samplers = description.combinedImageSamplers();
+    lines << QString("Samplers: %1").arg(samplers.size());
+    for (const auto &sampler : samplers) {
+        lines << QString("    %1 %2 (binding %3)").arg(variableTypeStr(sampler.type),
+                                                      QString::fromUtf8(sampler.name)).arg(sampler.binding);
+    }
+    const auto inputs = description.inputVariables();
+    lines << QString("Inputs: %1").arg(inputs.size());
+    for (const auto &input : inputs) {
+        lines << QString("    %1 %2 (location %3)").arg(variableTypeStr(input.type),
+                                                       QString::fromUtf8(input.name)).arg(input.location);
+    }
+    const auto outputs = description.outputVariables();
+    lines << QString("Outputs: %1").arg(outputs.size());
+    for (const auto &output : outputs) {
+        lines << QString("    %1 %2 (location %3)").arg(variableTypeStr(output.type),
+                                                       QString::fromUtf8(output.name)).arg(output.location);
+    }
+    return lines;
+}
+
+static QString statsStr(const ShaderStats &stats)
+{
+    QString s = QString("%1 bytes").arg(stats.size);
+    if (stats.instructionCount >= 0)
+        s += QString(", %1 instructions").arg(stats.instructionCount);
+    if (stats.lineCount >= 0)
+        s += QString(", %1 lines").arg(stats.lineCount);
+    return s;
+}
+
+// Returns analysis of the shader, compared to the baseline shader when it's valid
+static QString analyzeShader(const QShader &shader, const QShader &baseline, const QString &baselineFile)
+{
+    QString s;
+    const QList<ShaderStats> stats = shaderStats(shader);
+
+    s += "TARGETS\n";
+    QList<qint64> sizes;
+    for (const auto &target : stats)
+        sizes << target.size;
+    std::sort(sizes.begin(), sizes.end());
+    const qint64 medianSize = sizes.isEmpty() ? 0 : sizes.at(sizes.size() / 2);
+    for (const auto &target : stats) {
+        s += QString("%1: %2").arg(target.name, statsStr(target));
+        if (sizes.size() > 2 && target.size > LargeTargetFactor * medianSize)
+            s += QString("  <- LARGE, %1x the median size").arg(double(target.size) / medianSize, 0, 'f', 1);
+        s += '\n';
+    }
+
+    for (const auto &target : stats) {
+        if (target.histogram.isEmpty())
+            continue;
+        s += QString("\n%1 INSTRUCTIONS\n").arg(target.name);
+        QList<QPair<int, quint32>> counts;
+        for (auto it = target.histogram.cbegin(); it != target.histogram.cend(); ++it)
+            counts << qMakePair(it.value(), it.key());
+        std::sort(counts.begin(), counts.end(), [](const QPair<int, quint32> &a, const QPair<int, quint32> &b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        for (int i = 0; i < std::min(int(counts.size()), HistogramOpcodes); ++i)
+            s += QString("    %1 %2\n").arg(SpirvUsage::opcodeName(counts.at(i).second), -28).arg(counts.at(i).first);
+    }
+
+    s += "\nREFLECTION\n";
+    s += reflectionLines(shader.description()).join('\n') + '\n';
+
+    if (!baseline.isValid())
+        return s;
+
+    // Changes from the baseline into this shader
+    s += QString("\nCHANGES FROM %1\n").arg(baselineFile);
+    const QList<ShaderStats> baselineStats = shaderStats(baseline);
+    for (const auto &target : stats) {
+        auto it = std::find_if(baselineStats.cbegin(), baselineStats.cend(), [&target](const ShaderStats &b) {
+            return b.name == target.name;
+        });
+        if (it == baselineStats.cend()) {
+            s += QString("%1: new target\n").arg(target.name);
+            continue;
+        }
+        s += QString("%1: %2 -> %3 bytes (%4)").arg(target.name).arg(it->size).arg(target.size)
+                .arg(percentChangeStr(it->size, target.size));
+        if (target.instructionCount >= 0 && it->instructionCount >= 0) {
+            s += QString(", %1 -> %2 instructions (%3)").arg(it->instructionCount).arg(target.instructionCount)
+                    .arg(percentChangeStr(it->instructionCount, target.instructionCount));
+        }
+        s += '\n';
+        // Changed opcodes
+        QSet<quint32> opcodes;
+        for (auto h = target.histogram.cbegin(); h != target.histogram.cend(); ++h)
+            opcodes.insert(h.key());
+        for (auto h = it->histogram.cbegin(); h != it->histogram.cend(); ++h)
+            opcodes.insert(h.key());
+        QList<quint32> sortedOpcodes(opcodes.cbegin(), opcodes.cend());
+        std::sort(sortedOpcodes.begin(), sortedOpcodes.end());
+        for (const quint32 opcode : std::as_const(sortedOpcodes)) {
+            const int from = it->histogram.value(opcode);
+            const int to = target.histogram.value(opcode);
+            if (from != to) {
+                s += QString("    %1 %2 -> %3\n").arg(SpirvUsage::opcodeName(opcode), -28).arg(from).arg(to);
+            }
+        }
+    }
+    for (const auto &target : baselineStats) {
+        auto it = std::find_if(stats.cbegin(), stats.cend(), [&target](const ShaderStats &b) {
+            return b.name == target.name;
+        });
+        if (it == stats.cend())
+            s += QString("%1: removed target\n").arg(target.name);
+    }
+
+    // Reflection differences, as removed and added lines
+    const QStringList lines = reflectionLines(shader.description());
+    const QStringList baselineLines = reflectionLines(baseline.description());
+    QStringList reflectionChanges;
+    for (const auto &line : baselineLines) {
+        if (!lines.contains(line))
+            reflectionChanges << "- " + line.trimmed();
+    }
+    for (const auto &line : lines) {
+        if (!baselineLines.contains(line))
+            reflectionChanges << "+ " + line.trimmed();
+    }
+    if (!reflectionChanges.isEmpty())
+        s += "Reflection:\n    " + reflectionChanges.join("\n    ") + '\n';
+    return s;
+}
+
+// Reads the qsb file, returns invalid shader on failure
+static QShader readQsb(const QString &filename, QString *localFilename, qint64 *size)
+{
+    QString qsbFilename = filename;
+    QUrl url(filename);
+    if (url.scheme() == QStringLiteral("file"))
+        qsbFilename = url.toLocalFile();
+    *localFilename = qsbFilename;
+
+    QFile qsbFile(qsbFilename);
+    if (!qsbFile.open(QIODevice::ReadOnly)) {
+        qWarning("Failed to open %s", qPrintable(qsbFilename));
+        return QShader();
+    }
+
+    QByteArray buf = qsbFile.readAll();
+    if (buf.isEmpty()) {
+        qWarning("Empty QSB file %s", qPrintable(qsbFilename));
+        return QShader();
+    }
+    *size = qsbFile.size();
+
+    QShader bs = QShader::fromSerialized(buf);
+    if (!bs.isValid())
+        qWarning("Invalid QSB file %s", qPrintable(qsbFilename));
+    return bs;
+}
+
 QsbInspectorHelper::QsbInspectorHelper(QObject *parent)
     : QObject{parent}
 {
@@ -91,6 +369,8 @@ void QsbInspectorHelper::setCurrentSourceIndex(int index)
 
 QString QsbInspectorHelper::currentSourceCode() const
 {
+    if (m_currentSourceIndex == AnalysisIndex)
+        return m_analysis;
     if (m_currentSourceIndex == -1 || m_currentSourceIndex >= m_sourceCodes.size())
         return QString();
     return m_sourceCodes.at(m_currentSourceIndex);
@@ -99,34 +379,18 @@ QString QsbInspectorHelper::currentSourceCode() const
 // Loads QSB from filename and updates all data
 bool QsbInspectorHelper::loadQsb(const QString &filename)
 {
-    QString qsbFilename = filename;
-    QUrl url(filename);
-    if (url.scheme() == QStringLiteral("file"))
-        qsbFilename = url.toLocalFile();
-
-    QFile qsbFile(qsbFilename);
-    if (!qsbFile.open(QIODevice::ReadOnly)) {
-        qWarning("Failed to open %s", qPrintable(qsbFilename));
-        return false;
-    }
-
-    QByteArray buf = qsbFile.readAll();
-    if (buf.isEmpty()) {
-        qWarning("Empty QSB file %s", qPrintable(qsbFilename));
-        return false;
-    }
-
-    QShader bs = QShader::fromSerialized(buf);
-    if (!bs.isValid()) {
-        qWarning("Invalid QSB file %s", qPrintable(qsbFilename));
+    QString qsbFilename;
+    qint64 qsbSize = 0;
+    QShader bs = readQsb(filename, &qsbFilename, &qsbSize);
+    if (!bs.isValid())
         return false;
-    }
+    m_shader = bs;
 
     const auto keys = bs.availableShaders();
 
-    m_shaderData.m_currentFile = qsbFile.fileName();
+    m_shaderData.m_currentFile = qsbFilename;
     m_shaderData.m_stage = stageStr(bs.stage());
-    m_shaderData.m_size = qsbFile.size();
+    m_shaderData.m_size = qsbSize;
     m_shaderData.m_shaderCount = keys.count();
     m_shaderData.m_qsbVersion = QShaderPrivate::get(&bs)->qsbVersion;
     m_shaderData.m_reflectionInfo = bs.description().toJson();
@@ -176,6 +440,12 @@ bool QsbInspectorHelper::loadQsb(const QString &filename)
     infoSelectorData.m_sourceIndex = -1;
     infoSelectorData.m_name = "DETAILS";
     sourceSelectorModel.prepend(QVariant::fromValue(infoSelectorData));
+    // And analysis as the second, with index -2
+    ShaderSelectorData analysisSelectorData;
+    analysisSelectorData.m_sourceIndex = AnalysisIndex;
+    analysisSelectorData.m_name = "ANALYSIS";
+    sourceSelectorModel.insert(1, QVariant::fromValue(analysisSelectorData));
+    updateAnalysis();
 
     if (sourceSelectorModel.size() != m_sourceSelectorModel.size()) {
         // When the QSB shaders model has changed, select the deltails
@@ -190,3 +460,26 @@ bool QsbInspectorHelper::loadQsb(const QString &filename)
 
     return true;
 }
+
+// Loads QSB to compare the current one against, e.g. the
+// version before an edit, and shows the analysis.
+bool QsbInspectorHelper::loadBaselineQsb(const QString &filename)
+{
+    QString qsbFilename;
+    qint64 qsbSize = 0;
+    QShader bs = readQsb(filename, &qsbFilename, &qsbSize);
+    if (!bs.isValid())
+        return false;
+    m_baselineShader = bs;
+    m_baselineFile = QFileInfo(qsbFilename).fileName();
+    updateAnalysis();
+    Q_EMIT currentSourceCodeChanged();
+    return true;
+}
+
+void QsbInspectorHelper::updateAnalysis()
+{
+    m_analysis.clear();
+    if (m_shader.isValid())
+        m_analysis = analyzeShader(m_shader, m_baselineShader, m_baselineFile);
+}
@@ -52,8 +52,12 @@ public:
     int currentSourceIndex() const;
     QString currentSourceCode() const;
 
+    // Source index of the analysis view
+    static const int AnalysisIndex = -2;
+
 public Q_SLOTS:
     bool loadQsb(const QString &filename);
+    bool loadBaselineQsb(const QString &filename);
     void setCurrentSourceIndex(int index);
 
 Q_SIGNALS:
@@ -63,10 +67,17 @@ Q_SIGNALS:
     void currentSourceCodeChanged();
 
 private:
+    void updateAnalysis();
+
     QsbShaderData m_shaderData;
     QVariantList m_sourceSelectorModel;
     int m_currentSourceIndex = -1;
     QStringList m_sourceCodes;
+    QShader m_shader;
+    // Shader which the current one is compared to in the analysis
+    QShader m_baselineShader;
+    QString m_baselineFile;
+    QString m_analysis;
 };
 
 Q_DECLARE_METATYPE(QsbShaderData);
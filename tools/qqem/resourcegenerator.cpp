@@ -0,0 +1,161 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "resourcegenerator.h"
+#include <QtEndian>
+#include <algorithm>
+
+// Version 1 of the binary resource format, supported by all Qt 6 versions
+const quint32 RESOURCE_FORMAT_VERSION = 1;
+const quint16 RESOURCE_FLAG_DIRECTORY = 0x02;
+// QLocale::C, which is the default language of rcc
+const quint16 RESOURCE_LANGUAGE_C = 1;
+
+static void appendUInt16(QByteArray &data, quint16 value)
+{
+    const quint16 v = qToBigEndian(value);
+    data.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static void appendUInt32(QByteArray &data, quint32 value)
+{
+    const quint32 v = qToBigEndian(value);
+    data.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+// Same hash function as QResource uses for the names lookup
+static quint32 resourceNameHash(const QString &name)
+{
+    quint32 h = 0;
+    for (const QChar c : name) {
+        h = (h << 4) + c.unicode();
+        h ^= (h & 0xf0000000) >> 23;
+        h &= 0x0fffffff;
+    }
+    return h;
+}
+
+static quint32 appendName(QByteArray &names, const QString &name)
+{
+    const quint32 offset = quint32(names.size());
+    appendUInt16(names, quint16(name.size()));
+    appendUInt32(names, resourceNameHash(name));
+    for (const QChar c : name)
+        appendUInt16(names, c.unicode());
+    return offset;
+}
+
+// Tree contains the root directory, prefix directory and the files.
+// Children of the directory must be sorted by the name hash, as
+// QResource uses binary search to find them.
+QByteArray ResourceGenerator::resourceData(const QString &prefix, const QList<File> &files)
+{
+    QList<File> sortedFiles = files;
+    std::stable_sort(sortedFiles.begin(), sortedFiles.end(), [](const File &a, const File &b) {
+        return resourceNameHash(a.name) < resourceNameHash(b.name);
+    });
+
+    QByteArray names;
+    QByteArray data;
+    QByteArray tree;
+
+    // Root directory
+    const quint32 prefixNameOffset = appendName(names, prefix);
+    appendUInt32(tree, prefixNameOffset);
+    appendUInt16(tree, RESOURCE_FLAG_DIRECTORY);
+    appendUInt32(tree, 1); // child count
+    appendUInt32(tree, 1); // first child
+    // Prefix directory
+    appendUInt32(tree, prefixNameOffset);
+    appendUInt16(tree, RESOURCE_FLAG_DIRECTORY);
+    appendUInt32(tree, quint32(sortedFiles.size()));
+    appendUInt32(tree, 2);
+    // Files
+    for (const auto &file : std::as_const(sortedFiles)) {
+        const quint32 dataOffset = quint32(data.size());
+        appendUInt32(data, quint32(file.data.size()));
+        data.append(file.data);
+        appendUInt32(tree, appendName(names, file.name));
+        appendUInt16(tree, 0); // flags
+        appendUInt16(tree, 0); // country, QLocale::AnyTerritory
+        appendUInt16(tree, RESOURCE_LANGUAGE_C);
+        appendUInt32(tree, dataOffset);
+    }
+
+    const quint32 headerSize = 20;
+    const quint32 treeOffset = headerSize;
+    const quint32 dataOffset = treeOffset + quint32(tree.size());
+    const quint32 namesOffset = dataOffset + quint32(data.size());
+    QByteArray resource("qres");
+    appendUInt32(resource, RESOURCE_FORMAT_VERSION);
+    appendUInt32(resource, treeOffset);
+    appendUInt32(resource, dataOffset);
+    appendUInt32(resource, namesOffset);
+    resource.append(tree);
+    resource.append(data);
+    resource.append(names);
+    return resource;
+}
+
+QString ResourceGenerator::identifierName(const QString &name)
+{
+    QString s;
+    for (const QChar c : name)
+        s += (c.isLetterOrNumber() && c.unicode() < 128) ? c : QChar('_');
+    if (s.isEmpty() || s.at(0).isDigit())
+        s.prepend('_');
+    return s;
+}
+
+QByteArray ResourceGenerator::cppSource(const QString &name, const QString &prefix, const QList<File> &files)
+{
+    const QString id = identifierName(name);
+    const QByteArray resource = resourceData(prefix, files);
+
+    QString s;
+    s += "// Generated by Qt Quick Effect Maker, do not edit.\n";
+    s += QString("// Contains the exported effect files under \":/%1/\".\n").arg(prefix);
+    s += '\n';
+    s += "#include <QtCore/qresource.h>\n";
+    s += '\n';
+    s += "namespace {\n";
+    s += '\n';
+    s += QString("constexpr unsigned char %1_resource_data[] = {").arg(id);
+    for (qsizetype i = 0; i < resource.size(); ++i) {
+        if (i % 16 == 0)
+            s += "\n    ";
+        s += QString("0x%1,").arg(quint8(resource.at(i)), 2, 16, QChar('0'));
+    }
+    s += "\n};\n";
+    s += '\n';
+    s += "} // namespace\n";
+    s += '\n';
+    s += QString("bool register%1Resources()\n").arg(id);
+    s += "{\n";
+    s += QString("    return QResource::registerResource(%1_resource_data);\n").arg(id);
+    s += "}\n";
+    s += '\n';
+    s += QString("bool unregister%1Resources()\n").arg(id);
+    s += "{\n";
+    s += QString("    return QResource::unregisterResource(%1_resource_data);\n").arg(id);
+    s += "}\n";
+    return s.toUtf8();
+}
+
+QByteArray ResourceGenerator::cppHeader(const QString &name)
+{
+    const QString id = identifierName(name);
+    const QString guard = id.toUpper() + "_RESOURCES_H";
+    QString s;
+    s += "// Generated by Qt Quick Effect Maker, do not edit.\n";
+    s += '\n';
+    s += QString("#ifndef %1\n").arg(guard);
+    s += QString("#define %1\n").arg(guard);
+    s += '\n';
+    s += "// Registers the embedded effect files as resources. Call before loading the effect.\n";
+    s += QString("bool register%1Resources();\n").arg(id);
+    s += QString("bool unregister%1Resources();\n").arg(id);
+    s += '\n';
+    s += QString("#endif // %1\n").arg(guard);
+    return s.toUtf8();
+}
@@ -0,0 +1,33 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef RESOURCEGENERATOR_H
+#define RESOURCEGENERATOR_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// Generates C++ sources which embed files as Qt resources, so they
+// can be registered with QResource::registerResource() without any
+// file access and without running rcc.
+class ResourceGenerator
+{
+public:
+    struct File {
+        QString name;
+        QByteArray data;
+    };
+
+    // Returns binary resource data (in rcc format) with the files under ":/prefix/"
+    static QByteArray resourceData(const QString &prefix, const QList<File> &files);
+    // Returns C++ source which contains the resource data and
+    // register<name>Resources() & unregister<name>Resources() functions.
+    static QByteArray cppSource(const QString &name, const QString &prefix, const QList<File> &files);
+    // Returns C++ header with the declarations of the above functions
+    static QByteArray cppHeader(const QString &name);
+    // Returns name converted into valid C++ identifier
+    static QString identifierName(const QString &name);
+};
+
+#endif // RESOURCEGENERATOR_H
@@ -2,69 +2,69 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
 
 #include "shaderfeatures.h"
-#include <QStringList>
-#include <QDebug>
+#include <QRegularExpression>
 
 ShaderFeatures::ShaderFeatures()
 {
 }
 
 // Browse the shaders and check which features are used in them.
+// Only whole identifiers outside comments and disabled preprocessor
+// blocks count, so e.g. "// iTime unused" doesn't enable Time.
 void ShaderFeatures::update(const QString &vs, const QString &fs, const QString &qml)
 {
-    QStringList vsList = vs.split("\n");
-    QStringList fsList = fs.split("\n");
-
-    QStringList code = vsList + fsList;
     Features newFeatures = {};
     m_gridMeshWidth = 1;
     m_gridMeshHeight = 1;
-    for (const auto &line : code)
-        checkLine(line, newFeatures);
+    auto callback = [this, &newFeatures](const GlslTokenizer::Identifier &identifier) {
+        checkIdentifier(identifier, newFeatures);
+    };
+    GlslTokenizer::forEachIdentifier(vs, callback);
+    GlslTokenizer::forEachIdentifier(fs, callback);
 
     // iTime may also be used in QML side, without being used in shaders.
     // In this case enable the time helpers creation.
-    if (qml.contains("iTime"))
+    static const QRegularExpression timeExp("\\biTime\\b");
+    if (qml.contains(timeExp))
         newFeatures.setFlag(Time, true);
 
     if (newFeatures != m_enabledFeatures)
         m_enabledFeatures = newFeatures;
 }
 
-void ShaderFeatures::checkLine(const QString &line, Features &features) {
-    if (line.contains("iTime"))
-        features.setFlag(Time, true);
+void ShaderFeatures::checkIdentifier(const GlslTokenizer::Identifier &identifier, Features &features)
+{
+    const QStringView name = identifier.name;
+    if (identifier.isTag) {
+        if (name == u"mesh") {
+            // Get the mesh size, which follows the tag
+            const QList<QStringView> list = identifier.lineRest.split(QLatin1Char(','));
+            if (list.size() >= 2) {
+                int w = list.at(0).trimmed().toInt();
+                int h = list.at(1).trimmed().toInt();
+                // Set size to max values
+                m_gridMeshWidth = std::max(m_gridMeshWidth, w);
+                m_gridMeshHeight = std::max(m_gridMeshHeight, h);
+            }
+            // If is bigger than default (1, 1), set the feature
+            if (m_gridMeshWidth > 1 || m_gridMeshHeight > 1)
+                features.setFlag(GridMesh, true);
+        } else if (name == u"blursources") {
+            features.setFlag(BlurSources, true);
+        }
+        return;
+    }
 
-    if (line.contains("iFrame"))
+    if (name == u"iTime")
+        features.setFlag(Time, true);
+    else if (name == u"iFrame")
         features.setFlag(Frame, true);
-
-    if (line.contains("iResolution"))
+    else if (name == u"iResolution")
         features.setFlag(Resolution, true);
-
-    if (line.contains("iSource"))
+    else if (name == u"iSource")
         features.setFlag(Source, true);
-
-    if (line.contains("iMouse"))
+    else if (name == u"iMouse")
         features.setFlag(Mouse, true);
-
-    if (line.contains("fragCoord"))
+    else if (name == u"fragCoord")
         features.setFlag(FragCoord, true);
-
-    if (line.contains("@mesh")) {
-        // Get the mesh size, remove "@mesh"
-        QString l = line.trimmed().sliced(5);
-        QStringList list = l.split(QLatin1Char(','));
-        if (list.size() >= 2) {
-            int w = list.at(0).trimmed().toInt();
-            int h = list.at(1).trimmed().toInt();
-            // Set size to max values
-            m_gridMeshWidth = std::max(m_gridMeshWidth, w);
-            m_gridMeshHeight = std::max(m_gridMeshHeight, h);
-        }
-        // If is bigger than default (1, 1), set the feature
-        if (m_gridMeshWidth > 1 || m_gridMeshHeight > 1)
-            features.setFlag(GridMesh, true);
-    }
-    if (line.contains("@blursources"))
-        features.setFlag(BlurSources, true);
 }
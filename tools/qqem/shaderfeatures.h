@@ -6,6 +6,7 @@
 
 #include <QFlags>
 #include <QString>
+#include "glsltokenizer.h"
 
 class ShaderFeatures
 {
@@ -30,7 +31,7 @@ public:
     }
 private:
     friend class EffectManager;
-    void checkLine(const QString &line, ShaderFeatures::Features &features);
+    void checkIdentifier(const GlslTokenizer::Identifier &identifier, ShaderFeatures::Features &features);
     ShaderFeatures::Features m_enabledFeatures;
     int m_gridMeshWidth = 1;
     int m_gridMeshHeight = 1;
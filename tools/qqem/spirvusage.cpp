@@ -0,0 +1,197 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "spirvusage.h"
+#include <QHash>
+#include <QList>
+
+const quint32 SPIRV_MAGIC = 0x07230203;
+const int SPIRV_HEADER_SIZE = 5;
+
+// Instructions and storage classes used from the SPIR-V specification
+enum SpirvOp {
+    OpName = 5,
+    OpMemberName = 6,
+    OpEntryPoint = 15,
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpVariable = 59,
+    OpAccessChain = 65,
+    OpInBoundsAccessChain = 66,
+    OpDecorate = 71,
+    OpMemberDecorate = 72
+};
+
+enum SpirvStorageClass {
+    StorageUniformConstant = 0,
+    StorageUniform = 2
+};
+
+// Returns nul-terminated UTF-8 string packed into words
+static QString literalString(const quint32 *words, int count)
+{
+    QByteArray s(reinterpret_cast<const char *>(words), count * int(sizeof(quint32)));
+    const int end = s.indexOf('\0');
+    if (end >= 0)
+        s.truncate(end);
+    return QString::fromUtf8(s);
+}
+
+bool SpirvUsage::usedUniforms(const QByteArray &spirv, const QString &blockName, QSet<QString> *used)
+{
+    const int wordCount = int(spirv.size() / sizeof(quint32));
+    const quint32 *words = reinterpret_cast<const quint32 *>(spirv.constData());
+    if (wordCount < SPIRV_HEADER_SIZE || words[0] != SPIRV_MAGIC)
+        return false;
+
+    struct Instruction {
+        quint32 opcode;
+        const quint32 *operands;
+        int operandCount;
+    };
+    QList<Instruction> instructions;
+    for (int i = SPIRV_HEADER_SIZE; i < wordCount;) {
+        const quint32 count = words[i] >> 16;
+        if (count == 0 || i + int(count) > wordCount)
+            return false;
+        instructions << Instruction { words[i] & 0xffff, words + i + 1, int(count) - 1 };
+        i += count;
+    }
+
+    // Collect the declarations
+    QHash<quint32, QString> names;
+    QHash<quint32, QHash<quint32, QString>> memberNames;
+    QHash<quint32, quint32> pointerTypes;
+    QHash<quint32, quint32> constants;
+    // Uniform block variables with their (pointer) types
+    QHash<quint32, quint32> uniformVariables;
+    QSet<quint32> samplerVariables;
+    for (const auto &in : std::as_const(instructions)) {
+        if (in.opcode == OpName && in.operandCount >= 2)
+            names.insert(in.operands[0], literalString(in.operands + 1, in.operandCount - 1));
+        else if (in.opcode == OpMemberName && in.operandCount >= 3)
+            memberNames[in.operands[0]].insert(in.operands[1], literalString(in.operands + 2, in.operandCount - 2));
+        else if (in.opcode == OpTypePointer && in.operandCount >= 3)
+            pointerTypes.insert(in.operands[0], in.operands[2]);
+        else if (in.opcode == OpConstant && in.operandCount >= 3)
+            constants.insert(in.operands[1], in.operands[2]);
+        else if (in.opcode == OpVariable && in.operandCount >= 3 && in.operands[2] == StorageUniform)
+            uniformVariables.insert(in.operands[1], in.operands[0]);
+        else if (in.opcode == OpVariable && in.operandCount >= 3 && in.operands[2] == StorageUniformConstant)
+            samplerVariables.insert(in.operands[1]);
+    }
+    quint32 blockType = 0;
+    for (auto it = names.cbegin(); it != names.cend(); ++it) {
+        if (it.value() == blockName && memberNames.contains(it.key()))
+            blockType = it.key();
+    }
+    QSet<quint32> blockVariables;
+    for (auto it = uniformVariables.cbegin(); it != uniformVariables.cend(); ++it) {
+        if (blockType != 0 && pointerTypes.value(it.value()) == blockType)
+            blockVariables.insert(it.key());
+    }
+
+    // Find where the variables are referenced
+    const QHash<quint32, QString> blockMembers = memberNames.value(blockType);
+    QSet<quint32> usedMembers;
+    QSet<quint32> usedSamplers;
+    bool allMembersUsed = false;
+    for (const auto &in : std::as_const(instructions)) {
+        switch (in.opcode) {
+        case OpName:
+        case OpMemberName:
+        case OpEntryPoint:
+        case OpVariable:
+        case OpDecorate:
+        case OpMemberDecorate:
+            continue;
+        default:
+            break;
+        }
+        if ((in.opcode == OpAccessChain || in.opcode == OpInBoundsAccessChain)
+                && in.operandCount >= 4 && blockVariables.contains(in.operands[2])) {
+            // First index selects the block member, it's always a constant
+            if (constants.contains(in.operands[3]))
+                usedMembers.insert(constants.value(in.operands[3]));
+            else
+                allMembersUsed = true;
+            continue;
+        }
+        // Any other reference, like a load or a function argument
+        for (int i = 0; i < in.operandCount; i++) {
+            const quint32 operand = in.operands[i];
+            if (blockVariables.contains(operand))
+                allMembersUsed = true;
+            else if (samplerVariables.contains(operand))
+                usedSamplers.insert(operand);
+        }
+    }
+
+    for (auto it = blockMembers.cbegin(); it != blockMembers.cend(); ++it) {
+        if (allMembersUsed || usedMembers.contains(it.key()))
+            used->insert(it.value());
+    }
+    for (const auto variable : std::as_const(usedSamplers))
+        used->insert(names.value(variable));
+    return true;
+}
+
+bool SpirvUsage::instructionHistogram(const QByteArray &spirv, QHash<quint32, int> *histogram)
+{
+    const int wordCount = int(spirv.size() / sizeof(quint32));
+    const quint32 *words = reinterpret_cast<const quint32 *>(spirv.constData());
+    if (wordCount < SPIRV_HEADER_SIZE || words[0] != SPIRV_MAGIC)
+        return false;
+
+    for (int i = SPIRV_HEADER_SIZE; i < wordCount;) {
+        const quint32 count = words[i] >> 16;
+        if (count == 0 || i + int(count) > wordCount)
+            return false;
+        (*histogram)[words[i] & 0xffff]++;
+        i += count;
+    }
+    return true;
+}
+
+QString SpirvUsage::opcodeName(quint32 opcode)
+{
+    // Names of the common opcodes of the fragment and vertex shaders
+    static const QHash<quint32, const char *> names = {
+        { 0, "OpNop" }, { 1, "OpUndef" }, { 3, "OpSource" }, { 4, "OpSourceExtension" },
+        { 5, "OpName" }, { 6, "OpMemberName" }, { 7, "OpString" }, { 8, "OpLine" },
+        { 10, "OpExtension" }, { 11, "OpExtInstImport" }, { 12, "OpExtInst" },
+        { 14, "OpMemoryModel" }, { 15, "OpEntryPoint" }, { 16, "OpExecutionMode" },
+        { 17, "OpCapability" }, { 19, "OpTypeVoid" }, { 20, "OpTypeBool" }, { 21, "OpTypeInt" },
+        { 22, "OpTypeFloat" }, { 23, "OpTypeVector" }, { 24, "OpTypeMatrix" }, { 25, "OpTypeImage" },
+        { 26, "OpTypeSampler" }, { 27, "OpTypeSampledImage" }, { 28, "OpTypeArray" },
+        { 29, "OpTypeRuntimeArray" }, { 30, "OpTypeStruct" }, { 32, "OpTypePointer" },
+        { 33, "OpTypeFunction" }, { 41, "OpConstantTrue" }, { 42, "OpConstantFalse" },
+        { 43, "OpConstant" }, { 44, "OpConstantComposite" }, { 54, "OpFunction" },
+        { 55, "OpFunctionParameter" }, { 56, "OpFunctionEnd" }, { 57, "OpFunctionCall" },
+        { 59, "OpVariable" }, { 61, "OpLoad" }, { 62, "OpStore" }, { 65, "OpAccessChain" },
+        { 66, "OpInBoundsAccessChain" }, { 71, "OpDecorate" }, { 72, "OpMemberDecorate" },
+        { 77, "OpVectorExtractDynamic" }, { 78, "OpVectorInsertDynamic" }, { 79, "OpVectorShuffle" },
+        { 80, "OpCompositeConstruct" }, { 81, "OpCompositeExtract" }, { 82, "OpCompositeInsert" },
+        { 83, "OpCopyObject" }, { 84, "OpTranspose" }, { 86, "OpSampledImage" },
+        { 87, "OpImageSampleImplicitLod" }, { 88, "OpImageSampleExplicitLod" }, { 95, "OpImageFetch" },
+        { 100, "OpImage" }, { 103, "OpImageQuerySize" }, { 109, "OpConvertFToU" },
+        { 110, "OpConvertFToS" }, { 111, "OpConvertSToF" }, { 112, "OpConvertUToF" },
+        { 124, "OpBitcast" }, { 126, "OpSNegate" }, { 127, "OpFNegate" }, { 128, "OpIAdd" },
+        { 129, "OpFAdd" }, { 130, "OpISub" }, { 131, "OpFSub" }, { 132, "OpIMul" }, { 133, "OpFMul" },
+        { 135, "OpSDiv" }, { 136, "OpFDiv" }, { 139, "OpSMod" }, { 141, "OpFMod" },
+        { 142, "OpVectorTimesScalar" }, { 143, "OpMatrixTimesScalar" }, { 144, "OpVectorTimesMatrix" },
+        { 145, "OpMatrixTimesVector" }, { 146, "OpMatrixTimesMatrix" }, { 148, "OpDot" },
+        { 164, "OpLogicalEqual" }, { 165, "OpLogicalNotEqual" }, { 166, "OpLogicalOr" },
+        { 167, "OpLogicalAnd" }, { 168, "OpLogicalNot" }, { 169, "OpSelect" }, { 170, "OpIEqual" },
+        { 171, "OpINotEqual" }, { 173, "OpSGreaterThan" }, { 175, "OpSGreaterThanEqual" },
+        { 177, "OpSLessThan" }, { 179, "OpSLessThanEqual" }, { 180, "OpFOrdEqual" },
+        { 182, "OpFOrdNotEqual" }, { 184, "OpFOrdLessThan" }, { 186, "OpFOrdGreaterThan" },
+        { 188, "OpFOrdLessThanEqual" }, { 190, "OpFOrdGreaterThanEqual" }, { 207, "OpDPdx" },
+        { 208, "OpDPdy" }, { 209, "OpFwidth" }, { 245, "OpPhi" }, { 246, "OpLoopMerge" },
+        { 247, "OpSelectionMerge" }, { 248, "OpLabel" }, { 249, "OpBranch" },
+        { 250, "OpBranchConditional" }, { 251, "OpSwitch" }, { 252, "OpKill" }, { 253, "OpReturn" },
+        { 254, "OpReturnValue" }
+    };
+    const char *name = names.value(opcode, nullptr);
+    return name ? QString::fromLatin1(name) : QString("Op%1").arg(opcode);
+}
@@ -0,0 +1,29 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef SPIRVUSAGE_H
+#define SPIRVUSAGE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+
+// Finds the uniforms which are actually used by the compiled shader.
+// Declarations alone, code removed by the preprocessor or functions
+// which are never called don't count as usage.
+class SpirvUsage
+{
+public:
+    // Collects the names of the used members of the uniform block (with
+    // blockName type name) and the used sampler uniforms of the SPIR-V binary.
+    // Returns false if the binary can't be parsed.
+    static bool usedUniforms(const QByteArray &spirv, const QString &blockName, QSet<QString> *used);
+    // Counts the instructions of the SPIR-V binary per opcode.
+    // Returns false if the binary can't be parsed.
+    static bool instructionHistogram(const QByteArray &spirv, QHash<quint32, int> *histogram);
+    // Returns name of the opcode, e.g. "OpFMul"
+    static QString opcodeName(quint32 opcode);
+};
+
+#endif // SPIRVUSAGE_H
@@ -4,7 +4,9 @@
 #include "syntaxhighlighter.h"
 #include "syntaxhighlighterdata.h"
 
-#include <QtCore/qregularexpression.h>
+#include <QtGui/qtextobject.h>
+
+#include <array>
 
 #ifdef QQEM_SYNTAX_HIGHLIGHTING_ENABLED
 #include <QtQuick3DGlslParser/private/glsllexer_p.h>
@@ -25,7 +27,7 @@ enum TextStyle : quint8 {
 
 static constexpr TextStyle GLSLReservedKeyword = C_REMOVED_LINE;
 
-static QTextCharFormat formatForCategory(TextStyle category)
+static QTextCharFormat createFormat(TextStyle category)
 {
     switch (category) {
     case C_PARAMETER:
@@ -73,6 +75,60 @@ static QTextCharFormat formatForCategory(TextStyle category)
     return QTextCharFormat();
 }
 
+static const QTextCharFormat &formatForCategory(TextStyle category)
+{
+    static const std::array<QTextCharFormat, C_TAG + 1> formats = []() {
+        std::array<QTextCharFormat, C_TAG + 1> array;
+        for (int i = 0; i <= C_TAG; ++i)
+            array[i] = createFormat(TextStyle(i));
+        return array;
+    }();
+    return formats[category];
+}
+
+// Formats of the block, cached per incoming block state. Rehighlighting
+// stops when the outgoing state doesn't change, and a cascade caused e.g.
+// by opening and closing a multi-line comment can reuse the formats of
+// the other state without lexing the blocks again.
+class HighlightCache : public QTextBlockUserData
+{
+public:
+    struct Entry {
+        size_t textHash = 0;
+        int incomingState = -2;
+        int outgoingState = SyntaxHighlighter::None;
+        QList<SyntaxHighlighter::FormatRange> ranges;
+    };
+
+    const Entry *find(size_t textHash, int incomingState) const
+    {
+        for (const auto &entry : m_entries) {
+            if (entry.incomingState == incomingState && entry.textHash == textHash)
+                return &entry;
+        }
+        return nullptr;
+    }
+
+    // Returns the entry to fill for the incoming state, reusing the
+    // allocated ranges. Replaces the older entry of another state.
+    Entry &entryFor(int incomingState)
+    {
+        int index = m_entries[0].incomingState == incomingState ? 0 : 1;
+        if (m_entries[index].incomingState != incomingState) {
+            index = m_nextIndex;
+            m_nextIndex = 1 - m_nextIndex;
+        }
+        Entry &entry = m_entries[index];
+        entry.incomingState = incomingState;
+        entry.ranges.clear();
+        return entry;
+    }
+
+private:
+    std::array<Entry, 2> m_entries;
+    int m_nextIndex = 0;
+};
+
 SyntaxHighlighter::SyntaxHighlighter(QObject *p)
     : QSyntaxHighlighter(p)
 {
@@ -93,112 +149,117 @@ void SyntaxHighlighter::highlightBlock(const QString &text)
             m_argumentKeywords.insert(arg);
     }
     const int previousState = previousBlockState();
+    const size_t textHash = qHash(text);
+
+    auto *cache = static_cast<HighlightCache *>(currentBlockUserData());
+    if (!cache) {
+        cache = new HighlightCache;
+        setCurrentBlockUserData(cache);
+    }
+    if (const auto *entry = cache->find(textHash, previousState)) {
+        for (const auto &range : entry->ranges)
+            setFormat(range.start, range.length, formatForCategory(TextStyle(range.style)));
+        setCurrentBlockState(entry->outgoingState);
+        return;
+    }
+
+    HighlightCache::Entry &entry = cache->entryFor(previousState);
+    entry.textHash = textHash;
+    m_ranges = &entry.ranges;
+
     int state = 0;
     if (previousState != -1)
         state = previousState & 0xff;
 
-    const QByteArray data = text.toLatin1();
-    GLSL::Lexer lex(/*engine=*/ nullptr, data.constData(), data.size());
+    // Reuse the buffer, characters outside Latin-1 are replaced like in toLatin1()
+    m_latin1.resize(text.size());
+    char *latin1 = m_latin1.data();
+    const QChar *chars = text.constData();
+    for (qsizetype i = 0; i < text.size(); ++i)
+        latin1[i] = chars[i].unicode() < 0x100 ? char(chars[i].unicode()) : '?';
+    const char *data = m_latin1.constData();
+
+    GLSL::Lexer lex(/*engine=*/ nullptr, data, int(m_latin1.size()));
     lex.setState(state);
     lex.setScanKeywords(false);
     lex.setScanComments(true);
 
     lex.setVariant(GLSL::Lexer::Variant_GLSL_400);
 
-    QList<GLSL::Token> tokens;
+    // Tokens are formatted as they are lexed, so no token list is needed
+    int previousTokenEnd = 0;
     GLSL::Token tk;
     do {
         lex.yylex(&tk);
-        tokens.append(tk);
-    } while (tk.isNot(GLSL::Parser::EOF_SYMBOL));
-
-    state = lex.state(); // refresh the state
-
-    if (tokens.isEmpty()) {
-        setCurrentBlockState(previousState);
-        if (!text.isEmpty()) // the empty line can still contain whitespace
-            setFormat(0, text.length(), formatForCategory(C_VISUAL_WHITESPACE));
-        return;
-    }
-
-    for (int i = 0, end = tokens.size(); i != end; ++i) {
-        const GLSL::Token &tk = tokens.at(i);
-
-        int previousTokenEnd = 0;
-        if (i != 0) {
-            // mark the whitespaces
-            previousTokenEnd = tokens.at(i - 1).begin() + tokens.at(i - 1).length;
-        }
 
+        // mark the whitespaces
         if (previousTokenEnd != tk.begin())
-            setFormat(previousTokenEnd, tk.begin() - previousTokenEnd, formatForCategory(C_VISUAL_WHITESPACE));
+            applyFormat(previousTokenEnd, tk.begin() - previousTokenEnd, C_VISUAL_WHITESPACE);
+        previousTokenEnd = tk.begin() + tk.length;
 
         if (tk.is(GLSL::Parser::T_NUMBER)) {
-            setFormat(tk.begin(), tk.length, formatForCategory(C_NUMBER));
+            applyFormat(tk.begin(), tk.length, C_NUMBER);
 
         } else if (tk.is(GLSL::Parser::T_IDENTIFIER)) {
-            int kind = lex.findKeyword(data.constData() + tk.position, tk.length);
+            int kind = lex.findKeyword(data + tk.position, tk.length);
             if (kind == GLSL::Parser::T_IDENTIFIER) {
-                if (m_argumentKeywords.contains(QByteArrayView(data.constData() + tk.position, tk.length)))
-                    setFormat(tk.position, tk.length, formatForCategory(C_PARAMETER));
+                if (m_argumentKeywords.contains(QByteArrayView(data + tk.position, tk.length)))
+                    applyFormat(tk.position, tk.length, C_PARAMETER);
             }
             if (kind == GLSL::Parser::T_RESERVED) {
-                setFormat(tk.position, tk.length, formatForCategory(GLSLReservedKeyword));
+                applyFormat(tk.position, tk.length, GLSLReservedKeyword);
             } else if (kind != GLSL::Parser::T_IDENTIFIER) {
-                setFormat(tk.position, tk.length, formatForCategory(C_KEYWORD));
+                applyFormat(tk.position, tk.length, C_KEYWORD);
             } else {
                 const auto tagStartPos = tk.position - 1;
-                bool isTag = data.at(tagStartPos) == '@';
+                bool isTag = tagStartPos >= 0 && data[tagStartPos] == '@';
                 if (isTag) {
                     const auto tagLength = tk.length + 1;
-                    auto line = QByteArrayView(data.constData() + tagStartPos, tagLength).trimmed();
+                    auto line = QByteArrayView(data + tagStartPos, tagLength).trimmed();
                     auto firstSpace = line.indexOf(' ');
                     QByteArrayView firstWord;
                     if (firstSpace > 0)
                         firstWord = line.sliced(0, firstSpace);
                     if (m_tagKeywords.contains(line) || (!firstWord.isEmpty() && m_tagKeywords.contains(firstWord)))
-                        setFormat(tagStartPos, tagLength, formatForCategory(C_TAG));
+                        applyFormat(tagStartPos, tagLength, C_TAG);
                 }
             }
         } else if (tk.is(GLSL::Parser::T_COMMENT)) {
-            highlightLine(text, tk.begin(), tk.length, formatForCategory(C_COMMENT));
+            highlightLine(text, tk.begin(), tk.length, C_COMMENT);
         }
-    }
+    } while (tk.isNot(GLSL::Parser::EOF_SYMBOL));
 
     // mark the trailing white spaces
-    {
-        const GLSL::Token tk = tokens.last();
-        const int lastTokenEnd = tk.begin() + tk.length;
-        if (text.length() > lastTokenEnd)
-            highlightLine(text, lastTokenEnd, text.length() - lastTokenEnd, QTextCharFormat());
-    }
+    if (text.length() > previousTokenEnd)
+        highlightLine(text, previousTokenEnd, text.length() - previousTokenEnd, C_VISUAL_WHITESPACE);
 
     // Multi-line comments
-    static QRegularExpression startExpression("/\\*");
-    static QRegularExpression endExpression("\\*/");
+    const QLatin1String startExpression("/*");
+    const QLatin1String endExpression("*/");
 
-    setCurrentBlockState(None);
+    int outgoingState = None;
 
-    int startIndex = 0;
-    if (previousBlockState() != Comment)
+    qsizetype startIndex = 0;
+    if (previousState != Comment)
         startIndex = text.indexOf(startExpression);
 
     // Check multi-line comment blocks
     while (startIndex >= 0) {
-        QRegularExpressionMatch endMatch;
-        int endIndex = text.indexOf(endExpression, startIndex, &endMatch);
-        int commentLength;
+        const qsizetype endIndex = text.indexOf(endExpression, startIndex);
+        qsizetype commentLength;
         if (endIndex == -1) {
-            setCurrentBlockState(Comment);
+            outgoingState = Comment;
             commentLength = text.length() - startIndex;
         } else {
-            commentLength = endIndex - startIndex
-                            + endMatch.capturedLength();
+            commentLength = endIndex - startIndex + endExpression.size();
         }
-        setFormat(startIndex, commentLength, formatForCategory(C_COMMENT));
-        startIndex = text.indexOf(startExpression,
-                                  startIndex + commentLength);
+        applyFormat(int(startIndex), int(commentLength), C_COMMENT);
+        startIndex = text.indexOf(startExpression, startIndex + commentLength);
     }
+
+    entry.outgoingState = outgoingState;
+    m_ranges = nullptr;
+    setCurrentBlockState(outgoingState);
 }
 
 #else
@@ -211,11 +272,17 @@ void SyntaxHighlighter::highlightBlock(const QString &text)
 
 #endif
 
-void SyntaxHighlighter::highlightLine(const QString &text, int position, int length,
-                                      const QTextCharFormat &format)
+void SyntaxHighlighter::applyFormat(int start, int length, quint8 style)
 {
-    const QTextCharFormat visualSpaceFormat = formatForCategory(C_VISUAL_WHITESPACE);
+    if (m_ranges)
+        m_ranges->append({ start, length, style });
+    setFormat(start, length, formatForCategory(TextStyle(style)));
+}
 
+// Formats the text, marking the whitespaces. C_VISUAL_WHITESPACE style
+// marks only the whitespaces.
+void SyntaxHighlighter::highlightLine(const QString &text, int position, int length, quint8 style)
+{
     const int end = position + length;
     int index = position;
 
@@ -229,9 +296,9 @@ void SyntaxHighlighter::highlightLine(const QString &text, int position, int len
 
         const int tokenLength = index - start;
         if (isSpace)
-            setFormat(start, tokenLength, visualSpaceFormat);
-        else if (format.isValid())
-            setFormat(start, tokenLength, format);
+            applyFormat(start, tokenLength, C_VISUAL_WHITESPACE);
+        else if (style != C_VISUAL_WHITESPACE)
+            applyFormat(start, tokenLength, style);
     }
 }
 
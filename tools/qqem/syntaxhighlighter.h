@@ -22,6 +22,13 @@ public:
         Comment
     };
 
+    // Formatted range of the block, style is the text style category
+    struct FormatRange {
+        int start;
+        int length;
+        quint8 style;
+    };
+
     explicit SyntaxHighlighter(QObject *p = nullptr);
 
     // Shadows
@@ -38,7 +45,12 @@ protected:
     QSet<QByteArrayView> m_argumentKeywords;
 
 private:
-    void highlightLine(const QString &text, int position, int length, const QTextCharFormat &format);
+    void applyFormat(int start, int length, quint8 style);
+    void highlightLine(const QString &text, int position, int length, quint8 style);
+    // Ranges of the currently highlighted block, recorded into its cache
+    QList<FormatRange> *m_ranges = nullptr;
+    // Reused Latin-1 buffer for the lexer
+    QByteArray m_latin1;
 };
 
 #endif // SYNTAXHIGHLIGHTER_H
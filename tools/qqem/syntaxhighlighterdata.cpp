@@ -31,6 +31,7 @@ static constexpr QByteArrayView shader_tag_names[] {
     { "@nodes" },
     { "@mesh" },
     { "@blursources" },
+    { "@bake" },
     { "@requires" }
 };
 
@@ -0,0 +1,507 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include "texturecompressor.h"
+#include <QList>
+#include <QtEndian>
+#include <climits>
+
+// OpenGL internal formats used in the KTX header
+const quint32 GL_RGB_FORMAT = 0x1907;
+const quint32 GL_RGBA_FORMAT = 0x1908;
+const quint32 GL_COMPRESSED_RGB8_ETC2_FORMAT = 0x9274;
+const quint32 GL_COMPRESSED_RGBA8_ETC2_EAC_FORMAT = 0x9278;
+const quint32 GL_COMPRESSED_RGB_S3TC_DXT1_FORMAT = 0x83F0;
+const quint32 GL_COMPRESSED_RGBA_S3TC_DXT5_FORMAT = 0x83F3;
+
+// ETC1 / ETC2 individual & differential mode intensity modifiers
+static const int etcModifierTable[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+    { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// EAC alpha modifiers
+static const int eacModifierTable[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+static void appendUInt32(QByteArray &data, quint32 value)
+{
+    const quint32 v = qToLittleEndian(value);
+    data.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static void writeBigEndian64(quint64 value, quint8 *out)
+{
+    qToBigEndian(value, out);
+}
+
+static void writeLittleEndian64(quint64 value, quint8 *out)
+{
+    qToLittleEndian(value, out);
+}
+
+static bool imageHasAlpha(const QImage &image)
+{
+    if (!image.hasAlphaChannel())
+        return false;
+    for (int y = 0; y < image.height(); ++y) {
+        const quint8 *line = image.constScanLine(y);
+        for (int x = 0; x < image.width(); ++x) {
+            if (line[x * 4 + 3] != 255)
+                return true;
+        }
+    }
+    return false;
+}
+
+// Finds the best ETC table & pixel indices for the subblock pixels with given base color.
+// Returns the squared error. Indices are stored as (msb << 1) | lsb.
+static int encodeEtcSubblock(const quint8 *pixels, const int *subPixels, const int *base,
+                             int &bestTable, int *bestIndices)
+{
+    int bestError = INT_MAX;
+    for (int t = 0; t < 8; ++t) {
+        const int a = etcModifierTable[t][0];
+        const int b = etcModifierTable[t][1];
+        const int modifiers[4] = { a, b, -a, -b };
+        int error = 0;
+        int indices[8];
+        for (int i = 0; i < 8; ++i) {
+            const quint8 *p = pixels + subPixels[i] * 4;
+            int bestPixelError = INT_MAX;
+            for (int m = 0; m < 4; ++m) {
+                int pixelError = 0;
+                for (int c = 0; c < 3; ++c) {
+                    const int d = qBound(0, base[c] + modifiers[m], 255) - p[c];
+                    pixelError += d * d;
+                }
+                if (pixelError < bestPixelError) {
+                    bestPixelError = pixelError;
+                    indices[i] = m;
+                }
+            }
+            error += bestPixelError;
+            if (error >= bestError)
+                break;
+        }
+        if (error < bestError) {
+            bestError = error;
+            bestTable = t;
+            for (int i = 0; i < 8; ++i)
+                bestIndices[i] = indices[i];
+        }
+    }
+    return bestError;
+}
+
+// Encodes 4x4 RGBA pixels (row-major) into 8 bytes of ETC2 RGB data.
+// Only individual & differential modes are used. These are ETC1 compatible and
+// differential mode is used only when the colors don't overflow, so the block
+// is decoded identically by ETC2 decoders.
+void TextureCompressor::encodeEtcBlock(const quint8 *pixels, quint8 *out)
+{
+    quint64 bestBlock = 0;
+    int bestError = INT_MAX;
+
+    for (int flip = 0; flip < 2; ++flip) {
+        // flip 0: two 2x4 subblocks side-by-side, flip 1: two 4x2 subblocks on top of each other
+        int subPixels[2][8];
+        int counts[2] = { 0, 0 };
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                const int s = flip ? (y >= 2) : (x >= 2);
+                subPixels[s][counts[s]++] = y * 4 + x;
+            }
+        }
+        float average[2][3];
+        for (int s = 0; s < 2; ++s) {
+            for (int c = 0; c < 3; ++c) {
+                int sum = 0;
+                for (int i = 0; i < 8; ++i)
+                    sum += pixels[subPixels[s][i] * 4 + c];
+                average[s][c] = sum / 8.0f;
+            }
+        }
+
+        for (int diff = 1; diff >= 0; --diff) {
+            int quantized[2][3];
+            int base[2][3];
+            bool valid = true;
+            for (int s = 0; s < 2; ++s) {
+                for (int c = 0; c < 3; ++c) {
+                    if (diff) {
+                        const int q = qBound(0, qRound(average[s][c] * 31.0f / 255.0f), 31);
+                        quantized[s][c] = q;
+                        base[s][c] = (q << 3) | (q >> 2);
+                    } else {
+                        const int q = qBound(0, qRound(average[s][c] * 15.0f / 255.0f), 15);
+                        quantized[s][c] = q;
+                        base[s][c] = (q << 4) | q;
+                    }
+                }
+            }
+            if (diff) {
+                for (int c = 0; c < 3; ++c) {
+                    const int d = quantized[1][c] - quantized[0][c];
+                    if (d < -4 || d > 3)
+                        valid = false;
+                }
+            }
+            if (!valid)
+                continue;
+
+            int tables[2];
+            int indices[2][8];
+            int error = encodeEtcSubblock(pixels, subPixels[0], base[0], tables[0], indices[0]);
+            if (error >= bestError)
+                continue;
+            error += encodeEtcSubblock(pixels, subPixels[1], base[1], tables[1], indices[1]);
+            if (error >= bestError)
+                continue;
+
+            bestError = error;
+            quint64 block = 0;
+            if (diff) {
+                for (int c = 0; c < 3; ++c) {
+                    const int d = quantized[1][c] - quantized[0][c];
+                    block |= quint64(quantized[0][c]) << (59 - c * 8);
+                    block |= quint64(d & 7) << (56 - c * 8);
+                }
+            } else {
+                for (int c = 0; c < 3; ++c) {
+                    block |= quint64(quantized[0][c]) << (60 - c * 8);
+                    block |= quint64(quantized[1][c]) << (56 - c * 8);
+                }
+            }
+            block |= quint64(tables[0]) << 37;
+            block |= quint64(tables[1]) << 34;
+            block |= quint64(diff) << 33;
+            block |= quint64(flip) << 32;
+            for (int s = 0; s < 2; ++s) {
+                for (int i = 0; i < 8; ++i) {
+                    // Pixel indices are stored in column-major order
+                    const int p = subPixels[s][i];
+                    const int k = (p % 4) * 4 + p / 4;
+                    block |= quint64(indices[s][i] >> 1) << (16 + k);
+                    block |= quint64(indices[s][i] & 1) << k;
+                }
+            }
+            bestBlock = block;
+        }
+    }
+
+    writeBigEndian64(bestBlock, out);
+}
+
+// Encodes alpha of 4x4 RGBA pixels (row-major) into 8 bytes of EAC data.
+void TextureCompressor::encodeEacAlphaBlock(const quint8 *pixels, quint8 *out)
+{
+    int minAlpha = 255;
+    int maxAlpha = 0;
+    for (int i = 0; i < 16; ++i) {
+        minAlpha = qMin(minAlpha, int(pixels[i * 4 + 3]));
+        maxAlpha = qMax(maxAlpha, int(pixels[i * 4 + 3]));
+    }
+
+    int bestBase = minAlpha;
+    int bestMultiplier = 1;
+    int bestTable = 13;
+    int bestIndices[16];
+    // Table 13 contains zero modifier, so constant alpha is exact
+    for (int i = 0; i < 16; ++i)
+        bestIndices[i] = 4;
+
+    if (minAlpha != maxAlpha) {
+        int bestError = INT_MAX;
+        for (int t = 0; t < 16; ++t) {
+            const int *modifiers = eacModifierTable[t];
+            const int span = modifiers[7] - modifiers[3];
+            const int estimate = qBound(1, qRound(float(maxAlpha - minAlpha) / span), 15);
+            for (int multiplier = qMax(1, estimate - 1); multiplier <= qMin(15, estimate + 1); ++multiplier) {
+                const float center = (minAlpha + maxAlpha) / 2.0f;
+                const int base = qBound(0, qRound(center - (modifiers[3] + modifiers[7]) * multiplier / 2.0f), 255);
+                int error = 0;
+                int indices[16];
+                for (int i = 0; i < 16; ++i) {
+                    const int alpha = pixels[i * 4 + 3];
+                    int bestPixelError = INT_MAX;
+                    for (int m = 0; m < 8; ++m) {
+                        const int d = qBound(0, base + modifiers[m] * multiplier, 255) - alpha;
+                        if (d * d < bestPixelError) {
+                            bestPixelError = d * d;
+                            indices[i] = m;
+                        }
+                    }
+                    error += bestPixelError;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    bestBase = base;
+                    bestMultiplier = multiplier;
+                    bestTable = t;
+                    for (int i = 0; i < 16; ++i)
+                        bestIndices[i] = indices[i];
+                }
+            }
+        }
+    }
+
+    quint64 block = quint64(bestBase) << 56;
+    block |= quint64(bestMultiplier) << 52;
+    block |= quint64(bestTable) << 48;
+    for (int i = 0; i < 16; ++i) {
+        // Pixel indices are stored in column-major order, first pixel at the top bits
+        const int k = (i % 4) * 4 + i / 4;
+        block |= quint64(bestIndices[i]) << (45 - k * 3);
+    }
+    writeBigEndian64(block, out);
+}
+
+static quint16 toRgb565(const int *rgb)
+{
+    const int r = (rgb[0] * 31 + 127) / 255;
+    const int g = (rgb[1] * 63 + 127) / 255;
+    const int b = (rgb[2] * 31 + 127) / 255;
+    return quint16((r << 11) | (g << 5) | b);
+}
+
+static void fromRgb565(quint16 color, int *rgb)
+{
+    const int r = (color >> 11) & 31;
+    const int g = (color >> 5) & 63;
+    const int b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Encodes 4x4 RGBA pixels (row-major) into 8 bytes of BC1 (DXT1) data.
+// Endpoints are selected from the (inset) color bounding box diagonal
+// which best matches the correlation of the channels.
+void TextureCompressor::encodeBc1Block(const quint8 *pixels, quint8 *out)
+{
+    int minColor[3] = { 255, 255, 255 };
+    int maxColor[3] = { 0, 0, 0 };
+    float mean[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            minColor[c] = qMin(minColor[c], int(pixels[i * 4 + c]));
+            maxColor[c] = qMax(maxColor[c], int(pixels[i * 4 + c]));
+            mean[c] += pixels[i * 4 + c] / 16.0f;
+        }
+    }
+
+    // Swap the endpoints of channels which correlate negatively with the main channel
+    int mainChannel = 0;
+    for (int c = 1; c < 3; ++c) {
+        if (maxColor[c] - minColor[c] > maxColor[mainChannel] - minColor[mainChannel])
+            mainChannel = c;
+    }
+    for (int c = 0; c < 3; ++c) {
+        if (c == mainChannel)
+            continue;
+        float covariance = 0;
+        for (int i = 0; i < 16; ++i)
+            covariance += (pixels[i * 4 + c] - mean[c]) * (pixels[i * 4 + mainChannel] - mean[mainChannel]);
+        if (covariance < 0)
+            qSwap(minColor[c], maxColor[c]);
+    }
+
+    int endPoint0[3];
+    int endPoint1[3];
+    for (int c = 0; c < 3; ++c) {
+        const int inset = (maxColor[c] - minColor[c]) / 16;
+        endPoint0[c] = qBound(0, maxColor[c] - inset, 255);
+        endPoint1[c] = qBound(0, minColor[c] + inset, 255);
+    }
+    quint16 color0 = toRgb565(endPoint0);
+    quint16 color1 = toRgb565(endPoint1);
+    // color0 > color1 selects the four color mode
+    if (color0 < color1)
+        qSwap(color0, color1);
+
+    quint32 indexBits = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        fromRgb565(color0, palette[0]);
+        fromRgb565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int bestIndex = 0;
+            int bestError = INT_MAX;
+            for (int p = 0; p < 4; ++p) {
+                int error = 0;
+                for (int c = 0; c < 3; ++c) {
+                    const int d = palette[p][c] - pixels[i * 4 + c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            indexBits |= quint32(bestIndex) << (i * 2);
+        }
+    }
+
+    const quint64 block = quint64(color0) | (quint64(color1) << 16) | (quint64(indexBits) << 32);
+    writeLittleEndian64(block, out);
+}
+
+// Encodes alpha of 4x4 RGBA pixels (row-major) into 8 bytes of BC3 (DXT5) alpha data.
+void TextureCompressor::encodeBc3AlphaBlock(const quint8 *pixels, quint8 *out)
+{
+    int alpha0 = 0;
+    int alpha1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        alpha0 = qMax(alpha0, int(pixels[i * 4 + 3]));
+        alpha1 = qMin(alpha1, int(pixels[i * 4 + 3]));
+    }
+
+    quint64 indexBits = 0;
+    if (alpha0 != alpha1) {
+        // alpha0 > alpha1 selects the eight alpha values mode
+        int palette[8];
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        for (int k = 2; k < 8; ++k)
+            palette[k] = ((8 - k) * alpha0 + (k - 1) * alpha1) / 7;
+        for (int i = 0; i < 16; ++i) {
+            int bestIndex = 0;
+            int bestError = INT_MAX;
+            for (int p = 0; p < 8; ++p) {
+                const int error = qAbs(palette[p] - pixels[i * 4 + 3]);
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            indexBits |= quint64(bestIndex) << (i * 3);
+        }
+    }
+
+    const quint64 block = quint64(alpha0) | (quint64(alpha1) << 8) | (indexBits << 16);
+    writeLittleEndian64(block, out);
+}
+
+// Compresses image (in Format_RGBA8888) into blocks.
+QByteArray TextureCompressor::compressImage(const QImage &image, Format format, bool hasAlpha)
+{
+    const int blocksX = (image.width() + 3) / 4;
+    const int blocksY = (image.height() + 3) / 4;
+    const int blockSize = hasAlpha ? 16 : 8;
+    QByteArray data(blocksX * blocksY * blockSize, 0);
+    quint8 *out = reinterpret_cast<quint8 *>(data.data());
+
+    quint8 pixels[16 * 4];
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            // Collect the block pixels, clamping at the image edges
+            for (int y = 0; y < 4; ++y) {
+                const int py = qMin(by * 4 + y, image.height() - 1);
+                const quint8 *line = image.constScanLine(py);
+                for (int x = 0; x < 4; ++x) {
+                    const int px = qMin(bx * 4 + x, image.width() - 1);
+                    for (int c = 0; c < 4; ++c)
+                        pixels[(y * 4 + x) * 4 + c] = line[px * 4 + c];
+                }
+            }
+            if (format == ETC2) {
+                if (hasAlpha) {
+                    encodeEacAlphaBlock(pixels, out);
+                    out += 8;
+                }
+                encodeEtcBlock(pixels, out);
+            } else {
+                if (hasAlpha) {
+                    encodeBc3AlphaBlock(pixels, out);
+                    out += 8;
+                }
+                encodeBc1Block(pixels, out);
+            }
+            out += 8;
+        }
+    }
+    return data;
+}
+
+QByteArray TextureCompressor::compressToKtx(const QImage &image, Format format, bool mipmaps)
+{
+    if (image.isNull())
+        return QByteArray();
+
+    const QImage baseImage = image.convertToFormat(QImage::Format_RGBA8888);
+    const bool hasAlpha = imageHasAlpha(baseImage);
+
+    // Mipmaps are scaled in premultiplied format to avoid color bleeding from transparent pixels
+    QList<QImage> levels;
+    levels << baseImage;
+    if (mipmaps) {
+        QImage level = baseImage.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+        while (level.width() > 1 || level.height() > 1) {
+            const int w = qMax(1, level.width() / 2);
+            const int h = qMax(1, level.height() / 2);
+            level = level.scaled(w, h, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            levels << level.convertToFormat(QImage::Format_RGBA8888);
+        }
+    }
+
+    quint32 internalFormat;
+    if (format == ETC2)
+        internalFormat = hasAlpha ? GL_COMPRESSED_RGBA8_ETC2_EAC_FORMAT : GL_COMPRESSED_RGB8_ETC2_FORMAT;
+    else
+        internalFormat = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_FORMAT : GL_COMPRESSED_RGB_S3TC_DXT1_FORMAT;
+
+    // Texture data is stored top-down, like in QImage
+    QByteArray keyValueData;
+    const QByteArray orientation("KTXorientation\0S=r,T=d\0", 23);
+    appendUInt32(keyValueData, quint32(orientation.size()));
+    keyValueData.append(orientation);
+    while (keyValueData.size() % 4)
+        keyValueData.append('\0');
+
+    // KTX 1.1 header
+    static const char identifier[12] = { '\xAB', 'K', 'T', 'X', ' ', '1', '1', '\xBB', '\r', '\n', '\x1A', '\n' };
+    QByteArray ktx(identifier, sizeof(identifier));
+    appendUInt32(ktx, 0x04030201); // endianness
+    appendUInt32(ktx, 0); // glType
+    appendUInt32(ktx, 1); // glTypeSize
+    appendUInt32(ktx, 0); // glFormat
+    appendUInt32(ktx, internalFormat);
+    appendUInt32(ktx, hasAlpha ? GL_RGBA_FORMAT : GL_RGB_FORMAT);
+    appendUInt32(ktx, quint32(baseImage.width()));
+    appendUInt32(ktx, quint32(baseImage.height()));
+    appendUInt32(ktx, 0); // pixelDepth
+    appendUInt32(ktx, 0); // numberOfArrayElements
+    appendUInt32(ktx, 1); // numberOfFaces
+    appendUInt32(ktx, quint32(levels.size()));
+    appendUInt32(ktx, quint32(keyValueData.size()));
+    ktx.append(keyValueData);
+
+    for (const auto &level : std::as_const(levels)) {
+        const QByteArray levelData = compressImage(level, format, hasAlpha);
+        appendUInt32(ktx, quint32(levelData.size()));
+        // Block sizes are multiples of 8, so no mip padding is needed
+        ktx.append(levelData);
+    }
+    return ktx;
+}
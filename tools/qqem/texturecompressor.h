@@ -0,0 +1,34 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#ifndef TEXTURECOMPRESSOR_H
+#define TEXTURECOMPRESSOR_H
+
+#include <QByteArray>
+#include <QImage>
+
+// CPU encoder for GPU compressed textures, written into KTX (1.1) containers.
+// Supports ETC2 (RGB8 & RGBA8 EAC) for embedded/mobile and BC1/BC3 for desktop.
+// Note: Stateless, so can be used from worker threads.
+class TextureCompressor
+{
+public:
+    enum Format {
+        ETC2,
+        BC
+    };
+
+    // Encodes image into KTX file data. When mipmaps is true, the full mipmap
+    // chain is generated and stored. Format with alpha is used only when
+    // image contains non-opaque pixels.
+    static QByteArray compressToKtx(const QImage &image, Format format, bool mipmaps);
+
+private:
+    static QByteArray compressImage(const QImage &image, Format format, bool hasAlpha);
+    static void encodeEtcBlock(const quint8 *pixels, quint8 *out);
+    static void encodeEacAlphaBlock(const quint8 *pixels, quint8 *out);
+    static void encodeBc1Block(const quint8 *pixels, quint8 *out);
+    static void encodeBc3AlphaBlock(const quint8 *pixels, quint8 *out);
+};
+
+#endif // TEXTURECOMPRESSOR_H
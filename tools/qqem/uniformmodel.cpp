@@ -804,6 +804,17 @@ void UniformModel::appendUniform(Uniform uniform)
 }
 
 void UniformModel::setUniformValueData(Uniform *uniform, const QString &value, const QString &defaultValue, const QString &minValue, const QString &maxValue)
+{
+    if (!uniform)
+        return;
+
+    initUniformValueData(uniform, value, defaultValue, minValue, maxValue);
+
+    // Update the value data in bindings
+    g_propertyData.insert(uniform->name, uniform->value);
+}
+
+void UniformModel::initUniformValueData(Uniform *uniform, const QString &value, const QString &defaultValue, const QString &minValue, const QString &maxValue)
 {
     if (!uniform)
         return;
@@ -812,12 +823,9 @@ void UniformModel::setUniformValueData(Uniform *uniform, const QString &value, c
     uniform->defaultValue = defaultValue.isEmpty() ? getInitializedVariant(uniform->type, false) : valueStringToVariant(uniform->type, defaultValue);
     uniform->minValue = minValue.isEmpty() ? getInitializedVariant(uniform->type, false) : valueStringToVariant(uniform->type, minValue);
     uniform->maxValue = maxValue.isEmpty() ? getInitializedVariant(uniform->type, true) : valueStringToVariant(uniform->type, maxValue);
-
-    // Update the value data in bindings
-    g_propertyData.insert(uniform->name, uniform->value);
 }
 
-UniformModel::Uniform::Type UniformModel::typeFromString(const QString &typeString) const
+UniformModel::Uniform::Type UniformModel::typeFromString(const QString &typeString)
 {
     if (typeString == "bool")
         return UniformModel::Uniform::Type::Bool;
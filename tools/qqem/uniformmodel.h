@@ -91,7 +91,7 @@ public:
     QString valueAsVariable(const Uniform &uniform);
     QString valueAsBinding(const Uniform &uniform);
     QString variantAsDataString(const Uniform::Type type, const QVariant &variant);
-    QVariant valueStringToVariant(const Uniform::Type type, const QString &value);
+    static QVariant valueStringToVariant(const Uniform::Type type, const QString &value);
 
     Q_INVOKABLE bool updateRow(int nodeId, int rowIndex, int type, const QString &id,
                                const QVariant &defaultValue, const QString &description, const QString &customValue,
@@ -105,8 +105,10 @@ public:
     void appendUniform(Uniform uniform);
 
     void setUniformValueData(Uniform *uniform, const QString &value, const QString &defaultValue, const QString &minValue, const QString &maxValue);
+    // Same as setUniformValueData but without updating the bindings, so thread-safe
+    static void initUniformValueData(Uniform *uniform, const QString &value, const QString &defaultValue, const QString &minValue, const QString &maxValue);
     // These convert between uniform type & string name in JSON
-    UniformModel::Uniform::Type typeFromString(const QString &typeString) const;
+    static UniformModel::Uniform::Type typeFromString(const QString &typeString);
     QString stringFromType(Uniform::Type type);
 
 Q_SIGNALS: